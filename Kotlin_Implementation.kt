@@ -30,6 +30,7 @@ class MainActivity : Activity() {
         checkPMProxy()
         checkAppComponentFactory()
         checkApkPaths(this)
+        runNativeChecks()
     }
 
     fun getAppComponentFactory(context: Context): String? {
@@ -297,6 +298,31 @@ class MainActivity : Activity() {
 
 
 
+    private fun runNativeChecks() {
+        // The checks read /proc, stat files and hash mapped code, so they run
+        // off the main thread; logMessage posts back to it
+        Thread({
+            try {
+                CheckBeerNative.setMeasurementEnabled(true)
+                val suspicious = CheckBeerNative.runChecks(this)
+                if (suspicious) {
+                    logMessage("Native checks found something. SUSPICIOUS", Color.RED)
+                    // Nothing else runs the checks, so this is the same run's report
+                    logMessage(CheckBeerNative.lastReport(), Color.RED)
+                } else {
+                    logMessage("Native checks passed", Color.GREEN)
+                }
+                logMessage(CheckBeerNative.coldStartStats())
+                CheckBeerNative.latencyStats().forEach {
+                    logMessage("${it.check}: n=${it.count} p50=${it.p50Ns / 1000}us p99=${it.p99Ns / 1000}us p999=${it.p999Ns / 1000}us")
+                }
+            } catch (e: Throwable) {
+                logMessage("Error while running native checks: ${e.message}")
+            }
+            logMessage("\n")
+        }, "CheckBeerChecks").start()
+    }
+
     private fun getmyAppComponentFactory(): String? {
         try {
             if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
@@ -322,3 +348,66 @@ class MainActivity : Activity() {
         private const val TAG = "SigKill"
     }
 }
+
+data class CheckLatency(
+    val check: String,
+    val count: Long,
+    val minNs: Long,
+    val maxNs: Long,
+    val meanNs: Long,
+    val p50Ns: Long,
+    val p99Ns: Long,
+    val p999Ns: Long
+)
+
+object CheckBeerNative {
+    // Same order as checkbeer::CheckId
+    private val CHECK_NAMES = listOf(
+        "checkCreator",
+        "checkField",
+        "checkCreators",
+        "checkPMProxy",
+        "checkAppComponentFactory",
+        "checkApkPaths",
+        "checkInjectedLibraries",
+        "checkAnonymousExecutable",
+        "checkMemorySignatures",
+        "checkJniFunctionTable",
+        "checkGotHooks",
+        "checkInlineHooks",
+        "checkSelfIntegrity",
+        "checkDexMappings",
+        "checkApkIdentity",
+        "checkApkMounts"
+    )
+    private const val LATENCY_FIELDS = 7
+
+    // The library's JNI_OnLoad must call checkOnLoad(), or it must be built
+    // with CHECK_DEFINE_JNI_ONLOAD=1; that is where these get bound
+    init {
+        System.loadLibrary("checkbeer")
+    }
+
+    external fun runChecks(context: Context): Boolean
+    // Runs the checks once and writes every JNI call they make to path
+    external fun recordChecks(context: Context, path: String): Boolean
+    external fun setMeasurementEnabled(enabled: Boolean)
+    external fun coldStartStats(): String
+    external fun latencySnapshot(): LongArray
+    external fun resetLatency()
+    external fun startTracing(): Boolean
+    external fun stopTracing()
+    // What the last runChecks call found, one "check: detail" per line
+    external fun lastReport(): String
+
+    fun latencyStats(): List<CheckLatency> {
+        val raw = latencySnapshot()
+        return (0 until raw.size / LATENCY_FIELDS).map { i ->
+            val o = i * LATENCY_FIELDS
+            CheckLatency(
+                CHECK_NAMES.getOrElse(i) { "check$i" },
+                raw[o], raw[o + 1], raw[o + 2], raw[o + 3], raw[o + 4], raw[o + 5], raw[o + 6]
+            )
+        }
+    }
+}
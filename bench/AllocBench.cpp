@@ -0,0 +1,140 @@
+// Heap allocations per check run, from the CHECK_ALLOC_PROFILE hooks. Records
+// the checks against FakeJvm with its APK paths pointed at scratch files in
+// the working directory, so the path and identity checks get past their
+// stat calls, then replays that trace: warm-up runs first, to fill the
+// bindings, the mount table, the mapping index and the dex digest cache, then
+// the measured runs. A scratch .dex is mapped next to this binary, which is
+// where the dex check looks for the app's code, so it has chunks to compare.
+// Fails if any check allocated in a measured run.
+//
+//     AllocBench [runs]
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SignatureCheck.hpp"
+
+#include "../tests/FakeJvm.hpp"
+
+namespace {
+
+    constexpr int kWarmupRuns = 2;
+    constexpr size_t kDexSize = 1 << 20;
+
+    bool WriteFile(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "w");
+        return file && fputs("PK\x05\x06", file) >= 0 && fclose(file) == 0;
+    }
+
+    // Writes kDexSize bytes to path and maps them read-only
+    void* MapScratchDex(const std::string& path) {
+        std::vector<uint8_t> bytes(kDexSize);
+        for (size_t i = 0; i < bytes.size(); i++) bytes[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+        memcpy(bytes.data(), "dex\n035", 8);
+        FILE* file = fopen(path.c_str(), "w");
+        if (!file) return nullptr;
+        bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        if (fclose(file) != 0 || !written) return nullptr;
+
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        void* data = mmap(nullptr, kDexSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        return data == MAP_FAILED ? nullptr : data;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20;
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return 1;
+    std::string appDir = std::string(cwd) + "/AllocBench.app";
+    std::string sourceDir = appDir + "/base.apk";
+    std::string libraryDir = appDir + "/lib/arm64";
+    mkdir(appDir.c_str(), 0755);
+    mkdir((appDir + "/lib").c_str(), 0755);
+    mkdir(libraryDir.c_str(), 0755);
+    if (!WriteFile(sourceDir)) {
+        fprintf(stderr, "cannot write %s\n", sourceDir.c_str());
+        return 1;
+    }
+
+    char self[PATH_MAX];
+    ssize_t selfLength = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (selfLength <= 0) return 1;
+    std::string dexPath = std::string(checkbeer::AppCodeDirectory(std::string_view(self, static_cast<size_t>(selfLength))))
+            + "AllocBench.dex";
+    void* dex = MapScratchDex(dexPath);
+    if (!dex) {
+        fprintf(stderr, "cannot map %s\n", dexPath.c_str());
+        return 1;
+    }
+
+    const char* tracePath = "AllocBench.trace";
+    gCheckLogsMuted = true;
+    {
+        checkbeer::test::FakeJvm vm(sourceDir.c_str(), libraryDir.c_str());
+        recordSignatureBypass(vm.env(), vm.context(), tracePath);
+    }
+
+    jni::ReplayEnv replay;
+    if (!replay.load(tracePath)) {
+        fprintf(stderr, "cannot load %s\n", tracePath);
+        return 1;
+    }
+    const std::vector<uint64_t>* contextMeta = replay.meta(CHECK_TRACE_META_CONTEXT);
+    jobject context = contextMeta && !contextMeta->empty() ? jni::detail::FromWord<jobject>((*contextMeta)[0]) : nullptr;
+
+    uint64_t allocations[checkbeer::kCheckCount] = {};
+    uint64_t bytes[checkbeer::kCheckCount] = {};
+    bool finished = true;
+    for (int run = 0; run < kWarmupRuns + runs; run++) {
+        replay.rewind();
+        try {
+            checkbeer::ScopedCheckBindings bindings(replay.get());
+            checkSignatureBypass(replay.get(), context);
+        } catch (const std::exception&) {
+            // Shows up as an unfinished replay below
+        }
+        finished &= replay.finished();
+        if (run < kWarmupRuns) continue;
+
+        // checkSignatureBypass restarts the profile, so it holds this run only
+        checkbeer::AllocSiteStats sites[checkbeer::detail::kAllocSiteCount];
+        int count = checkbeer::GetAllocProfile(sites, checkbeer::detail::kAllocSiteCount);
+        for (int id = 0; id < checkbeer::kCheckCount; id++) {
+            const char* name = checkbeer::CheckName(static_cast<checkbeer::CheckId>(id));
+            for (int i = 0; i < count; i++) {
+                if (strcmp(sites[i].name, name) != 0) continue;
+                allocations[id] += sites[i].allocations;
+                bytes[id] += sites[i].bytes;
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    printf("%-28s %12s %12s\n", "check", "allocs/run", "bytes/run");
+    for (int id = 0; id < checkbeer::kCheckCount; id++) {
+        printf("%-28s %12.2f %12.1f\n", checkbeer::CheckName(static_cast<checkbeer::CheckId>(id)),
+               static_cast<double>(allocations[id]) / runs, static_cast<double>(bytes[id]) / runs);
+        total += allocations[id];
+    }
+    printf("%d runs after %d warm-up runs, %" PRIu64 " allocations\n", runs, kWarmupRuns, total);
+
+    remove(tracePath);
+    munmap(dex, kDexSize);
+    remove(dexPath.c_str());
+    remove(sourceDir.c_str());
+    rmdir(libraryDir.c_str());
+    rmdir((appDir + "/lib").c_str());
+    rmdir(appDir.c_str());
+
+    if (!finished) fprintf(stderr, "the replay diverged from the recorded trace\n");
+    return finished && total == 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+// Host runner for RunKernelBenchmark and RunPatternSetBenchmark: times every
+// hashing/scanning kernel variant this CPU supports against the portable one,
+// then the multi-pattern matcher against std::string::find loops.
+//
+//     KernelBench [bufferKiB] [mapsLines]
+#include <cstdio>
+#include <cstdlib>
+
+#include "KernelBenchmark.hpp"
+
+int main(int argc, char** argv) {
+    size_t bufferBytes = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024) << 10;
+    size_t lineCount = argc > 2 ? strtoul(argv[2], nullptr, 10) : 8000;
+
+    static char buffer[8192];
+    bool ok = checkbeer::RunKernelBenchmark(buffer, sizeof(buffer), bufferBytes);
+    fputs(buffer, stdout);
+    if (!ok) fprintf(stderr, "a kernel variant disagreed with the portable one\n");
+
+    bool patternsOk = checkbeer::RunPatternSetBenchmark(buffer, sizeof(buffer), lineCount);
+    fputs(buffer, stdout);
+    if (!patternsOk) fprintf(stderr, "PatternSet disagreed with the find loops\n");
+    return ok && patternsOk ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CheckMetrics.hpp"
+#include "Kernels.hpp"
+#include "PatternSet.hpp"
+
+namespace checkbeer {
+
+    namespace detail {
+
+        // Best of a few passes over the buffer, in MB/s
+        template <typename F>
+        double MeasureThroughput(size_t bytes, int passes, F&& pass) {
+            int64_t best = INT64_MAX;
+            for (int i = 0; i < passes; i++) {
+                int64_t start = MonotonicNs();
+                pass();
+                int64_t elapsed = MonotonicNs() - start;
+                if (elapsed < best) best = elapsed;
+            }
+            return best > 0 ? static_cast<double>(bytes) * 1000.0 / static_cast<double>(best) : 0.0;
+        }
+
+    } // namespace detail
+
+    // Run every kernel variant this CPU supports over bufferSize bytes of
+    // pseudo-random data, check each against the portable variant and report
+    // throughput. The dispatched choice is marked with '*'. Returns false if
+    // any variant disagreed with the portable one.
+    inline bool RunKernelBenchmark(char* buffer, size_t size, size_t bufferSize = 1 << 20) {
+        if (size == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        uint32_t features = GetCpuFeatures();
+        const Kernels& selected = GetKernels();
+        char featureNames[128];
+        FormatCpuFeatures(features, featureNames, sizeof(featureNames));
+        append("cpu features: %s\n", featureNames[0] ? featureNames : "none");
+        append("%-14s %-12s %10s %s\n", "kernel", "variant", "MB/s", "result");
+
+        // Printable data keeps the scanners from stopping early on a stray match
+        std::vector<uint8_t> data(bufferSize);
+        uint32_t seed = 0x12345678;
+        for (uint8_t& byte : data) {
+            seed = seed * 1664525 + 1013904223;
+            byte = static_cast<uint8_t>('a' + (seed >> 24) % 26);
+        }
+        // Starts with a common letter, as the strings the scanners look for do
+        const uint8_t needle[] = "needle/with/some/length#";
+        const size_t needleLength = sizeof(needle) - 1;
+        if (bufferSize > needleLength + 1) std::memcpy(&data[bufferSize - needleLength - 1], needle, needleLength);
+        ByteSet set;
+        set.add('#');
+        set.add('/');
+        set.add(0xFF);
+
+        bool allMatch = true;
+        auto row = [&](const char* kernel, const char* variant, bool isSelected, double mbps, bool match) {
+            allMatch &= match;
+            append("%-14s %c%-11s %10.0f %s\n", kernel, isSelected ? '*' : ' ', variant, mbps, match ? "ok" : "MISMATCH");
+        };
+        auto supported = [&](uint32_t required) { return (required & features) == required; };
+        const int passes = 5;
+
+        uint8_t reference[Sha256::kDigestSize];
+        Sha256 portable(detail::Sha256BlocksScalar);
+        portable.update(data.data(), data.size());
+        portable.final(reference);
+        for (const auto& variant : kSha256Variants) {
+            if (!supported(variant.features)) continue;
+            uint8_t digest[Sha256::kDigestSize];
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                Sha256 sha(variant.fn);
+                sha.update(data.data(), data.size());
+                sha.final(digest);
+            });
+            row("sha256", variant.name, variant.fn == selected.sha256.fn, mbps,
+                std::memcmp(digest, reference, sizeof(digest)) == 0);
+        }
+
+        uint32_t crcReference = detail::Crc32cScalar(0, data.data(), data.size());
+        for (const auto& variant : kCrc32cVariants) {
+            if (!supported(variant.features)) continue;
+            uint32_t crc = 0;
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                crc = variant.fn(0, data.data(), data.size());
+            });
+            row("crc32c", variant.name, variant.fn == selected.crc32c.fn, mbps, crc == crcReference);
+        }
+
+        const uint8_t* memchrReference = detail::MemchrLibc(data.data(), data.size(), '#');
+        for (const auto& variant : kMemchrVariants) {
+            if (!supported(variant.features)) continue;
+            const uint8_t* found = nullptr;
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                found = variant.fn(data.data(), data.size(), '#');
+            });
+            row("memchr", variant.name, variant.fn == selected.memchr.fn, mbps, found == memchrReference);
+        }
+
+        const uint8_t* memmemReference = detail::MemmemScalar(data.data(), data.size(), needle, needleLength);
+        for (const auto& variant : kMemmemVariants) {
+            if (!supported(variant.features)) continue;
+            const uint8_t* found = nullptr;
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                found = variant.fn(data.data(), data.size(), needle, needleLength);
+            });
+            row("memmem", variant.name, variant.fn == selected.memmem.fn, mbps, found == memmemReference);
+        }
+
+        const uint8_t* byteSetReference = detail::FindAnyByteScalar(data.data(), data.size(), set);
+        for (const auto& variant : kByteSetVariants) {
+            if (!supported(variant.features)) continue;
+            const uint8_t* found = nullptr;
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                found = variant.fn(data.data(), data.size(), set);
+            });
+            row("byte-set", variant.name, variant.fn == selected.findAnyByte.fn, mbps, found == byteSetReference);
+        }
+
+        ByteSet second;
+        second.add('/');
+        second.add(0xFE);
+        const uint8_t* pairReference = detail::FindBytePairScalar(data.data(), data.size(), set, second);
+        for (const auto& variant : kBytePairVariants) {
+            if (!supported(variant.features)) continue;
+            const uint8_t* found = nullptr;
+            double mbps = detail::MeasureThroughput(data.size(), passes, [&] {
+                found = variant.fn(data.data(), data.size(), set, second);
+            });
+            row("byte-pair", variant.name, variant.fn == selected.findBytePair.fn, mbps, found == pairReference);
+        }
+
+        return allMatch;
+    }
+
+    // Scan maps-like text for a set of library names with PatternSet under
+    // each prefilter, and with the per-pattern std::string::find loops the
+    // checks used before. Reports GB/s; returns false if the match counts
+    // disagree.
+    inline bool RunPatternSetBenchmark(char* buffer, size_t size, size_t lineCount = 8000) {
+        if (size == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        static const char* const kNames[] = {
+                "frida", "gum-js-loop", "gadget", "linjector", "xposed", "lspd", "lsposed", "lspatch",
+                "npatch", "edxp", "riru", "zygisk", "magisk", "substrate", "libsandhook", "libpine",
+                "libwhale", "libdobby", "/data/local/tmp/",
+        };
+        PatternSet patterns = {
+                kNames[0], kNames[1], kNames[2], kNames[3], kNames[4], kNames[5], kNames[6], kNames[7],
+                kNames[8], kNames[9], kNames[10], kNames[11], kNames[12], kNames[13], kNames[14], kNames[15],
+                kNames[16], kNames[17], kNames[18],
+        };
+
+        std::string text;
+        text.reserve(lineCount * 96);
+        char line[160];
+        for (size_t i = 0; i < lineCount; i++) {
+            unsigned long long start = 0x7000000000ull + i * 0x10000;
+            if (i % 3 == 0) {
+                snprintf(line, sizeof(line), "%llx-%llx r-xp 00000000 fd:05 %zu                     /system/lib64/libandroid_runtime%zu.so\n",
+                         start, start + 0x1000, 1000 + i, i % 50);
+            } else {
+                snprintf(line, sizeof(line), "%llx-%llx rw-p 00000000 00:00 0 \n", start, start + 0x1000);
+            }
+            text += line;
+            if (i == lineCount / 2) text += "7fff0000-7fff1000 r-xp 00000000 fd:05 42 /data/local/tmp/frida-gadget.so\n";
+        }
+
+        const int passes = 5;
+        auto gbps = [&](double mbps) { return mbps / 1000.0; };
+        append("pattern set: %zu patterns, %zu states, %zu byte classes, %zu KiB text\n",
+               patterns.size(), patterns.stateCount(), patterns.classCount(), text.size() >> 10);
+        append("%-22s %8s %8s\n", "matcher", "GB/s", "matches");
+
+        size_t reference = 0;
+        double naive = detail::MeasureThroughput(text.size(), passes, [&] {
+            reference = 0;
+            for (const char* name : kNames) {
+                for (size_t at = text.find(name); at != std::string::npos; at = text.find(name, at + 1)) reference++;
+            }
+        });
+        append("%-22s %8.2f %8zu\n", "std::string::find", gbps(naive), reference);
+
+        bool allMatch = true;
+        static const struct {
+            PatternSet::Prefilter prefilter;
+            const char* name;
+        } modes[] = {
+                {PatternSet::Prefilter::None, "aho-corasick"},
+                {PatternSet::Prefilter::FirstByte, "aho-corasick+byte"},
+                {PatternSet::Prefilter::BytePair, "aho-corasick+pair"},
+        };
+        for (const auto& mode : modes) {
+            patterns.setPrefilter(mode.prefilter);
+            size_t found = 0;
+            double mbps = detail::MeasureThroughput(text.size(), passes, [&] {
+                found = 0;
+                patterns.scan(text, [&](size_t, size_t) {
+                    found++;
+                    return true;
+                });
+            });
+            allMatch &= found == reference;
+            append("%-22s %8.2f %8zu %s\n", mode.name, gbps(mbps), found, found == reference ? "ok" : "MISMATCH");
+        }
+        return allMatch;
+    }
+
+} // namespace checkbeer
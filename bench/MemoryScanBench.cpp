@@ -0,0 +1,18 @@
+// Host runner for RunMemoryScanBenchmark: scans this process for a
+// signature planted at the tail of a fresh mapping.
+//
+//     MemoryScanBench [regionMiB]
+#include <cstdio>
+#include <cstdlib>
+
+#include "MemoryScanBenchmark.hpp"
+
+int main(int argc, char** argv) {
+    size_t regionBytes = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 64) << 20;
+
+    static char buffer[8192];
+    bool ok = checkbeer::RunMemoryScanBenchmark(buffer, sizeof(buffer), regionBytes);
+    fputs(buffer, stdout);
+    if (!ok) fprintf(stderr, "the planted signature was missed\n");
+    return ok ? 0 : 1;
+}
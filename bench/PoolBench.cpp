@@ -0,0 +1,19 @@
+// Host runner for RunPoolBenchmark: hashes a shared buffer on pools of
+// different shapes and prints the table.
+//
+//     PoolBench [taskCount] [taskKiB]
+#include <cstdio>
+#include <cstdlib>
+
+#include "PoolBenchmark.hpp"
+
+int main(int argc, char** argv) {
+    size_t taskCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+    size_t taskBytes = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 256) << 10;
+
+    static char buffer[8192];
+    bool ok = checkbeer::RunPoolBenchmark(buffer, sizeof(buffer), taskCount, taskBytes);
+    fputs(buffer, stdout);
+    if (!ok) fprintf(stderr, "pool digests disagree with the reference\n");
+    return ok ? 0 : 1;
+}
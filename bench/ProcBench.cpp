@@ -0,0 +1,22 @@
+// Host runner for RunProcBenchmark and RunMappingIndexBenchmark. Both write
+// their input to a scratch file in the working directory.
+//
+//     ProcBench [lineCount]
+#include <cstdio>
+#include <cstdlib>
+
+#include "ProcBenchmark.hpp"
+
+int main(int argc, char** argv) {
+    size_t lineCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000;
+
+    static char buffer[8192];
+    bool parsed = checkbeer::RunProcBenchmark(buffer, sizeof(buffer), "ProcBench.maps", lineCount);
+    fputs(buffer, stdout);
+    if (!parsed) fprintf(stderr, "MapsReader disagrees with the getline + sscanf parse\n");
+
+    bool indexed = checkbeer::RunMappingIndexBenchmark(buffer, sizeof(buffer), "ProcBench.maps", lineCount);
+    fputs(buffer, stdout);
+    if (!indexed) fprintf(stderr, "MappingIndex lookups disagree\n");
+    return parsed && indexed ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+// Host runner for soakSignatureBypass: replays a recorded trace over and
+// over and judges local-reference, RSS and latency growth. maxP99Growth
+// overrides the allowed late-over-early p99 growth (default 0.25), for
+// hosts too noisy to hold the default. Per-check timing is on, and the
+// cold-start table (first run against the steady-state mean) follows the
+// soak report.
+//
+//     SoakBench <trace> [iterations] [maxP99Growth]
+#include <cstdlib>
+
+#include "SignatureCheck.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace> [iterations] [maxP99Growth]\n", argv[0]);
+        return 2;
+    }
+    uint64_t iterations = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+    checkbeer::SoakLimits limits;
+    if (argc > 3) limits.maxP99Growth = strtod(argv[3], nullptr);
+
+    checkbeer::SetMeasurementEnabled(true);
+    static char report[4096];
+    bool passed = soakSignatureBypass(argv[1], iterations, report, sizeof(report), limits);
+    fputs(report, stdout);
+
+    checkbeer::FormatColdStartStats(checkbeer::GetColdStartStats(), report, sizeof(report));
+    fputs(report, stdout);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "Trace.hpp"
+
+// 1 (bench builds) attributes heap allocations to CHECK_ALLOC_SCOPE regions.
+// The allocation hooks themselves live in SignatureCheck.hpp.
+#ifndef CHECK_ALLOC_PROFILE
+#define CHECK_ALLOC_PROFILE 0
+#endif
+
+namespace checkbeer {
+
+    // Totals for one named scope, inclusive of the scopes nested in it
+    struct AllocSiteStats {
+        const char* name;
+        uint64_t entries;
+        uint64_t allocations;
+        uint64_t bytes;
+        int64_t peakBytes;     // highest net footprint reached inside one entry
+        int64_t retainedBytes; // net bytes still allocated when entries ended
+    };
+
+    namespace detail {
+
+        constexpr int kAllocSiteCount = 64;
+
+        struct AllocSite {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<uint64_t> entries{0};
+            std::atomic<uint64_t> allocations{0};
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<int64_t> peakBytes{0};
+            std::atomic<int64_t> retainedBytes{0};
+        };
+
+        struct AllocScopeState;
+
+        // Trivially constructible so the hooks never run a TLS initialiser
+        struct ThreadAllocState {
+            int64_t liveBytes;
+            AllocScopeState* top;
+        };
+
+        struct AllocScopeState {
+            AllocSite* site;
+            AllocScopeState* parent;
+            int64_t baseBytes;
+            int64_t peakBytes;
+            uint64_t allocations;
+            uint64_t bytes;
+        };
+
+        inline AllocSite gAllocSites[kAllocSiteCount];
+        inline std::atomic<int64_t> gAllocLiveBytes{0};
+        inline std::atomic<int64_t> gAllocPeakBytes{0};
+        inline thread_local ThreadAllocState tAllocState;
+
+        // Sites are keyed by the address of their name literal; the table is
+        // append-only, and a full table folds new names into the last slot
+        inline AllocSite* FindAllocSite(const char* name) {
+            size_t start = (reinterpret_cast<uintptr_t>(name) >> 3) % kAllocSiteCount;
+            for (int probe = 0; probe < kAllocSiteCount; probe++) {
+                AllocSite& site = gAllocSites[(start + probe) % kAllocSiteCount];
+                const char* current = site.name.load(std::memory_order_acquire);
+                if (current == name) return &site;
+                if (current == nullptr) {
+                    if (site.name.compare_exchange_strong(current, name, std::memory_order_acq_rel)) return &site;
+                    if (current == name) return &site;
+                }
+            }
+            return &gAllocSites[kAllocSiteCount - 1];
+        }
+
+        inline void AtomicMax(std::atomic<int64_t>& target, int64_t value) {
+            int64_t seen = target.load(std::memory_order_relaxed);
+            while (value > seen && !target.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+        }
+
+        // Called by the hooks with the usable size of the block
+        inline void OnAlloc(size_t size) {
+            ThreadAllocState& t = tAllocState;
+            int64_t n = static_cast<int64_t>(size);
+            t.liveBytes += n;
+            AtomicMax(gAllocPeakBytes, gAllocLiveBytes.fetch_add(n, std::memory_order_relaxed) + n);
+
+            AllocScopeState* scope = t.top;
+            if (!scope) return;
+            scope->allocations++;
+            scope->bytes += size;
+            if (t.liveBytes > scope->peakBytes) scope->peakBytes = t.liveBytes;
+        }
+
+        inline void OnFree(size_t size) {
+            ThreadAllocState& t = tAllocState;
+            int64_t n = static_cast<int64_t>(size);
+            t.liveBytes -= n;
+            gAllocLiveBytes.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+    } // namespace detail
+
+    // RAII attribution scope; name must have static storage duration. Frees
+    // count against the thread, not the scope that allocated the block.
+    class AllocScope {
+    public:
+        explicit AllocScope(const char* name) {
+            detail::ThreadAllocState& t = detail::tAllocState;
+            state_.site = detail::FindAllocSite(name);
+            state_.parent = t.top;
+            state_.baseBytes = t.liveBytes;
+            state_.peakBytes = t.liveBytes;
+            state_.allocations = 0;
+            state_.bytes = 0;
+            t.top = &state_;
+        }
+
+        ~AllocScope() {
+            detail::ThreadAllocState& t = detail::tAllocState;
+            t.top = state_.parent;
+
+            detail::AllocSite* site = state_.site;
+            site->entries.fetch_add(1, std::memory_order_relaxed);
+            site->allocations.fetch_add(state_.allocations, std::memory_order_relaxed);
+            site->bytes.fetch_add(state_.bytes, std::memory_order_relaxed);
+            site->retainedBytes.fetch_add(t.liveBytes - state_.baseBytes, std::memory_order_relaxed);
+            detail::AtomicMax(site->peakBytes, state_.peakBytes - state_.baseBytes);
+
+            if (detail::AllocScopeState* parent = state_.parent) {
+                parent->allocations += state_.allocations;
+                parent->bytes += state_.bytes;
+                if (state_.peakBytes > parent->peakBytes) parent->peakBytes = state_.peakBytes;
+            }
+        }
+
+        // Disable copy
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator=(const AllocScope&) = delete;
+
+    private:
+        detail::AllocScopeState state_;
+    };
+
+    // Copy out every site that has been entered; returns the number written
+    inline int GetAllocProfile(AllocSiteStats* out, int capacity) {
+        int count = 0;
+        for (const detail::AllocSite& site : detail::gAllocSites) {
+            const char* name = site.name.load(std::memory_order_acquire);
+            uint64_t entries = site.entries.load(std::memory_order_relaxed);
+            if (!name || entries == 0 || count >= capacity) continue;
+            out[count++] = {name, entries,
+                            site.allocations.load(std::memory_order_relaxed),
+                            site.bytes.load(std::memory_order_relaxed),
+                            site.peakBytes.load(std::memory_order_relaxed),
+                            site.retainedBytes.load(std::memory_order_relaxed)};
+        }
+        return count;
+    }
+
+    // Process-wide peak of profiled heap bytes since the last reset
+    inline int64_t GetAllocPeakBytes() {
+        return detail::gAllocPeakBytes.load(std::memory_order_relaxed);
+    }
+
+    // Clear the per-site totals and restart the peak from the current footprint
+    inline void ResetAllocProfile() {
+        for (detail::AllocSite& site : detail::gAllocSites) {
+            site.entries.store(0, std::memory_order_relaxed);
+            site.allocations.store(0, std::memory_order_relaxed);
+            site.bytes.store(0, std::memory_order_relaxed);
+            site.peakBytes.store(0, std::memory_order_relaxed);
+            site.retainedBytes.store(0, std::memory_order_relaxed);
+        }
+        detail::gAllocPeakBytes.store(detail::gAllocLiveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    inline size_t FormatAllocProfile(char* buffer, size_t size) {
+        if (size == 0) return 0;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        AllocSiteStats sites[detail::kAllocSiteCount];
+        int count = GetAllocProfile(sites, detail::kAllocSiteCount);
+
+        append("heap peak: %" PRId64 " bytes, live: %" PRId64 " bytes\n",
+               GetAllocPeakBytes(), detail::gAllocLiveBytes.load(std::memory_order_relaxed));
+        append("%-28s %7s %8s %10s %10s %10s\n", "scope", "entries", "allocs", "bytes", "peak", "retained");
+        for (int i = 0; i < count; i++) {
+            const AllocSiteStats& s = sites[i];
+            append("%-28s %7" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRId64 " %10" PRId64 "\n",
+                   s.name, s.entries, s.allocations, s.bytes, s.peakBytes, s.retainedBytes);
+        }
+        return len < size ? len : size - 1;
+    }
+
+} // namespace checkbeer
+
+// Attribute the enclosing scope's allocations to name
+#if CHECK_ALLOC_PROFILE
+#define CHECK_ALLOC_SCOPE(name) checkbeer::AllocScope CHECK_TRACE_CONCAT(checkAllocScope_, __LINE__)(name)
+#else
+#define CHECK_ALLOC_SCOPE(name) do {} while (0)
+#endif
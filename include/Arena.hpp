@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+namespace checkbeer {
+
+    // Monotonic bump allocator for per-run temporaries. Memory is handed out
+    // from an initial caller-provided block and, once that is exhausted, from
+    // chained heap blocks. Nothing is freed individually; reset() rewinds the
+    // whole arena at once.
+    class MonotonicArena {
+    public:
+        MonotonicArena(void* initial, size_t size)
+                : initial_(static_cast<unsigned char*>(initial)), initialSize_(size),
+                  cur_(initial_), end_(initial_ + size) {}
+
+        ~MonotonicArena() { freeBlocks(); }
+
+        // Allocate raw storage, never returns nullptr
+        void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+            unsigned char* p = alignUp(cur_, align);
+            if (p > end_ || static_cast<size_t>(end_ - p) < bytes) {
+                grow(bytes + align);
+                p = alignUp(cur_, align);
+            }
+            cur_ = p + bytes;
+            used_ += bytes;
+            return p;
+        }
+
+        // Copy a character range into the arena; the result is NUL-terminated
+        std::string_view copy(const char* str, size_t len) {
+            char* dst = static_cast<char*>(allocate(len + 1, 1));
+            if (len) std::memcpy(dst, str, len);
+            dst[len] = '\0';
+            return {dst, len};
+        }
+
+        std::string_view copy(std::string_view str) { return copy(str.data(), str.size()); }
+
+        // Rewind to the initial block. Heap blocks are only touched if the run
+        // overflowed, so on the common path this is a couple of stores.
+        void reset() {
+            if (blocks_) freeBlocks();
+            cur_ = initial_;
+            end_ = initial_ + initialSize_;
+            used_ = 0;
+        }
+
+        size_t bytesUsed() const { return used_; }
+
+        // Number of heap allocations made since construction
+        size_t heapAllocations() const { return heapAllocations_; }
+
+        // Disable copy
+        MonotonicArena(const MonotonicArena&) = delete;
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    private:
+        struct Block {
+            Block* next;
+            size_t size;
+        };
+
+        static unsigned char* alignUp(unsigned char* p, size_t align) {
+            uintptr_t v = reinterpret_cast<uintptr_t>(p);
+            return reinterpret_cast<unsigned char*>((v + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        void grow(size_t minBytes) {
+            size_t size = nextBlockSize_;
+            while (size < minBytes + sizeof(Block)) size *= 2;
+            nextBlockSize_ = size * 2;
+
+            Block* block = static_cast<Block*>(std::malloc(size));
+            if (!block) throw std::bad_alloc();
+            ++heapAllocations_;
+
+            block->next = blocks_;
+            block->size = size;
+            blocks_ = block;
+            cur_ = reinterpret_cast<unsigned char*>(block + 1);
+            end_ = reinterpret_cast<unsigned char*>(block) + size;
+        }
+
+        void freeBlocks() {
+            while (blocks_) {
+                Block* next = blocks_->next;
+                std::free(blocks_);
+                blocks_ = next;
+            }
+        }
+
+        unsigned char* initial_;
+        size_t initialSize_;
+        unsigned char* cur_;
+        unsigned char* end_;
+        Block* blocks_ = nullptr;
+        size_t used_ = 0;
+        size_t heapAllocations_ = 0;
+        size_t nextBlockSize_ = 4096;
+    };
+
+    // Arena whose first block lives inside the object, meant to be declared
+    // as a local so the common case never reaches the heap
+    template <size_t N>
+    class StackArena : public MonotonicArena {
+    public:
+        StackArena() : MonotonicArena(buffer_, N) {}
+
+    private:
+        alignas(std::max_align_t) unsigned char buffer_[N];
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <jni.h>
+#include <mutex>
+
+#include "CheckMetrics.hpp"
+#include "JNIHelper.hpp"
+
+namespace checkbeer {
+
+    // Every class, method ID and field ID used by SignatureCheck.hpp. Classes
+    // are held as global references so the IDs stay valid across threads.
+    struct CheckBindings {
+        // android.content.pm.PackageInfo
+        jclass packageInfoClass = nullptr;
+        jfieldID packageInfoCreator = nullptr;
+
+        // java.lang.Object / java.lang.Class
+        jmethodID objectGetClass = nullptr;
+        jmethodID objectToString = nullptr;
+        jmethodID classGetName = nullptr;
+        jmethodID classGetDeclaredFields = nullptr;
+        jmethodID classGetDeclaredField = nullptr;
+        jmethodID classGetClassLoader = nullptr;
+
+        // java.lang.ClassLoader
+        jclass classLoaderClass = nullptr;
+        jmethodID classLoaderGetSystemClassLoader = nullptr;
+
+        // java.lang.reflect.Field
+        jmethodID fieldGetName = nullptr;
+        jmethodID fieldSetAccessible = nullptr;
+        jmethodID fieldGet = nullptr;
+
+        // android.content.Context
+        jmethodID contextGetPackageManager = nullptr;
+        jmethodID contextGetApplicationInfo = nullptr;
+        jmethodID contextGetPackageName = nullptr;
+        jmethodID contextGetPackageResourcePath = nullptr;
+        jmethodID contextGetPackageCodePath = nullptr;
+
+        // android.content.pm.PackageManager
+        jmethodID packageManagerGetApplicationInfo = nullptr;
+
+        // android.content.pm.ApplicationInfo
+        jfieldID applicationInfoSourceDir = nullptr;
+        jfieldID applicationInfoPublicSourceDir = nullptr;
+        jfieldID applicationInfoAppComponentFactory = nullptr;  // API 28+, may be null
+        jfieldID applicationInfoSplitSourceDirs = nullptr;
+        jfieldID applicationInfoNativeLibraryDir = nullptr;
+
+        // android.app.ActivityThread (hidden API, may be null)
+        jclass activityThreadClass = nullptr;
+        jmethodID activityThreadCurrentActivityThread = nullptr;
+        jfieldID activityThreadInitialApplication = nullptr;
+
+        void resolve(JNIEnv* env);
+        void release(JNIEnv* env);
+    };
+
+    namespace detail {
+
+        inline jclass FindGlobalClass(JNIEnv* env, const char* className) {
+            jni::ScopedLocalRef<jclass> cls(env, jni::FindClass(env, className));
+            return static_cast<jclass>(env->NewGlobalRef(cls.get()));
+        }
+
+        // Lookups for members that are not guaranteed to exist (hidden or newer
+        // API). A missing member leaves a null ID instead of failing the resolve.
+        inline void ClearPendingException(JNIEnv* env) {
+            if (env->ExceptionCheck()) env->ExceptionClear();
+        }
+
+        inline jclass FindOptionalGlobalClass(JNIEnv* env, const char* className) {
+            jclass cls = env->FindClass(className);
+            if (!cls) {
+                ClearPendingException(env);
+                return nullptr;
+            }
+            jclass global = static_cast<jclass>(env->NewGlobalRef(cls));
+            env->DeleteLocalRef(cls);
+            return global;
+        }
+
+        inline jfieldID GetOptionalFieldID(JNIEnv* env, jclass cls, const char* fieldName, const char* signature) {
+            if (!cls) return nullptr;
+            jfieldID fid = env->GetFieldID(cls, fieldName, signature);
+            ClearPendingException(env);
+            return fid;
+        }
+
+        inline jmethodID GetOptionalStaticMethodID(JNIEnv* env, jclass cls, const char* methodName, const char* signature) {
+            if (!cls) return nullptr;
+            jmethodID mid = env->GetStaticMethodID(cls, methodName, signature);
+            ClearPendingException(env);
+            return mid;
+        }
+
+    } // namespace detail
+
+    inline void CheckBindings::resolve(JNIEnv* env) {
+        using namespace detail;
+
+        packageInfoClass = FindGlobalClass(env, "android/content/pm/PackageInfo");
+        packageInfoCreator = jni::GetStaticFieldID(env, packageInfoClass, "CREATOR", "Landroid/os/Parcelable$Creator;");
+
+        {
+            jni::ScopedLocalRef<jclass> objectClass(env, jni::FindClass(env, "java/lang/Object"));
+            objectGetClass = jni::GetMethodID(env, objectClass.get(), "getClass", "()Ljava/lang/Class;");
+            objectToString = jni::GetMethodID(env, objectClass.get(), "toString", "()Ljava/lang/String;");
+        }
+        {
+            jni::ScopedLocalRef<jclass> classClass(env, jni::FindClass(env, "java/lang/Class"));
+            classGetName = jni::GetMethodID(env, classClass.get(), "getName", "()Ljava/lang/String;");
+            classGetDeclaredFields = jni::GetMethodID(env, classClass.get(), "getDeclaredFields", "()[Ljava/lang/reflect/Field;");
+            classGetDeclaredField = jni::GetMethodID(env, classClass.get(), "getDeclaredField", "(Ljava/lang/String;)Ljava/lang/reflect/Field;");
+            classGetClassLoader = jni::GetMethodID(env, classClass.get(), "getClassLoader", "()Ljava/lang/ClassLoader;");
+        }
+
+        classLoaderClass = FindGlobalClass(env, "java/lang/ClassLoader");
+        classLoaderGetSystemClassLoader = jni::GetStaticMethodID(env, classLoaderClass, "getSystemClassLoader", "()Ljava/lang/ClassLoader;");
+
+        {
+            jni::ScopedLocalRef<jclass> fieldClass(env, jni::FindClass(env, "java/lang/reflect/Field"));
+            fieldGetName = jni::GetMethodID(env, fieldClass.get(), "getName", "()Ljava/lang/String;");
+            fieldSetAccessible = jni::GetMethodID(env, fieldClass.get(), "setAccessible", "(Z)V");
+            fieldGet = jni::GetMethodID(env, fieldClass.get(), "get", "(Ljava/lang/Object;)Ljava/lang/Object;");
+        }
+        {
+            jni::ScopedLocalRef<jclass> contextClass(env, jni::FindClass(env, "android/content/Context"));
+            contextGetPackageManager = jni::GetMethodID(env, contextClass.get(), "getPackageManager", "()Landroid/content/pm/PackageManager;");
+            contextGetApplicationInfo = jni::GetMethodID(env, contextClass.get(), "getApplicationInfo", "()Landroid/content/pm/ApplicationInfo;");
+            contextGetPackageName = jni::GetMethodID(env, contextClass.get(), "getPackageName", "()Ljava/lang/String;");
+            contextGetPackageResourcePath = jni::GetMethodID(env, contextClass.get(), "getPackageResourcePath", "()Ljava/lang/String;");
+            contextGetPackageCodePath = jni::GetMethodID(env, contextClass.get(), "getPackageCodePath", "()Ljava/lang/String;");
+        }
+        {
+            jni::ScopedLocalRef<jclass> packageManagerClass(env, jni::FindClass(env, "android/content/pm/PackageManager"));
+            packageManagerGetApplicationInfo = jni::GetMethodID(env, packageManagerClass.get(), "getApplicationInfo",
+                                                                "(Ljava/lang/String;I)Landroid/content/pm/ApplicationInfo;");
+        }
+        {
+            jni::ScopedLocalRef<jclass> applicationInfoClass(env, jni::FindClass(env, "android/content/pm/ApplicationInfo"));
+            applicationInfoSourceDir = jni::GetFieldID(env, applicationInfoClass.get(), "sourceDir", "Ljava/lang/String;");
+            applicationInfoPublicSourceDir = jni::GetFieldID(env, applicationInfoClass.get(), "publicSourceDir", "Ljava/lang/String;");
+            applicationInfoAppComponentFactory = GetOptionalFieldID(env, applicationInfoClass.get(), "appComponentFactory", "Ljava/lang/String;");
+            applicationInfoSplitSourceDirs = jni::GetFieldID(env, applicationInfoClass.get(), "splitSourceDirs", "[Ljava/lang/String;");
+            applicationInfoNativeLibraryDir = jni::GetFieldID(env, applicationInfoClass.get(), "nativeLibraryDir", "Ljava/lang/String;");
+        }
+
+        activityThreadClass = FindOptionalGlobalClass(env, "android/app/ActivityThread");
+        activityThreadCurrentActivityThread = GetOptionalStaticMethodID(env, activityThreadClass, "currentActivityThread", "()Landroid/app/ActivityThread;");
+        activityThreadInitialApplication = GetOptionalFieldID(env, activityThreadClass, "mInitialApplication", "Landroid/app/Application;");
+    }
+
+    inline void CheckBindings::release(JNIEnv* env) {
+        if (packageInfoClass) env->DeleteGlobalRef(packageInfoClass);
+        if (classLoaderClass) env->DeleteGlobalRef(classLoaderClass);
+        if (activityThreadClass) env->DeleteGlobalRef(activityThreadClass);
+        *this = CheckBindings();
+    }
+
+    namespace detail {
+
+        inline CheckBindings gCheckBindings;
+        inline std::once_flag gCheckBindingsOnce;
+        inline thread_local const CheckBindings* tCheckBindingsOverride = nullptr;
+        inline thread_local const JNIEnv* tCheckBindingsRealEnv = nullptr;
+
+    } // namespace detail
+
+    // Resolve the bindings on first use and return them. Safe to call from
+    // several threads; a caller racing the warm-up thread waits for it rather
+    // than resolving a second time. A failed resolve is retried on the next call.
+    inline const CheckBindings& GetCheckBindings(JNIEnv* env) {
+        if (detail::tCheckBindingsOverride) return *detail::tCheckBindingsOverride;
+        std::call_once(detail::gCheckBindingsOnce, [env] {
+            CHECK_TRACE_SPAN("resolveBindings");
+            int64_t wallStart = MonotonicNs();
+            int64_t cpuStart = ThreadCpuNs();
+
+            CheckBindings bindings;
+            try {
+                bindings.resolve(env);
+            } catch (...) {
+                bindings.release(env);
+                throw;
+            }
+            detail::gCheckBindings = bindings;
+
+            RecordWarmup(MonotonicNs() - wallStart, ThreadCpuNs() - cpuStart);
+        });
+        return detail::gCheckBindings;
+    }
+
+    // Bindings resolved through env and used by this thread's checks until the
+    // scope ends, in place of the process-wide ones. Recorded and replayed runs
+    // use this so the trace contains the lookups the checks depend on. env's
+    // own function table is ours, not the runtime's; realEnv is the VM env it
+    // wraps, if there is one, for the checks that inspect the table.
+    class ScopedCheckBindings {
+    public:
+        explicit ScopedCheckBindings(JNIEnv* env, const JNIEnv* realEnv = nullptr)
+                : env_(env), previous_(detail::tCheckBindingsOverride), previousRealEnv_(detail::tCheckBindingsRealEnv) {
+            try {
+                bindings_.resolve(env);
+            } catch (...) {
+                bindings_.release(env);
+                throw;
+            }
+            detail::tCheckBindingsOverride = &bindings_;
+            detail::tCheckBindingsRealEnv = realEnv;
+        }
+
+        ~ScopedCheckBindings() {
+            detail::tCheckBindingsOverride = previous_;
+            detail::tCheckBindingsRealEnv = previousRealEnv_;
+            bindings_.release(env_);
+        }
+
+        // Disable copy
+        ScopedCheckBindings(const ScopedCheckBindings&) = delete;
+        ScopedCheckBindings& operator=(const ScopedCheckBindings&) = delete;
+
+    private:
+        JNIEnv* env_;
+        const CheckBindings* previous_;
+        const JNIEnv* previousRealEnv_;
+        CheckBindings bindings_;
+    };
+
+    // The env whose function table belongs to the runtime: env itself, the VM
+    // env behind a ScopedCheckBindings override, or nullptr when the override
+    // wraps no VM at all, as in a replay
+    inline const JNIEnv* RuntimeEnv(const JNIEnv* env) {
+        return detail::tCheckBindingsOverride ? detail::tCheckBindingsRealEnv : env;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <time.h>
+
+#include "AllocProfile.hpp"
+#include "LatencyHistogram.hpp"
+#include "Trace.hpp"
+
+// Feed every check's wall time into a per-check latency histogram
+#ifndef CHECK_LATENCY_HISTOGRAMS
+#define CHECK_LATENCY_HISTOGRAMS 1
+#endif
+
+namespace checkbeer {
+
+    // Identifies each check for timing and reporting
+    enum class CheckId : int {
+        Creator,
+        Field,
+        Creators,
+        PMProxy,
+        AppComponentFactory,
+        ApkPaths,
+        InjectedLibraries,
+        AnonymousExecutable,
+        MemorySignatures,
+        JniFunctionTable,
+        GotHooks,
+        InlineHooks,
+        SelfIntegrity,
+        DexMappings,
+        ApkIdentity,
+        ApkMounts,
+        Count
+    };
+
+    constexpr int kCheckCount = static_cast<int>(CheckId::Count);
+
+    inline const char* CheckName(CheckId id) {
+        switch (id) {
+            case CheckId::Creator: return "checkCreator";
+            case CheckId::Field: return "checkField";
+            case CheckId::Creators: return "checkCreators";
+            case CheckId::PMProxy: return "checkPMProxy";
+            case CheckId::AppComponentFactory: return "checkAppComponentFactory";
+            case CheckId::ApkPaths: return "checkApkPaths";
+            case CheckId::InjectedLibraries: return "checkInjectedLibraries";
+            case CheckId::AnonymousExecutable: return "checkAnonymousExecutable";
+            case CheckId::MemorySignatures: return "checkMemorySignatures";
+            case CheckId::JniFunctionTable: return "checkJniFunctionTable";
+            case CheckId::GotHooks: return "checkGotHooks";
+            case CheckId::InlineHooks: return "checkInlineHooks";
+            case CheckId::SelfIntegrity: return "checkSelfIntegrity";
+            case CheckId::DexMappings: return "checkDexMappings";
+            case CheckId::ApkIdentity: return "checkApkIdentity";
+            case CheckId::ApkMounts: return "checkApkMounts";
+            default: return "unknown";
+        }
+    }
+
+    inline int64_t ClockNs(clockid_t clock) {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    inline int64_t MonotonicNs() { return ClockNs(CLOCK_MONOTONIC); }
+    inline int64_t ThreadCpuNs() { return ClockNs(CLOCK_THREAD_CPUTIME_ID); }
+
+    // First-run and steady-state cost of one check. Steady state is the mean
+    // over every run after the first.
+    struct CheckTiming {
+        uint64_t runs;
+        int64_t firstWallNs;
+        int64_t firstCpuNs;
+        int64_t steadyWallNs;
+        int64_t steadyCpuNs;
+    };
+
+    // What the library costs the app at startup. Times are -1 when the event
+    // has not happened yet; the formatted table prints them as -1 too.
+    struct ColdStartStats {
+        int64_t loadToOnLoadNs;     // library constructor to JNI_OnLoad
+        int64_t warmupWallNs;       // binding resolution, eager or lazy
+        int64_t warmupCpuNs;
+        bool measuring;             // per-check timing enabled
+        CheckTiming checks[kCheckCount];
+    };
+
+    namespace detail {
+
+        struct CheckTimingSlot {
+            std::atomic<uint64_t> runs{0};
+            std::atomic<int64_t> firstWallNs{-1};
+            std::atomic<int64_t> firstCpuNs{-1};
+            std::atomic<int64_t> steadyWallSumNs{0};
+            std::atomic<int64_t> steadyCpuSumNs{0};
+        };
+
+        struct Metrics {
+            std::atomic<int64_t> libraryLoadNs{-1};
+            std::atomic<int64_t> onLoadNs{-1};
+            std::atomic<int64_t> warmupWallNs{-1};
+            std::atomic<int64_t> warmupCpuNs{-1};
+#ifdef CHECK_MEASURE
+            std::atomic<bool> measuring{true};
+#else
+            std::atomic<bool> measuring{false};
+#endif
+            CheckTimingSlot checks[kCheckCount];
+        };
+
+        inline Metrics gMetrics;
+        inline LatencyHistogram gCheckLatency[kCheckCount];
+
+    } // namespace detail
+
+    // Per-check timing is off unless built with CHECK_MEASURE or switched on
+    // here. Load and warm-up times are always recorded; they cost a few clock reads.
+    inline void SetMeasurementEnabled(bool enabled) {
+        detail::gMetrics.measuring.store(enabled, std::memory_order_relaxed);
+    }
+
+    inline bool IsMeasurementEnabled() {
+        return detail::gMetrics.measuring.load(std::memory_order_relaxed);
+    }
+
+    inline void RecordLibraryLoad() {
+        detail::gMetrics.libraryLoadNs.store(MonotonicNs(), std::memory_order_relaxed);
+    }
+
+    inline void RecordOnLoad() {
+        detail::gMetrics.onLoadNs.store(MonotonicNs(), std::memory_order_relaxed);
+    }
+
+    inline void RecordWarmup(int64_t wallNs, int64_t cpuNs) {
+        detail::gMetrics.warmupWallNs.store(wallNs, std::memory_order_relaxed);
+        detail::gMetrics.warmupCpuNs.store(cpuNs, std::memory_order_relaxed);
+    }
+
+    inline void RecordCheck(CheckId id, int64_t wallNs, int64_t cpuNs) {
+        detail::CheckTimingSlot& slot = detail::gMetrics.checks[static_cast<int>(id)];
+        if (slot.runs.fetch_add(1, std::memory_order_relaxed) == 0) {
+            slot.firstWallNs.store(wallNs, std::memory_order_relaxed);
+            slot.firstCpuNs.store(cpuNs, std::memory_order_relaxed);
+        } else {
+            slot.steadyWallSumNs.fetch_add(wallNs, std::memory_order_relaxed);
+            slot.steadyCpuSumNs.fetch_add(cpuNs, std::memory_order_relaxed);
+        }
+    }
+
+    // Run a check. Its wall time always goes to the latency histogram; thread
+    // CPU time, which may cost a syscall, is only read when measuring.
+    template <typename F>
+    bool TimedCheck(CheckId id, F&& check) {
+        CHECK_TRACE_SPAN(CheckName(id));
+        CHECK_ALLOC_SCOPE(CheckName(id));
+        bool measuring = IsMeasurementEnabled();
+#if !CHECK_LATENCY_HISTOGRAMS
+        if (!measuring) return check();
+#endif
+
+        int64_t wallStart = MonotonicNs();
+        int64_t cpuStart = measuring ? ThreadCpuNs() : 0;
+        bool suspicious = check();
+        int64_t wallNs = MonotonicNs() - wallStart;
+
+#if CHECK_LATENCY_HISTOGRAMS
+        detail::gCheckLatency[static_cast<int>(id)].record(wallNs);
+#endif
+        if (measuring) RecordCheck(id, wallNs, ThreadCpuNs() - cpuStart);
+        return suspicious;
+    }
+
+    inline LatencySnapshot GetCheckLatency(CheckId id) {
+        return detail::gCheckLatency[static_cast<int>(id)].snapshot();
+    }
+
+    inline void ResetCheckLatency() {
+        for (auto& histogram : detail::gCheckLatency) histogram.reset();
+    }
+
+    inline ColdStartStats GetColdStartStats() {
+        const detail::Metrics& m = detail::gMetrics;
+        ColdStartStats stats;
+
+        int64_t loaded = m.libraryLoadNs.load(std::memory_order_relaxed);
+        int64_t onLoad = m.onLoadNs.load(std::memory_order_relaxed);
+        stats.loadToOnLoadNs = (loaded >= 0 && onLoad >= 0) ? onLoad - loaded : -1;
+        stats.warmupWallNs = m.warmupWallNs.load(std::memory_order_relaxed);
+        stats.warmupCpuNs = m.warmupCpuNs.load(std::memory_order_relaxed);
+        stats.measuring = m.measuring.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < kCheckCount; i++) {
+            const detail::CheckTimingSlot& slot = m.checks[i];
+            CheckTiming& timing = stats.checks[i];
+            timing.runs = slot.runs.load(std::memory_order_relaxed);
+            timing.firstWallNs = slot.firstWallNs.load(std::memory_order_relaxed);
+            timing.firstCpuNs = slot.firstCpuNs.load(std::memory_order_relaxed);
+            if (timing.runs > 1) {
+                int64_t steadyRuns = static_cast<int64_t>(timing.runs - 1);
+                timing.steadyWallNs = slot.steadyWallSumNs.load(std::memory_order_relaxed) / steadyRuns;
+                timing.steadyCpuNs = slot.steadyCpuSumNs.load(std::memory_order_relaxed) / steadyRuns;
+            } else {
+                timing.steadyWallNs = -1;
+                timing.steadyCpuNs = -1;
+            }
+        }
+        return stats;
+    }
+
+    // Render the stats as a small text table, returns the formatted length
+    inline size_t FormatColdStartStats(const ColdStartStats& stats, char* buffer, size_t size) {
+        if (size == 0) return 0;
+
+        size_t len = 0;
+        auto us = [](int64_t ns) { return ns < 0 ? ns : ns / 1000; };
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        append("load->JNI_OnLoad: %" PRId64 " us\n", us(stats.loadToOnLoadNs));
+        append("warm-up: %" PRId64 " us wall, %" PRId64 " us cpu\n", us(stats.warmupWallNs), us(stats.warmupCpuNs));
+        if (!stats.measuring) append("per-check measurement disabled\n");
+
+        append("%-26s %6s %10s %10s %10s %10s\n", "check", "runs", "first(us)", "cpu(us)", "steady(us)", "cpu(us)");
+        for (int i = 0; i < kCheckCount; i++) {
+            const CheckTiming& t = stats.checks[i];
+            append("%-26s %6" PRIu64 " %10" PRId64 " %10" PRId64 " %10" PRId64 " %10" PRId64 "\n",
+                   CheckName(static_cast<CheckId>(i)), t.runs,
+                   us(t.firstWallNs), us(t.firstCpuNs), us(t.steadyWallNs), us(t.steadyCpuNs));
+        }
+        return len < size ? len : size - 1;
+    }
+
+} // namespace checkbeer
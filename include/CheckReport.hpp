@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+#include "CheckMetrics.hpp"
+
+namespace checkbeer {
+
+    // One thing a check found, e.g. the injected library it saw mapped
+    struct CheckFinding {
+        CheckId check;
+        char detail[160];
+    };
+
+    // What a run of the checks found, beyond the suspicious bit. Fixed
+    // capacity so it can live on the stack; findings past it are counted.
+    class CheckReport {
+    public:
+        static constexpr size_t kMaxFindings = 32;
+
+        __attribute__((format(printf, 3, 4)))
+        void add(CheckId check, const char* fmt, ...) {
+            if (count_ >= kMaxFindings) {
+                dropped_++;
+                return;
+            }
+            CheckFinding& finding = findings_[count_++];
+            finding.check = check;
+            va_list args;
+            va_start(args, fmt);
+            vsnprintf(finding.detail, sizeof(finding.detail), fmt, args);
+            va_end(args);
+        }
+
+        size_t count() const { return count_; }
+        size_t dropped() const { return dropped_; }
+        const CheckFinding& operator[](size_t i) const { return findings_[i]; }
+
+        void clear() {
+            count_ = 0;
+            dropped_ = 0;
+        }
+
+        // "checkName: detail" per line
+        size_t format(char* buffer, size_t size) const {
+            if (size == 0) return 0;
+
+            size_t len = 0;
+            auto append = [&](const char* fmt, auto... args) {
+                if (len >= size) return;
+                int n = snprintf(buffer + len, size - len, fmt, args...);
+                if (n > 0) len += static_cast<size_t>(n);
+            };
+
+            buffer[0] = '\0';
+            for (size_t i = 0; i < count_; i++) {
+                append("%s: %s\n", CheckName(findings_[i].check), findings_[i].detail);
+            }
+            if (dropped_ > 0) append("(%zu more findings dropped)\n", dropped_);
+            return len < size ? len : size - 1;
+        }
+
+    private:
+        CheckFinding findings_[kMaxFindings];
+        size_t count_ = 0;
+        size_t dropped_ = 0;
+    };
+
+    namespace detail {
+        inline std::mutex gLastReportLock;
+        inline CheckReport gLastReport;
+    } // namespace detail
+
+    // Keep a copy of the latest run's report for the Kotlin side to fetch
+    inline void PublishCheckReport(const CheckReport& report) {
+        std::lock_guard<std::mutex> guard(detail::gLastReportLock);
+        detail::gLastReport = report;
+    }
+
+    inline size_t FormatLastCheckReport(char* buffer, size_t size) {
+        std::lock_guard<std::mutex> guard(detail::gLastReportLock);
+        return detail::gLastReport.format(buffer, size);
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__aarch64__) || defined(__arm__)
+#include <sys/auxv.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace checkbeer {
+
+    // Instruction set extensions the hashing and scanning kernels can use
+    enum CpuFeature : uint32_t {
+        kCpuNeon = 1u << 0,
+        kCpuArmSha2 = 1u << 1,
+        kCpuArmCrc32 = 1u << 2,
+        kCpuSse2 = 1u << 3,
+        kCpuSsse3 = 1u << 4,
+        kCpuSse41 = 1u << 5,
+        kCpuSse42 = 1u << 6,
+        kCpuShaNi = 1u << 7,
+    };
+
+    // HWCAP bits from the kernel's asm/hwcap.h, which old NDK sysroots lack
+    namespace detail {
+#if defined(__aarch64__)
+        constexpr unsigned long kHwcapAsimd = 1ul << 1;
+        constexpr unsigned long kHwcapSha2 = 1ul << 6;
+        constexpr unsigned long kHwcapCrc32 = 1ul << 7;
+#elif defined(__arm__)
+        constexpr unsigned long kHwcapNeon = 1ul << 12;
+        constexpr unsigned long kHwcap2Sha2 = 1ul << 3;
+        constexpr unsigned long kHwcap2Crc32 = 1ul << 4;
+#endif
+    } // namespace detail
+
+    // Query the CPU: getauxval on ARM, cpuid on x86 (emulators, host builds)
+    inline uint32_t DetectCpuFeatures() {
+        uint32_t features = 0;
+#if defined(__aarch64__)
+        unsigned long hwcap = getauxval(AT_HWCAP);
+        if (hwcap & detail::kHwcapAsimd) features |= kCpuNeon;
+        if (hwcap & detail::kHwcapSha2) features |= kCpuArmSha2;
+        if (hwcap & detail::kHwcapCrc32) features |= kCpuArmCrc32;
+#elif defined(__arm__)
+        unsigned long hwcap = getauxval(AT_HWCAP);
+        unsigned long hwcap2 = getauxval(AT_HWCAP2);
+        if (hwcap & detail::kHwcapNeon) features |= kCpuNeon;
+        if (hwcap2 & detail::kHwcap2Sha2) features |= kCpuArmSha2;
+        if (hwcap2 & detail::kHwcap2Crc32) features |= kCpuArmCrc32;
+#elif defined(__x86_64__) || defined(__i386__)
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            if (edx & (1u << 26)) features |= kCpuSse2;
+            if (ecx & (1u << 9)) features |= kCpuSsse3;
+            if (ecx & (1u << 19)) features |= kCpuSse41;
+            if (ecx & (1u << 20)) features |= kCpuSse42;
+        }
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            if (ebx & (1u << 29)) features |= kCpuShaNi;
+        }
+#endif
+        return features;
+    }
+
+    // Detected once; the answer cannot change while the process runs
+    inline uint32_t GetCpuFeatures() {
+        static const uint32_t features = DetectCpuFeatures();
+        return features;
+    }
+
+    inline size_t FormatCpuFeatures(uint32_t features, char* buffer, size_t size) {
+        if (size == 0) return 0;
+
+        static const struct {
+            CpuFeature feature;
+            const char* name;
+        } names[] = {
+                {kCpuNeon, "neon"}, {kCpuArmSha2, "sha2"}, {kCpuArmCrc32, "crc32"},
+                {kCpuSse2, "sse2"}, {kCpuSsse3, "ssse3"}, {kCpuSse41, "sse4.1"},
+                {kCpuSse42, "sse4.2"}, {kCpuShaNi, "sha-ni"},
+        };
+
+        size_t len = 0;
+        buffer[0] = '\0';
+        for (const auto& entry : names) {
+            if (!(features & entry.feature) || len >= size) continue;
+            int n = snprintf(buffer + len, size - len, len ? " %s" : "%s", entry.name);
+            if (n > 0) len += static_cast<size_t>(n);
+        }
+        return len < size ? len : size - 1;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <elf.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "CheckMetrics.hpp"
+#include "Kernels.hpp"
+#include "Mappings.hpp"
+#include "RawSyscall.hpp"
+#include "ThreadPool.hpp"
+
+namespace checkbeer {
+
+    // Directory holding an app's code, worked out from the path of one of
+    // its libraries: ".../com.app-1/lib/arm64/libx.so" and
+    // ".../com.app-1/base.apk" both give ".../com.app-1/"
+    inline std::string_view AppCodeDirectory(std::string_view modulePath) {
+        size_t lib = modulePath.find("/lib/");
+        if (lib != std::string_view::npos) return modulePath.substr(0, lib + 1);
+        size_t slash = modulePath.rfind('/');
+        return slash == std::string_view::npos ? std::string_view() : modulePath.substr(0, slash + 1);
+    }
+
+    // Compares the app's bytecode and compiled code as mapped in this
+    // process with the files they were mapped from. Covers .apk, .jar and
+    // .dex mappings (dex loaded straight out of the archive) and the .vdex,
+    // .odex and .oat files next to them. For ELF files only the first
+    // mapping and the code are compared, since the dynamic linker rewrites
+    // the rest.
+    //
+    // Mappings are split into 256 KiB chunks, each hashed in memory and on
+    // disk with SHA-256. The calling thread hashes chunks alongside the
+    // pool's workers rather than waiting on them, and nobody takes a new
+    // chunk once the time budget is spent, so a run overshoots it by at
+    // most one chunk; the next call resumes at the first chunk not taken. Disk
+    // digests are cached per inode and dropped when the file's size or
+    // mtime changes, so after the first pass only memory is hashed. Memory
+    // is copied out with process_vm_readv, so a dex unloaded mid-run fails
+    // the read instead of faulting. verify is not thread-safe.
+    class DexMappingVerifier {
+    public:
+        static constexpr size_t kChunkSize = 256 << 10;
+
+        struct Result {
+            size_t mappings;         // compared this run, whole or in part
+            size_t chunks;
+            size_t bytesHashed;      // in memory
+            size_t diskBytesHashed;  // cache misses
+            size_t unreadable;       // chunks whose memory or file could not be read
+            size_t replaced;         // mappings whose path now names another file
+            size_t mismatches;
+            int64_t elapsedNs;
+            bool passCompleted;
+        };
+
+        explicit DexMappingVerifier(ThreadPool& pool)
+            : pool_(pool), batchSize_((pool.size() + 1) * 4), batch_(pool) {
+            batch_.chunks.reserve(batchSize_);
+        }
+
+        // Skip one kind of file, e.g. ".vdex" where the runtime rewrites it
+        void skipExtension(std::string_view extension) { skipped_.emplace_back(extension); }
+
+        // onMismatch(std::string_view path, uintptr_t address, uint64_t
+        // fileOffset, size_t length) for each chunk that differs from its
+        // file. Only mappings under appDir are considered.
+        template <typename F>
+        Result verify(const MappingIndex& index, std::string_view appDir, int64_t budgetNs, F&& onMismatch) {
+            int64_t start = MonotonicNs();
+            int64_t deadline = start + budgetNs;
+            Result result = {};
+            std::vector<Chunk>& batch = batch_.chunks;
+            batch.clear();
+            uintptr_t lastMapping = 0;
+            bool stopped = false;
+            lastPath_.clear();
+
+            // Hash what has been gathered; past the deadline, resume at the
+            // first chunk nobody took
+            auto flush = [&] {
+                size_t hashed = hashBatch(deadline, result.chunks == 0, result, onMismatch);
+                if (hashed < batch.size()) {
+                    cursor_ = batch[hashed].address;
+                    stopped = true;
+                } else if (!batch.empty()) {
+                    cursor_ = batch.back().address + batch.back().length;
+                }
+                batch.clear();
+            };
+
+            for (size_t i = 0; i < index.size() && !stopped; i++) {
+                const MappingInfo& info = index[i];
+                if (info.end <= cursor_ || !isCandidate(index, info, appDir)) continue;
+
+                FileIdentity identity;
+                if (!identify(info, identity)) {
+                    result.replaced++;
+                    continue;
+                }
+
+                // Chunks are laid out from the start of the mapping, so a
+                // resumed run lands on the same boundaries
+                uintptr_t from = info.start;
+                if (cursor_ > from) from += (cursor_ - from + kChunkSize - 1) / kChunkSize * kChunkSize;
+                uintptr_t end = info.end;
+                if (info.offset >= identity.size) continue;
+                if (identity.size - info.offset < end - info.start) {
+                    end = info.start + static_cast<uintptr_t>(identity.size - info.offset);
+                }
+
+                for (; from < end; from += kChunkSize) {
+                    size_t length = end - from < kChunkSize ? end - from : kChunkSize;
+                    uint64_t fileOffset = info.offset + (from - info.start);
+                    batch.push_back({info.path, identity, from, fileOffset, length, {}, {}, false, false});
+                    if (info.start != lastMapping) {
+                        lastMapping = info.start;
+                        result.mappings++;
+                    }
+                    if (batch.size() < batchSize_) continue;
+
+                    flush();
+                    if (stopped) break;
+                }
+            }
+
+            if (!stopped) flush();
+            if (!stopped) {
+                cursor_ = 0;
+                passes_++;
+                lastPassMismatches_ = passMismatches_;
+                passMismatches_ = 0;
+                result.passCompleted = true;
+            }
+            result.elapsedNs = MonotonicNs() - start;
+            return result;
+        }
+
+        // Mismatches in the pass under way plus the last complete one
+        size_t recentMismatches() const { return passMismatches_ + lastPassMismatches_; }
+
+        size_t passes() const { return passes_; }
+
+        size_t cachedFiles() const {
+            std::lock_guard<std::mutex> guard(cacheLock_);
+            return cache_.size();
+        }
+
+        void reset() {
+            cursor_ = 0;
+            passMismatches_ = lastPassMismatches_ = 0;
+            std::lock_guard<std::mutex> guard(cacheLock_);
+            cache_.clear();
+        }
+
+        // Stale tasks still queued hold this; they return straight away
+        ~DexMappingVerifier() { batch_.group.wait(); }
+
+        // Disable copy
+        DexMappingVerifier(const DexMappingVerifier&) = delete;
+        DexMappingVerifier& operator=(const DexMappingVerifier&) = delete;
+
+    private:
+        struct FileIdentity {
+            uint64_t device;
+            uint64_t inode;
+            uint64_t size;
+            int64_t mtimeNs;
+        };
+
+        struct Chunk {
+            std::string_view path; // into the caller's index, NUL-terminated there
+            FileIdentity file;
+            uintptr_t address;
+            uint64_t fileOffset;
+            size_t length;
+            uint8_t memory[Sha256::kDigestSize];
+            uint8_t disk[Sha256::kDigestSize];
+            bool diskHashed;
+            bool ok;
+        };
+
+        // Chunks handed out one at a time to the caller and the workers,
+        // refilled for every batch. A worker may only get to its task after
+        // the caller has stopped handing chunks out and moved on, so tasks
+        // carry the round they were submitted for and a stale one returns
+        // without touching the chunks. The caller refills them only once no
+        // worker is inside the round.
+        struct Batch {
+            explicit Batch(ThreadPool& pool) : group(pool) {}
+
+            std::vector<Chunk> chunks;
+            std::atomic<size_t> next{0};
+            int64_t deadline = 0;
+            std::mutex lock;
+            std::condition_variable finished;
+            uint64_t round = 0;
+            size_t done = 0;
+            size_t active = 0; // threads taking chunks in this round
+            TaskGroup group;
+        };
+
+        struct Digest {
+            uint8_t bytes[Sha256::kDigestSize];
+        };
+
+        // Chunk digests of one file, valid while its identity holds
+        struct FileDigests {
+            FileIdentity identity;
+            std::map<std::pair<uint64_t, size_t>, Digest> chunks; // by (offset, length)
+        };
+
+        static bool EndsWith(std::string_view text, std::string_view suffix) {
+            return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+
+        static bool StartsWithElfMagic(const MappingInfo& info) {
+            return info.readable && std::memcmp(reinterpret_cast<const void*>(info.start), ELFMAG, SELFMAG) == 0;
+        }
+
+        bool isCandidate(const MappingIndex& index, const MappingInfo& info, std::string_view appDir) const {
+            if (info.kind != MappingKind::File || !info.readable || info.writable || info.shared) return false;
+            if (appDir.empty() || info.path.compare(0, appDir.size(), appDir) != 0) return false;
+            bool code = false;
+            for (const char* extension : {".apk", ".jar", ".dex", ".vdex", ".odex", ".oat"}) {
+                code = code || EndsWith(info.path, extension);
+            }
+            if (!code) return false;
+            for (const std::string& extension : skipped_) {
+                if (EndsWith(info.path, extension)) return false;
+            }
+
+            // As in ModuleCache, the ELF header is the nearest mapping at or
+            // before this one, from the same file, that starts with the magic
+            for (size_t i = index.indexOf(info) + 1; i-- > 0;) {
+                const MappingInfo& candidate = index[i];
+                if (candidate.path != info.path) break;
+                if (candidate.offset <= info.offset && StartsWithElfMagic(candidate)) {
+                    return &candidate == &info || info.executable;
+                }
+            }
+            return true;
+        }
+
+        // The file now at info's path, if it is still the one mapped
+        bool identify(const MappingInfo& info, FileIdentity& identity) {
+            if (info.path != lastPath_) {
+                lastPath_.assign(info.path.data(), info.path.size());
+                lastOk_ = RawFstatAt(AT_FDCWD, lastPath_.c_str(), &lastStat_, 0) == 0;
+            }
+            if (!lastOk_ || static_cast<uint64_t>(lastStat_.st_ino) != info.inode) return false;
+            identity = {static_cast<uint64_t>(lastStat_.st_dev), static_cast<uint64_t>(lastStat_.st_ino),
+                        static_cast<uint64_t>(lastStat_.st_size),
+                        static_cast<int64_t>(lastStat_.st_mtim.tv_sec) * 1000000000 + lastStat_.st_mtim.tv_nsec};
+            return true;
+        }
+
+        // Take and hash chunks of the given round until none are left or
+        // the deadline has passed, taking at least one if mustProgress
+        void hashClaimed(uint64_t round, bool mustProgress) {
+            Batch& batch = batch_;
+            {
+                std::lock_guard<std::mutex> guard(batch.lock);
+                if (batch.round != round) return;
+                batch.active++;
+            }
+            size_t count = batch.chunks.size();
+            for (bool first = true;; first = false) {
+                if (!(first && mustProgress) && MonotonicNs() >= batch.deadline) break;
+                size_t i = batch.next.fetch_add(1, std::memory_order_acq_rel);
+                if (i >= count) break;
+                hashChunk(batch.chunks[i]);
+
+                std::lock_guard<std::mutex> guard(batch.lock);
+                batch.done++;
+                batch.finished.notify_all();
+            }
+            std::lock_guard<std::mutex> guard(batch.lock);
+            batch.active--;
+            batch.finished.notify_all();
+        }
+
+        // Hash batch_ on this thread and the pool until the deadline, then
+        // report on this thread. Chunks are taken in order, so the ones
+        // hashed are a prefix of the batch; returns its length. The caller
+        // only waits for threads already taking chunks, never for a worker
+        // to get scheduled.
+        template <typename F>
+        size_t hashBatch(int64_t deadline, bool mustProgress, Result& result, F& onMismatch) {
+            Batch& batch = batch_;
+            size_t count = batch.chunks.size();
+            if (count == 0) return 0;
+            uint64_t round;
+            {
+                std::lock_guard<std::mutex> guard(batch.lock);
+                round = ++batch.round;
+                batch.done = 0;
+            }
+            batch.deadline = deadline;
+            batch.next.store(0, std::memory_order_release);
+            for (size_t i = 0; i < pool_.size() && i + 1 < count; i++) {
+                pool_.submit(batch.group, "DexChunk", [this, round](TaskContext&) { hashClaimed(round, false); });
+            }
+            hashClaimed(round, mustProgress);
+
+            size_t taken = batch.next.exchange(count, std::memory_order_acq_rel);
+            size_t hashed = taken < count ? taken : count;
+            {
+                // Retire the round once everyone inside it has left, so the
+                // chunks can be refilled
+                std::unique_lock<std::mutex> guard(batch.lock);
+                batch.finished.wait(guard, [&] { return batch.done == hashed && batch.active == 0; });
+                batch.round++;
+            }
+
+            for (size_t i = 0; i < hashed; i++) {
+                const Chunk& chunk = batch.chunks[i];
+                result.chunks++;
+                if (!chunk.ok) {
+                    result.unreadable++;
+                    continue;
+                }
+                result.bytesHashed += chunk.length;
+                if (chunk.diskHashed) result.diskBytesHashed += chunk.length;
+                if (std::memcmp(chunk.memory, chunk.disk, sizeof(chunk.memory)) != 0) {
+                    result.mismatches++;
+                    passMismatches_++;
+                    onMismatch(chunk.path, chunk.address, chunk.fileOffset, chunk.length);
+                }
+            }
+            return hashed;
+        }
+
+        // Runs on a pool worker
+        void hashChunk(Chunk& chunk) {
+            thread_local std::vector<uint8_t> buffer(kChunkSize);
+            chunk.ok = false;
+            chunk.diskHashed = false;
+
+            struct iovec local = {buffer.data(), chunk.length};
+            struct iovec remote = {reinterpret_cast<void*>(chunk.address), chunk.length};
+            if (process_vm_readv(getpid(), &local, 1, &remote, 1, 0) != static_cast<ssize_t>(chunk.length)) return;
+            Sha256::hash(buffer.data(), chunk.length, chunk.memory);
+
+            std::pair<uint64_t, size_t> key(chunk.fileOffset, chunk.length);
+            {
+                std::lock_guard<std::mutex> guard(cacheLock_);
+                auto file = cache_.find(chunk.file.inode);
+                if (file != cache_.end() && SameFile(file->second.identity, chunk.file)) {
+                    auto digest = file->second.chunks.find(key);
+                    if (digest != file->second.chunks.end()) {
+                        std::memcpy(chunk.disk, digest->second.bytes, sizeof(chunk.disk));
+                        chunk.ok = true;
+                        return;
+                    }
+                }
+            }
+
+            int fd = RawOpenAt(AT_FDCWD, chunk.path.data(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+            size_t done = 0;
+            while (done < chunk.length) {
+                ssize_t n = RawPread(fd, buffer.data() + done, chunk.length - done,
+                                     static_cast<off_t>(chunk.fileOffset + done));
+                if (n <= 0) break;
+                done += static_cast<size_t>(n);
+            }
+            RawClose(fd);
+            if (done != chunk.length) return;
+            Sha256::hash(buffer.data(), chunk.length, chunk.disk);
+            chunk.diskHashed = true;
+            chunk.ok = true;
+
+            Digest digest;
+            std::memcpy(digest.bytes, chunk.disk, sizeof(digest.bytes));
+            std::lock_guard<std::mutex> guard(cacheLock_);
+            FileDigests& file = cache_[chunk.file.inode];
+            if (!SameFile(file.identity, chunk.file)) {
+                file.identity = chunk.file;
+                file.chunks.clear();
+            }
+            file.chunks[key] = digest;
+        }
+
+        static bool SameFile(const FileIdentity& a, const FileIdentity& b) {
+            return a.device == b.device && a.inode == b.inode && a.size == b.size && a.mtimeNs == b.mtimeNs;
+        }
+
+        ThreadPool& pool_;
+        size_t batchSize_;
+        Batch batch_;
+        std::vector<std::string> skipped_;
+        uintptr_t cursor_ = 0;
+        size_t passes_ = 0;
+        size_t passMismatches_ = 0;
+        size_t lastPassMismatches_ = 0;
+
+        std::string lastPath_;
+        struct stat lastStat_ = {};
+        bool lastOk_ = false;
+
+        mutable std::mutex cacheLock_;
+        std::unordered_map<uint64_t, FileDigests> cache_; // by inode
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <elf.h>
+#include <link.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Mappings.hpp"
+#include "RawSyscall.hpp"
+#include "Trace.hpp"
+
+namespace checkbeer {
+
+    namespace detail {
+#if defined(__LP64__)
+        inline uint32_t RelocSymbol(uint64_t info) { return static_cast<uint32_t>(ELF64_R_SYM(info)); }
+        inline uint32_t RelocType(uint64_t info) { return static_cast<uint32_t>(ELF64_R_TYPE(info)); }
+        inline uint8_t SymbolType(unsigned char info) { return ELF64_ST_TYPE(info); }
+#else
+        inline uint32_t RelocSymbol(uint32_t info) { return ELF32_R_SYM(info); }
+        inline uint32_t RelocType(uint32_t info) { return ELF32_R_TYPE(info); }
+        inline uint8_t SymbolType(unsigned char info) { return ELF32_ST_TYPE(info); }
+#endif
+
+        // Relocations that store a symbol's address in a pointer slot
+        inline bool IsSlotRelocation(uint32_t type) {
+#if defined(__aarch64__)
+            return type == R_AARCH64_JUMP_SLOT || type == R_AARCH64_GLOB_DAT || type == R_AARCH64_ABS64;
+#elif defined(__x86_64__)
+            return type == R_X86_64_JUMP_SLOT || type == R_X86_64_GLOB_DAT || type == R_X86_64_64;
+#elif defined(__arm__)
+            return type == R_ARM_JUMP_SLOT || type == R_ARM_GLOB_DAT || type == R_ARM_ABS32;
+#elif defined(__i386__)
+            return type == R_386_JMP_SLOT || type == R_386_GLOB_DAT || type == R_386_32;
+#elif defined(__riscv)
+            return type == R_RISCV_JUMP_SLOT || type == R_RISCV_64;
+#else
+            (void)type;
+            return false;
+#endif
+        }
+
+        inline uint32_t GnuHash(std::string_view name) {
+            uint32_t h = 5381;
+            for (char c : name) h = h * 33 + static_cast<uint8_t>(c);
+            return h;
+        }
+    } // namespace detail
+
+    // A shared library as stored on disk, mapped read-only and parsed in
+    // place: nothing is copied out of the file. Reading the dynamic section,
+    // relocations and symbols from disk rather than from memory means a hook
+    // that rewrote the in-memory copies cannot hide behind them. Every
+    // offset read from the file is bounds-checked. Immutable once opened.
+    class ElfFile {
+    public:
+        using Ehdr = ElfW(Ehdr);
+        using Phdr = ElfW(Phdr);
+        using Dyn = ElfW(Dyn);
+        using Sym = ElfW(Sym);
+        using Rel = ElfW(Rel);
+        using Rela = ElfW(Rela);
+
+        // offset is where the ELF starts in the file: non-zero for a library
+        // mapped straight out of an APK. nullptr if it is not a native ELF.
+        static std::unique_ptr<ElfFile> Open(const char* path, uint64_t offset = 0) {
+            CHECK_TRACE_SPAN("ElfFile:open");
+            int fd = RawOpenAt(AT_FDCWD, path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return nullptr;
+            struct stat st;
+            if (RawFstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) <= offset ||
+                offset % static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) != 0) {
+                RawClose(fd);
+                return nullptr;
+            }
+            size_t size = static_cast<size_t>(static_cast<uint64_t>(st.st_size) - offset);
+            void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+            RawClose(fd);
+            if (data == MAP_FAILED) return nullptr;
+
+            std::unique_ptr<ElfFile> file(new ElfFile(static_cast<const uint8_t*>(data), size));
+            if (!file->parse()) return nullptr;
+            file->device_ = static_cast<uint64_t>(st.st_dev);
+            file->inode_ = static_cast<uint64_t>(st.st_ino);
+            return file;
+        }
+
+        ~ElfFile() { munmap(const_cast<uint8_t*>(data_), size_); }
+
+        // A defined, default-version dynamic symbol, via the GNU hash table;
+        // nullptr if absent or the library has no GNU hash
+        const Sym* findSymbol(std::string_view name) const {
+            if (!gnuHash_) return nullptr;
+            const uint32_t* header = at<uint32_t>(gnuHash_, 4);
+            if (!header || header[0] == 0 || header[2] == 0) return nullptr;
+            uint32_t bucketCount = header[0], symbolOffset = header[1], bloomSize = header[2], bloomShift = header[3];
+
+            const ElfW(Addr)* bloom = at<ElfW(Addr)>(gnuHash_ + 16, bloomSize);
+            size_t bucketsAt = gnuHash_ + 16 + bloomSize * sizeof(ElfW(Addr));
+            const uint32_t* buckets = at<uint32_t>(bucketsAt, bucketCount);
+            if (!bloom || !buckets) return nullptr;
+
+            constexpr uint32_t kBits = sizeof(ElfW(Addr)) * 8;
+            uint32_t hash = detail::GnuHash(name);
+            ElfW(Addr) word = bloom[(hash / kBits) % bloomSize];
+            ElfW(Addr) mask = (static_cast<ElfW(Addr)>(1) << (hash % kBits)) |
+                              (static_cast<ElfW(Addr)>(1) << ((hash >> bloomShift) % kBits));
+            if ((word & mask) != mask) return nullptr;
+
+            size_t chainAt = bucketsAt + bucketCount * sizeof(uint32_t);
+            uint32_t first = buckets[hash % bucketCount];
+            if (first == 0 || first < symbolOffset) return nullptr;
+            for (uint32_t index = first;; index++) {
+                const uint32_t* chain = at<uint32_t>(chainAt + (index - symbolOffset) * sizeof(uint32_t), 1);
+                const Sym* sym = symbol(index);
+                if (!chain || !sym) return nullptr;
+                if (((*chain ^ hash) >> 1) == 0 && sym->st_shndx != SHN_UNDEF && symbolName(*sym) == name) {
+                    const uint16_t* version = versym_ ? at<uint16_t>(versym_ + index * sizeof(uint16_t), 1) : nullptr;
+                    if (!version || (*version & 0x8000) == 0) return sym;
+                }
+                if (*chain & 1) break;
+            }
+            return nullptr;
+        }
+
+        const Sym* symbol(size_t index) const { return symtab_ ? at<Sym>(symtab_ + index * sizeof(Sym), 1) : nullptr; }
+
+        std::string_view symbolName(const Sym& sym) const {
+            if (sym.st_name >= strsz_) return {};
+            const char* name = reinterpret_cast<const char*>(data_ + strtab_ + sym.st_name);
+            return std::string_view(name, strnlen(name, strsz_ - sym.st_name));
+        }
+
+        static bool IsIndirect(const Sym& sym) { return detail::SymbolType(sym.st_info) == STT_GNU_IFUNC; }
+
+        // fn(std::string_view symbol, uintptr_t slotVaddr, intptr_t addend)
+        // for every relocation that stores a symbol's address in a slot:
+        // the PLT's and the plain REL/RELA table. Android's packed tables
+        // (DT_ANDROID_REL[A]) are not decoded; the PLT table never is packed.
+        template <typename F>
+        void forEachImport(F&& fn) const {
+            if (jmprel_) {
+                if (pltRela_) forEachRelocation<Rela>(jmprel_, pltRelSize_, fn);
+                else forEachRelocation<Rel>(jmprel_, pltRelSize_, fn);
+            }
+            if (rela_) forEachRelocation<Rela>(rela_, relaSize_, fn);
+            if (rel_) forEachRelocation<Rel>(rel_, relSize_, fn);
+        }
+
+        // length bytes of the file's image of vaddr, if all of them are in
+        // one loadable segment's file data
+        const uint8_t* bytesAt(uintptr_t vaddr, size_t length) const {
+            size_t offset;
+            if (!toOffset(vaddr, length, offset)) return nullptr;
+            return data_ + offset;
+        }
+
+        // Where vaddr 0 lands when the ELF header is mapped at header
+        uintptr_t loadBias(uintptr_t header) const { return header - firstLoadBias_; }
+
+        uint64_t device() const { return device_; }
+        uint64_t inode() const { return inode_; }
+
+        // Disable copy
+        ElfFile(const ElfFile&) = delete;
+        ElfFile& operator=(const ElfFile&) = delete;
+
+    private:
+        ElfFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+        template <typename T>
+        const T* at(size_t offset, size_t count) const {
+            if (offset > size_ || count > (size_ - offset) / sizeof(T) || offset % alignof(T) != 0) return nullptr;
+            return reinterpret_cast<const T*>(data_ + offset);
+        }
+
+        bool toOffset(uintptr_t vaddr, size_t length, size_t& offset) const {
+            for (size_t i = 0; i < phnum_; i++) {
+                const Phdr& ph = phdrs_[i];
+                if (ph.p_type != PT_LOAD || vaddr < ph.p_vaddr || vaddr - ph.p_vaddr > ph.p_filesz ||
+                    length > ph.p_filesz - (vaddr - ph.p_vaddr)) {
+                    continue;
+                }
+                offset = static_cast<size_t>(ph.p_offset + (vaddr - ph.p_vaddr));
+                return offset <= size_ && length <= size_ - offset;
+            }
+            return false;
+        }
+
+        size_t offsetOf(ElfW(Addr) vaddr) const {
+            size_t offset;
+            return toOffset(static_cast<uintptr_t>(vaddr), 1, offset) ? offset : 0;
+        }
+
+        bool parse() {
+            const Ehdr* ehdr = at<Ehdr>(0, 1);
+            if (!ehdr || std::memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+                ehdr->e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32) ||
+                ehdr->e_phentsize != sizeof(Phdr)) {
+                return false;
+            }
+            phdrs_ = at<Phdr>(ehdr->e_phoff, ehdr->e_phnum);
+            if (!phdrs_) return false;
+            phnum_ = ehdr->e_phnum;
+
+            const Phdr* dynamic = nullptr;
+            bool haveLoad = false;
+            for (size_t i = 0; i < phnum_; i++) {
+                if (phdrs_[i].p_type == PT_LOAD && !haveLoad) {
+                    firstLoadBias_ = static_cast<uintptr_t>(phdrs_[i].p_vaddr - phdrs_[i].p_offset);
+                    haveLoad = true;
+                }
+                if (phdrs_[i].p_type == PT_DYNAMIC) dynamic = &phdrs_[i];
+            }
+            if (!haveLoad || !dynamic) return false;
+
+            const Dyn* dyn = at<Dyn>(dynamic->p_offset, dynamic->p_filesz / sizeof(Dyn));
+            if (!dyn) return false;
+            for (size_t i = 0; i < dynamic->p_filesz / sizeof(Dyn) && dyn[i].d_tag != DT_NULL; i++) {
+                ElfW(Addr) value = dyn[i].d_un.d_ptr;
+                switch (dyn[i].d_tag) {
+                    case DT_SYMTAB: symtab_ = offsetOf(value); break;
+                    case DT_STRTAB: strtab_ = offsetOf(value); break;
+                    case DT_STRSZ: strsz_ = static_cast<size_t>(dyn[i].d_un.d_val); break;
+                    case DT_GNU_HASH: gnuHash_ = offsetOf(value); break;
+                    case DT_VERSYM: versym_ = offsetOf(value); break;
+                    case DT_JMPREL: jmprel_ = offsetOf(value); break;
+                    case DT_PLTRELSZ: pltRelSize_ = static_cast<size_t>(dyn[i].d_un.d_val); break;
+                    case DT_PLTREL: pltRela_ = dyn[i].d_un.d_val == DT_RELA; break;
+                    case DT_RELA: rela_ = offsetOf(value); break;
+                    case DT_RELASZ: relaSize_ = static_cast<size_t>(dyn[i].d_un.d_val); break;
+                    case DT_REL: rel_ = offsetOf(value); break;
+                    case DT_RELSZ: relSize_ = static_cast<size_t>(dyn[i].d_un.d_val); break;
+                    default: break;
+                }
+            }
+            if (!symtab_ || !strtab_ || strtab_ > size_ || strsz_ > size_ - strtab_) {
+                symtab_ = 0;
+                strsz_ = 0;
+            }
+            return true;
+        }
+
+        template <typename R, typename F>
+        void forEachRelocation(size_t offset, size_t bytes, F& fn) const {
+            const R* relocs = at<R>(offset, bytes / sizeof(R));
+            if (!relocs) return;
+            for (size_t i = 0; i < bytes / sizeof(R); i++) {
+                if (!detail::IsSlotRelocation(detail::RelocType(relocs[i].r_info))) continue;
+                const Sym* sym = symbol(detail::RelocSymbol(relocs[i].r_info));
+                if (!sym || sym->st_name == 0) continue;
+                intptr_t addend = 0;
+                if constexpr (std::is_same_v<R, Rela>) addend = static_cast<intptr_t>(relocs[i].r_addend);
+                fn(symbolName(*sym), static_cast<uintptr_t>(relocs[i].r_offset), addend);
+            }
+        }
+
+        const uint8_t* data_;
+        size_t size_;
+        const Phdr* phdrs_ = nullptr;
+        size_t phnum_ = 0;
+        uintptr_t firstLoadBias_ = 0; // p_vaddr - p_offset of the first PT_LOAD
+        size_t symtab_ = 0, strtab_ = 0, strsz_ = 0, gnuHash_ = 0, versym_ = 0;
+        size_t jmprel_ = 0, pltRelSize_ = 0, rela_ = 0, relaSize_ = 0, rel_ = 0, relSize_ = 0;
+        bool pltRela_ = sizeof(void*) == 8;
+        uint64_t device_ = 0;
+        uint64_t inode_ = 0;
+    };
+
+    // A library as loaded in this process, paired with its file on disk
+    struct LoadedModule {
+        std::string path;
+        std::string_view name; // file name part of path
+        uintptr_t header;       // where the ELF header is mapped
+        uintptr_t bias;         // load bias: memory address = bias + vaddr
+        std::unique_ptr<ElfFile> file;
+    };
+
+    // Loaded modules, each parsed from disk the first time it is asked for
+    // and kept for the life of the cache. Modules are found through a
+    // MappingIndex, so a library loaded out of an APK is opened at its
+    // offset inside the APK. Not thread-safe.
+    class ModuleCache {
+    public:
+        // The module with an executable mapping containing address
+        const LoadedModule* moduleAt(const MappingIndex& index, uintptr_t address) {
+            const MappingInfo* info = index.find(address);
+            return info ? load(index, *info) : nullptr;
+        }
+
+        // The first module whose file name is fileName, e.g. "libc.so"
+        const LoadedModule* moduleNamed(const MappingIndex& index, std::string_view fileName) {
+            for (const auto& module : modules_) {
+                if (module->name == fileName) return module->file ? module.get() : nullptr;
+            }
+            for (size_t i = 0; i < index.size(); i++) {
+                const MappingInfo& info = index[i];
+                if (info.executable && info.kind == MappingKind::File && FileName(info.path) == fileName) {
+                    return load(index, info);
+                }
+            }
+            return nullptr;
+        }
+
+        size_t size() const { return modules_.size(); }
+
+    private:
+        static std::string_view FileName(std::string_view path) {
+            size_t slash = path.rfind('/');
+            return slash == std::string_view::npos ? path : path.substr(slash + 1);
+        }
+
+        const LoadedModule* load(const MappingIndex& index, const MappingInfo& info) {
+            if (info.kind != MappingKind::File) return nullptr;
+
+            // The header is the nearest mapping at or before this one, from
+            // the same file, whose memory starts with the ELF magic
+            const MappingInfo* header = nullptr;
+            for (size_t i = index.indexOf(info) + 1; i-- > 0;) {
+                const MappingInfo& candidate = index[i];
+                if (candidate.path != info.path) break;
+                if (candidate.readable && candidate.offset <= info.offset &&
+                    std::memcmp(reinterpret_cast<const void*>(candidate.start), ELFMAG, SELFMAG) == 0) {
+                    header = &candidate;
+                    break;
+                }
+            }
+            if (!header) return nullptr;
+
+            for (const auto& module : modules_) {
+                if (module->header == header->start && module->path == header->path) {
+                    return module->file ? module.get() : nullptr;
+                }
+            }
+
+            // Failures are cached too, so a module that cannot be opened is
+            // not retried on every run
+            auto module = std::make_unique<LoadedModule>();
+            module->path.assign(header->path.data(), header->path.size());
+            module->name = FileName(module->path);
+            module->header = header->start;
+            module->file = ElfFile::Open(module->path.c_str(), header->offset);
+            module->bias = module->file ? module->file->loadBias(header->start) : 0;
+            modules_.push_back(std::move(module));
+            return modules_.back()->file ? modules_.back().get() : nullptr;
+        }
+
+        std::vector<std::unique_ptr<LoadedModule>> modules_;
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "Mappings.hpp"
+#include "RawSyscall.hpp"
+
+namespace checkbeer {
+
+    // Which file something is, as the kernel sees it. A path can be made to
+    // name another file; a device and inode cannot. Device numbers are kept
+    // split because that is how /proc/self/maps prints them.
+    struct FileId {
+        uint32_t devMajor;
+        uint32_t devMinor;
+        uint64_t inode;
+
+        bool operator==(const FileId& other) const {
+            return devMajor == other.devMajor && devMinor == other.devMinor && inode == other.inode;
+        }
+        bool operator!=(const FileId& other) const { return !(*this == other); }
+    };
+
+    inline FileId FileIdOf(const struct stat& st) {
+        return {static_cast<uint32_t>(major(st.st_dev)), static_cast<uint32_t>(minor(st.st_dev)),
+                static_cast<uint64_t>(st.st_ino)};
+    }
+
+    // The file at path, through the raw syscall; false if it cannot be stat'ed
+    inline bool IdentifyPath(const char* path, FileId& out) {
+        struct stat st;
+        if (RawFstatAt(AT_FDCWD, path, &st, 0) != 0) return false;
+        out = FileIdOf(st);
+        return true;
+    }
+
+    // The file behind an open descriptor
+    inline bool IdentifyFd(int fd, FileId& out) {
+        struct stat st;
+        if (RawFstat(fd, &st) != 0) return false;
+        out = FileIdOf(st);
+        return true;
+    }
+
+    // The file a mapping was made from, as listed in /proc/self/maps
+    inline FileId IdentifyMapping(const MappingInfo& info) { return {info.devMajor, info.devMinor, info.inode}; }
+
+} // namespace checkbeer
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "ElfImage.hpp"
+#include "Mappings.hpp"
+
+namespace checkbeer {
+
+    // An import worth guarding and the library that should satisfy it
+    struct GotExpectation {
+        const char* symbol;
+        const char* library; // file name, e.g. "libc.so"
+    };
+
+    // Watches the GOT slots through which a set of libraries reach a set of
+    // sensitive functions, and reports slots that no longer hold the
+    // address the dynamic linker put there. Each slot is resolved once,
+    // from the importer's relocations and the provider's GNU hash table on
+    // disk, so a run only reads the slots and compares. Not thread-safe.
+    class GotScanner {
+    public:
+        struct Slot {
+            const char* symbol;
+            const LoadedModule* importer;
+            const LoadedModule* provider;
+            uintptr_t address;  // the slot in the importer's GOT
+            uintptr_t expected; // 0 if only the provider module can be checked
+        };
+
+        struct Result {
+            size_t modules;
+            size_t slots;
+            size_t unbound;  // slots still pointing into their importer
+            size_t hooked;
+        };
+
+        GotScanner(const GotExpectation* expectations, size_t count) : expectations_(expectations, expectations + count) {}
+
+        // Resolve importer's slots for the expected symbols. Providers that
+        // are not loaded are skipped; so are symbols they do not define,
+        // since the importer would then have failed to load or the symbol
+        // comes from elsewhere by design.
+        void watch(ModuleCache& cache, const MappingIndex& index, const LoadedModule& importer) {
+            for (const LoadedModule* module : importers_) {
+                if (module == &importer) return;
+            }
+            importers_.push_back(&importer);
+
+            importer.file->forEachImport([&](std::string_view name, uintptr_t slot, intptr_t addend) {
+                if (addend != 0) return;
+                for (const GotExpectation& expectation : expectations_) {
+                    if (name != expectation.symbol) continue;
+                    const LoadedModule* provider = cache.moduleNamed(index, expectation.library);
+                    if (!provider) return;
+                    const ElfFile::Sym* sym = provider->file->findSymbol(name);
+                    if (!sym) return;
+
+                    // An IFUNC's slot holds whatever its resolver picked
+                    uintptr_t expected = ElfFile::IsIndirect(*sym) ? 0 : provider->bias + sym->st_value;
+                    slots_.push_back({expectation.symbol, &importer, provider, importer.bias + slot, expected});
+                    return;
+                }
+            });
+        }
+
+        // onHooked(const Slot&, uintptr_t actual, const MappingInfo* target)
+        // for each slot redirected away from its provider; target is
+        // nullptr when actual is not mapped at all
+        template <typename F>
+        Result verify(const MappingIndex& index, F&& onHooked) const {
+            Result result = {importers_.size(), slots_.size(), 0, 0};
+            for (const Slot& slot : slots_) {
+                uintptr_t actual;
+                std::memcpy(&actual, reinterpret_cast<const void*>(slot.address), sizeof(actual));
+                if (slot.expected != 0 && actual == slot.expected) continue;
+
+                const MappingInfo* target = index.find(actual);
+                std::string_view path = target ? target->path : std::string_view();
+
+#ifndef __ANDROID__
+                // Lazily bound (glibc without -z now): still the importer's
+                // PLT. Bionic binds everything at load, so there it is a hook.
+                if (target && path == slot.importer->path) {
+                    result.unbound++;
+                    continue;
+                }
+#endif
+                if (slot.expected == 0 && target && target->executable && path == slot.provider->path) continue;
+
+                result.hooked++;
+                onHooked(slot, actual, target);
+            }
+            return result;
+        }
+
+        const std::vector<Slot>& slots() const { return slots_; }
+
+    private:
+        std::vector<GotExpectation> expectations_;
+        std::vector<const LoadedModule*> importers_;
+        std::vector<Slot> slots_;
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <jni.h>
+#include <atomic>
+#include <pthread.h>
+
+#include "JNIHelper.hpp"
+
+namespace jni {
+
+    namespace detail {
+
+        inline std::atomic<JavaVM*> gJavaVM{nullptr};
+        inline pthread_key_t gEnvKey;
+        inline pthread_once_t gEnvKeyOnce = PTHREAD_ONCE_INIT;
+        inline thread_local JNIEnv* tEnv = nullptr;
+
+        // Runs at thread exit, only for threads attached by CurrentEnv
+        inline void DetachOnThreadExit(void*) {
+            if (JavaVM* vm = gJavaVM.load(std::memory_order_acquire)) vm->DetachCurrentThread();
+        }
+
+        inline void CreateEnvKey() {
+            pthread_key_create(&gEnvKey, DetachOnThreadExit);
+        }
+
+    } // namespace detail
+
+    // Cache the VM; called once from JNI_OnLoad
+    inline void SetJavaVM(JavaVM* vm) {
+        pthread_once(&detail::gEnvKeyOnce, detail::CreateEnvKey);
+        detail::gJavaVM.store(vm, std::memory_order_release);
+    }
+
+    inline JavaVM* GetJavaVM() {
+        return detail::gJavaVM.load(std::memory_order_acquire);
+    }
+
+    // The calling thread's JNIEnv. Threads the VM already knows are used as
+    // they are; native threads are attached under threadName on first call
+    // and detached automatically when they exit. Returns nullptr before
+    // SetJavaVM or if attaching fails. After the first call this is a
+    // thread-local load.
+    inline JNIEnv* CurrentEnv(const char* threadName = nullptr) {
+        if (detail::tEnv) return detail::tEnv;
+
+        JavaVM* vm = GetJavaVM();
+        if (!vm) return nullptr;
+
+        JNIEnv* env = nullptr;
+        if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+            detail::tEnv = env;
+            return env;
+        }
+
+        // The JDK's jni.h (host builds) declares name as char*
+        JavaVMAttachArgs args = {JNI_VERSION_1_6, const_cast<char*>(threadName), nullptr};
+        env = nullptr;
+        if (AttachCurrentThread(vm, &env, &args) != JNI_OK || !env) return nullptr;
+
+        pthread_setspecific(detail::gEnvKey, env);
+        detail::tEnv = env;
+        return env;
+    }
+
+    // Detach early a thread that CurrentEnv attached; others are left alone
+    inline void DetachCurrentEnv() {
+        if (!detail::tEnv) return;
+        detail::tEnv = nullptr;
+        if (pthread_getspecific(detail::gEnvKey)) {
+            pthread_setspecific(detail::gEnvKey, nullptr);
+            GetJavaVM()->DetachCurrentThread();
+        }
+    }
+
+} // namespace jni
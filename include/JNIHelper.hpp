@@ -2,9 +2,13 @@
 
 #include <jni.h>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <vector>
 
+#include "AllocProfile.hpp"
+#include "Arena.hpp"
+
 namespace jni {
 
     // Custom exception for JNI errors
@@ -57,8 +61,33 @@ namespace jni {
         T ref_;
     };
 
+    // RAII local reference frame. Every local reference created inside the
+    // scope is freed when it ends, which bounds the local table on native
+    // threads that never return to Java. If the frame cannot be pushed the
+    // references land in the enclosing frame instead.
+    class ScopedLocalFrame {
+    public:
+        ScopedLocalFrame(JNIEnv* env, jint capacity) : env_(env) {
+            pushed_ = env_->PushLocalFrame(capacity) == 0;
+            if (!pushed_) env_->ExceptionClear();
+        }
+
+        ~ScopedLocalFrame() {
+            if (pushed_) env_->PopLocalFrame(nullptr);
+        }
+
+        // Disable copy
+        ScopedLocalFrame(const ScopedLocalFrame&) = delete;
+        ScopedLocalFrame& operator=(const ScopedLocalFrame&) = delete;
+
+    private:
+        JNIEnv* env_;
+        bool pushed_;
+    };
+
     // Convert a Java string to a C++ string
     inline std::string JStringToString(JNIEnv* env, jstring jstr) {
+        CHECK_ALLOC_SCOPE("jni::JStringToString");
         if (!jstr) return {};
 
         const char* chars = env->GetStringUTFChars(jstr, nullptr);
@@ -69,13 +98,39 @@ namespace jni {
         return result;
     }
 
+    // Copy a Java string into an arena. The UTF-8 bytes are written straight
+    // into arena memory, so no std::string or VM-side copy is allocated.
+    inline std::string_view JStringToArena(JNIEnv* env, jstring jstr, checkbeer::MonotonicArena& arena) {
+        CHECK_ALLOC_SCOPE("jni::JStringToArena");
+        if (!jstr) return {"", 0};
+
+        jsize utfLength = env->GetStringUTFLength(jstr);
+        jsize length = env->GetStringLength(jstr);
+        char* buffer = static_cast<char*>(arena.allocate(static_cast<size_t>(utfLength) + 1, 1));
+        env->GetStringUTFRegion(jstr, 0, length, buffer);
+        JNI_CHECK_EXCEPTION(env);
+        buffer[utfLength] = '\0';
+        return {buffer, static_cast<size_t>(utfLength)};
+    }
+
     // Create a Java string from a C++ string
     inline jstring StringToJString(JNIEnv* env, const std::string& str) {
         return env->NewStringUTF(str.c_str());
     }
 
+    // Attach the calling thread. Android's jni.h takes JNIEnv** here, the
+    // JDK's (host builds) takes void**.
+    inline jint AttachCurrentThread(JavaVM* vm, JNIEnv** env, void* args) {
+#ifdef __ANDROID__
+        return vm->AttachCurrentThread(env, args);
+#else
+        return vm->AttachCurrentThread(reinterpret_cast<void**>(env), args);
+#endif
+    }
+
     // Find a Java class
     inline jclass FindClass(JNIEnv* env, const char* className) {
+        CHECK_ALLOC_SCOPE("jni::FindClass");
         jclass cls = env->FindClass(className);
         JNI_CHECK_EXCEPTION(env);
         return cls;
@@ -83,6 +138,7 @@ namespace jni {
 
     // Get a method ID
     inline jmethodID GetMethodID(JNIEnv* env, jclass cls, const char* methodName, const char* signature) {
+        CHECK_ALLOC_SCOPE("jni::GetMethodID");
         jmethodID mid = env->GetMethodID(cls, methodName, signature);
         JNI_CHECK_EXCEPTION(env);
         return mid;
@@ -90,6 +146,7 @@ namespace jni {
 
     // Get a static method ID
     inline jmethodID GetStaticMethodID(JNIEnv* env, jclass cls, const char* methodName, const char* signature) {
+        CHECK_ALLOC_SCOPE("jni::GetStaticMethodID");
         jmethodID mid = env->GetStaticMethodID(cls, methodName, signature);
         JNI_CHECK_EXCEPTION(env);
         return mid;
@@ -97,6 +154,7 @@ namespace jni {
 
     // Get a field ID
     inline jfieldID GetFieldID(JNIEnv* env, jclass cls, const char* fieldName, const char* signature) {
+        CHECK_ALLOC_SCOPE("jni::GetFieldID");
         jfieldID fid = env->GetFieldID(cls, fieldName, signature);
         JNI_CHECK_EXCEPTION(env);
         return fid;
@@ -104,6 +162,7 @@ namespace jni {
 
     // Get a static field ID
     inline jfieldID GetStaticFieldID(JNIEnv* env, jclass cls, const char* fieldName, const char* signature) {
+        CHECK_ALLOC_SCOPE("jni::GetStaticFieldID");
         jfieldID fid = env->GetStaticFieldID(cls, fieldName, signature);
         JNI_CHECK_EXCEPTION(env);
         return fid;
@@ -417,18 +476,37 @@ namespace jni {
         }
     };
 
-    // Helper to convert arguments to jvalue array
+    // Helper to convert arguments to jvalue array. Java strings created for
+    // C++ string arguments are local references owned by this object.
     template <typename... Args>
     class ArgsToJValues {
     public:
-        ArgsToJValues(JNIEnv* env, Args... args) {
+        ArgsToJValues(JNIEnv* env, Args... args) : env_(env) {
             convertArgs(env, 0, args...);
         }
 
+        ~ArgsToJValues() {
+            for (int i = 0; i < ownedCount_; i++) env_->DeleteLocalRef(owned_[i]);
+        }
+
         const jvalue* get() const { return values_; }
 
+        // Disable copy
+        ArgsToJValues(const ArgsToJValues&) = delete;
+        ArgsToJValues& operator=(const ArgsToJValues&) = delete;
+
     private:
-        jvalue values_[sizeof...(Args) > 0 ? sizeof...(Args) : 1]; // Ensure at least one element
+        static constexpr int kSize = sizeof...(Args) > 0 ? sizeof...(Args) : 1; // Ensure at least one element
+
+        JNIEnv* env_;
+        jvalue values_[kSize];
+        jobject owned_[kSize];
+        int ownedCount_ = 0;
+
+        void own(int index, jstring jstr) {
+            values_[index].l = jstr;
+            if (jstr) owned_[ownedCount_++] = jstr;
+        }
 
         template <typename T, typename... RestArgs>
         void convertArgs(JNIEnv* env, int index, T value, RestArgs... rest) {
@@ -463,28 +541,22 @@ namespace jni {
 
         // Handle C++ string conversion to Java string
         void setJValue(JNIEnv* env, int index, const std::string& value) {
-            jstring jstr = StringToJString(env, value);
-            values_[index].l = jstr;
+            own(index, StringToJString(env, value));
         }
 
         void setJValue(JNIEnv* env, int index, const char* value) {
             if (value == nullptr) {
                 values_[index].l = nullptr;
             } else {
-                jstring jstr = env->NewStringUTF(value);
-                values_[index].l = jstr;
+                own(index, env->NewStringUTF(value));
             }
         }
     };
 
-// Generic CallMethod template function that works with no arguments
+// Generic CallMethod template function for an already resolved method ID
     template <typename RetType, typename... Args>
-    RetType CallMethod(JNIEnv* env, jobject obj, const char* methodName, const char* signature, Args... args) {
-        jclass cls = env->GetObjectClass(obj);
-        ScopedLocalRef<jclass> clsRef(env, cls);
-
-        jmethodID mid = GetMethodID(env, cls, methodName, signature);
-
+    RetType CallMethod(JNIEnv* env, jobject obj, jmethodID mid, Args... args) {
+        CHECK_ALLOC_SCOPE("jni::CallMethod");
         if constexpr (sizeof...(Args) == 0) {
             // Handle the no-arguments case using the direct call methods
             if constexpr (std::is_same_v<RetType, void>) {
@@ -550,14 +622,20 @@ namespace jni {
         }
     }
 
-// Generic CallStaticMethod template function that works with no arguments
+// Generic CallMethod template function that works with no arguments
     template <typename RetType, typename... Args>
-    RetType CallStaticMethod(JNIEnv* env, const char* className, const char* methodName, const char* signature, Args... args) {
-        jclass cls = FindClass(env, className);
+    RetType CallMethod(JNIEnv* env, jobject obj, const char* methodName, const char* signature, Args... args) {
+        jclass cls = env->GetObjectClass(obj);
         ScopedLocalRef<jclass> clsRef(env, cls);
 
-        jmethodID mid = GetStaticMethodID(env, cls, methodName, signature);
+        jmethodID mid = GetMethodID(env, cls, methodName, signature);
+        return CallMethod<RetType>(env, obj, mid, args...);
+    }
 
+// Generic CallStaticMethod template function for an already resolved method ID
+    template <typename RetType, typename... Args>
+    RetType CallStaticMethod(JNIEnv* env, jclass cls, jmethodID mid, Args... args) {
+        CHECK_ALLOC_SCOPE("jni::CallStaticMethod");
         if constexpr (sizeof...(Args) == 0) {
             // Handle the no-arguments case using the direct call methods
             if constexpr (std::is_same_v<RetType, void>) {
@@ -623,9 +701,20 @@ namespace jni {
         }
     }
 
+// Generic CallStaticMethod template function that works with no arguments
+    template <typename RetType, typename... Args>
+    RetType CallStaticMethod(JNIEnv* env, const char* className, const char* methodName, const char* signature, Args... args) {
+        jclass cls = FindClass(env, className);
+        ScopedLocalRef<jclass> clsRef(env, cls);
+
+        jmethodID mid = GetStaticMethodID(env, cls, methodName, signature);
+        return CallStaticMethod<RetType>(env, cls, mid, args...);
+    }
+
     // Create a new Java object
     template<typename... Args>
     jobject NewObject(JNIEnv* env, const char* className, const char* constructorSignature, Args... args) {
+        CHECK_ALLOC_SCOPE("jni::NewObject");
         jclass cls = FindClass(env, className);
         ScopedLocalRef<jclass> clsRef(env, cls);
 
@@ -638,6 +727,28 @@ namespace jni {
         return obj;
     }
 
+    // Generic GetField template function for an already resolved field ID
+    template <typename T>
+    T GetField(JNIEnv* env, jobject obj, jfieldID fid) {
+        CHECK_ALLOC_SCOPE("jni::GetField");
+        if constexpr (std::is_convertible_v<T, jobject>) {
+            return static_cast<T>(JNITypeTraits<jobject>::GetField(env, obj, fid));
+        } else {
+            return JNITypeTraits<T>::GetField(env, obj, fid);
+        }
+    }
+
+    // Generic GetStaticField template function for an already resolved field ID
+    template <typename T>
+    T GetStaticField(JNIEnv* env, jclass cls, jfieldID fid) {
+        CHECK_ALLOC_SCOPE("jni::GetStaticField");
+        if constexpr (std::is_convertible_v<T, jobject>) {
+            return static_cast<T>(JNITypeTraits<jobject>::GetStaticField(env, cls, fid));
+        } else {
+            return JNITypeTraits<T>::GetStaticField(env, cls, fid);
+        }
+    }
+
     // Generic GetField template function for instance fields
     template <typename T>
     T GetField(JNIEnv* env, jobject obj, const char* fieldName, const char* signature = nullptr) {
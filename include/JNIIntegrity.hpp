@@ -0,0 +1,264 @@
+#pragma once
+
+#include <jni.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Mappings.hpp"
+
+namespace checkbeer {
+
+    // The JNI function table as this jni.h declares it (JNINativeInterface on
+    // Android, JNINativeInterface_ in the JDK)
+    using JniFunctionTable = std::remove_const_t<std::remove_pointer_t<decltype(std::declval<JNIEnv>().functions)>>;
+
+    inline constexpr size_t kJniTableSlots = sizeof(JniFunctionTable) / sizeof(void*);
+
+    // Names for the slots hooking frameworks go after; the rest are reported by index
+    inline const char* JniSlotName(size_t slot) {
+#define CHECK_JNI_SLOT(name) {offsetof(JniFunctionTable, name) / sizeof(void*), #name}
+        static constexpr struct {
+            size_t slot;
+            const char* name;
+        } kNames[] = {
+                CHECK_JNI_SLOT(FindClass),
+                CHECK_JNI_SLOT(GetObjectClass),
+                CHECK_JNI_SLOT(GetMethodID),
+                CHECK_JNI_SLOT(CallObjectMethod),
+                CHECK_JNI_SLOT(CallObjectMethodV),
+                CHECK_JNI_SLOT(CallObjectMethodA),
+                CHECK_JNI_SLOT(CallBooleanMethod),
+                CHECK_JNI_SLOT(CallIntMethod),
+                CHECK_JNI_SLOT(GetFieldID),
+                CHECK_JNI_SLOT(GetObjectField),
+                CHECK_JNI_SLOT(GetStaticMethodID),
+                CHECK_JNI_SLOT(CallStaticObjectMethod),
+                CHECK_JNI_SLOT(CallStaticObjectMethodV),
+                CHECK_JNI_SLOT(GetStaticFieldID),
+                CHECK_JNI_SLOT(GetStaticObjectField),
+                CHECK_JNI_SLOT(NewStringUTF),
+                CHECK_JNI_SLOT(GetStringUTFChars),
+                CHECK_JNI_SLOT(GetStringUTFRegion),
+                CHECK_JNI_SLOT(GetArrayLength),
+                CHECK_JNI_SLOT(GetObjectArrayElement),
+                CHECK_JNI_SLOT(GetByteArrayElements),
+                CHECK_JNI_SLOT(RegisterNatives),
+                CHECK_JNI_SLOT(ExceptionCheck),
+        };
+#undef CHECK_JNI_SLOT
+        for (const auto& entry : kNames) {
+            if (entry.slot == slot) return entry.name;
+        }
+        return nullptr;
+    }
+
+    // Checks that a JNI function table and every function in it live in the
+    // runtime library, so no entry has been redirected to a hook and the
+    // table itself has not been swapped for a copy. A table that passes is
+    // remembered, and later calls on the same, unchanged table are a memcmp.
+    // Not thread-safe.
+    class JniTableVerifier {
+    public:
+        struct Result {
+            size_t checked;  // non-null slots looked up
+            size_t foreign;  // slots pointing outside the runtime's code
+            bool tableForeign;
+            bool cached;     // unchanged since the last clean verification
+        };
+
+        // runtimeLibraries are file names, e.g. "libart.so"
+        JniTableVerifier(std::initializer_list<const char*> runtimeLibraries)
+            : libraries_(runtimeLibraries.begin(), runtimeLibraries.end()) {}
+
+        // onForeign(size_t slot, const void* target, const MappingInfo* mapping)
+        // for each redirected slot, mapping being nullptr when target is not
+        // mapped at all. slot is kJniTableSlots for the table itself.
+        template <typename F>
+        Result verify(const JNIEnv* env, F&& onForeign) {
+            const void* table = env->functions;
+            const void* const* slots = static_cast<const void* const*>(table);
+            if (table == verifiedTable_ && std::memcmp(slots, verified_, sizeof(verified_)) == 0) {
+                return {verifiedChecked_, 0, false, true};
+            }
+
+            // A miss may only mean the snapshot predates a library load, so
+            // look again in a fresh one before calling anything foreign
+            std::shared_ptr<const MappingIndex> index = GetMappingIndex(false);
+            if (!index) return {0, 0, false, false};
+            Result result = scan(*index, table, slots);
+            if (result.foreign > 0 || result.tableForeign) {
+                std::shared_ptr<const MappingIndex> fresh = GetMappingIndex(true);
+                if (fresh && fresh != index) {
+                    index = std::move(fresh);
+                    result = scan(*index, table, slots);
+                }
+            }
+
+            if (result.foreign == 0 && !result.tableForeign) {
+                verifiedTable_ = table;
+                verifiedChecked_ = result.checked;
+                std::memcpy(verified_, slots, sizeof(verified_));
+                return result;
+            }
+
+            if (result.tableForeign) onForeign(kJniTableSlots, table, index->find(reinterpret_cast<uintptr_t>(table)));
+            for (size_t slot = 0; slot < kJniTableSlots; slot++) {
+                if (slots[slot] && !inRuntime(*index, slots[slot], true)) {
+                    onForeign(slot, slots[slot], index->find(reinterpret_cast<uintptr_t>(slots[slot])));
+                }
+            }
+            return result;
+        }
+
+        // Forget the verified table, so the next call looks everything up
+        void reset() { verifiedTable_ = nullptr; }
+
+    private:
+        Result scan(const MappingIndex& index, const void* table, const void* const* slots) const {
+            Result result = {0, 0, !inRuntime(index, table, false), false};
+            for (size_t slot = 0; slot < kJniTableSlots; slot++) {
+                if (!slots[slot]) continue; // the reserved slots
+                result.checked++;
+                if (!inRuntime(index, slots[slot], true)) result.foreign++;
+            }
+            return result;
+        }
+
+        bool inRuntime(const MappingIndex& index, const void* address, bool code) const {
+            const MappingInfo* info = index.find(reinterpret_cast<uintptr_t>(address));
+            if (!info || info->kind != MappingKind::File || (code && !info->executable)) return false;
+
+            size_t slash = info->path.rfind('/');
+            std::string_view name = slash == std::string_view::npos ? info->path : info->path.substr(slash + 1);
+            for (std::string_view library : libraries_) {
+                if (name == library) return true;
+            }
+            return false;
+        }
+
+        std::vector<std::string_view> libraries_;
+        const void* verifiedTable_ = nullptr;
+        size_t verifiedChecked_ = 0;
+        const void* verified_[kJniTableSlots] = {};
+    };
+
+    // Remembers where RegisterNatives bound each of our methods and checks
+    // later that the binding still holds. ART keeps a native method's code
+    // pointer inside its ArtMethod, which is what a jmethodID points to; the
+    // field's offset differs between releases, so it is found by looking for
+    // the pointer just registered. Runtimes that hand out opaque method ids
+    // (debuggable ART, HotSpot) leave the bindings unverifiable, which is
+    // reported rather than treated as suspicious.
+    class NativeBindings {
+    public:
+        struct Result {
+            size_t checked;
+            size_t unverifiable;
+            size_t rebound;
+        };
+
+        // Call right after a successful RegisterNatives on cls
+        void record(JNIEnv* env, jclass cls, const JNINativeMethod* methods, size_t count) {
+            std::shared_ptr<const MappingIndex> index = GetMappingIndex(true);
+            for (size_t i = 0; i < count; i++) {
+                jmethodID id = env->GetMethodID(cls, methods[i].name, methods[i].signature);
+                if (!id) {
+                    env->ExceptionClear();
+                    id = env->GetStaticMethodID(cls, methods[i].name, methods[i].signature);
+                }
+                if (!id) {
+                    env->ExceptionClear();
+                    continue;
+                }
+                size_t offset = index ? locate(*index, id, methods[i].fnPtr) : kUnknown;
+                bindings_.push_back({methods[i].name, id, methods[i].fnPtr, offset});
+            }
+        }
+
+        // onRebound(const char* name, const void* expected, const void* actual)
+        template <typename F>
+        Result verify(F&& onRebound) const {
+            Result result = {};
+            for (const Binding& binding : bindings_) {
+                if (binding.offset == kUnknown) {
+                    result.unverifiable++;
+                    continue;
+                }
+                result.checked++;
+                const void* actual;
+                std::memcpy(&actual, reinterpret_cast<const char*>(binding.method) + binding.offset, sizeof(actual));
+                if (actual != binding.function) {
+                    result.rebound++;
+                    onRebound(binding.name, binding.function, actual);
+                }
+            }
+            return result;
+        }
+
+        size_t size() const { return bindings_.size(); }
+
+        // fn(const char* name, const void* function) for each recorded binding
+        template <typename F>
+        void forEach(F&& fn) const {
+            for (const Binding& binding : bindings_) fn(binding.name, binding.function);
+        }
+
+    private:
+        static constexpr size_t kUnknown = SIZE_MAX;
+        static constexpr size_t kSearchBytes = 64; // ArtMethod is 32-40 bytes on 64-bit
+
+        struct Binding {
+            const char* name;
+            jmethodID method;
+            const void* function;
+            size_t offset;
+        };
+
+        static size_t locate(const MappingIndex& index, jmethodID method, const void* function) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(method);
+            if (address & (alignof(void*) - 1)) return kUnknown; // an opaque id, not a pointer
+
+            const MappingInfo* info = index.find(address);
+            if (!info || !info->readable || info->end - address < kSearchBytes) return kUnknown;
+            for (size_t offset = 0; offset < kSearchBytes; offset += sizeof(void*)) {
+                const void* value;
+                std::memcpy(&value, reinterpret_cast<const char*>(address) + offset, sizeof(value));
+                if (value == function) return offset;
+            }
+            return kUnknown;
+        }
+
+        std::vector<Binding> bindings_;
+    };
+
+    namespace detail {
+        inline std::mutex gNativeBindingsLock;
+        inline NativeBindings gNativeBindings;
+    } // namespace detail
+
+    inline void RecordNativeBindings(JNIEnv* env, jclass cls, const JNINativeMethod* methods, size_t count) {
+        std::lock_guard<std::mutex> guard(detail::gNativeBindingsLock);
+        detail::gNativeBindings.record(env, cls, methods, count);
+    }
+
+    template <typename F>
+    NativeBindings::Result VerifyNativeBindings(F&& onRebound) {
+        std::lock_guard<std::mutex> guard(detail::gNativeBindingsLock);
+        return detail::gNativeBindings.verify(onRebound);
+    }
+
+    template <typename F>
+    void ForEachNativeBinding(F&& fn) {
+        std::lock_guard<std::mutex> guard(detail::gNativeBindingsLock);
+        detail::gNativeBindings.forEach(fn);
+    }
+
+} // namespace checkbeer
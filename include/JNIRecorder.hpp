@@ -0,0 +1,861 @@
+#pragma once
+
+#include <jni.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <time.h>
+
+namespace jni {
+
+    // JNINativeInterface on Android, JNINativeInterface_ in the JDK headers
+    using FunctionTable = std::remove_const_t<std::remove_pointer_t<decltype(std::declval<JNIEnv&>().functions)>>;
+
+    // One recorded JNI call. Operations are identified by their slot in the
+    // JNI function table, which the JNI spec keeps stable across VMs.
+    //   words:     scalar arguments (handles, IDs, jvalues) followed by the result
+    //   strings:   string arguments followed by string outputs
+    //   className: class of a returned object, for reading traces
+    struct CallRecord {
+        uint32_t op = 0;
+        uint64_t durationNs = 0;
+        std::vector<uint64_t> words;
+        std::vector<std::string> strings;
+        std::string className;
+    };
+
+    namespace detail {
+
+        // Trace file layout: "CBJT" + version byte, then records of
+        //   varint op, tagged items..., kItemEnd, varint durationNs
+        // Metadata records use op kMetaOp and carry a key word followed by values.
+        constexpr char kTraceMagic[4] = {'C', 'B', 'J', 'T'};
+        constexpr uint8_t kTraceVersion = 1;
+        constexpr uint32_t kMetaOp = 0xFFFF;
+
+        enum ItemTag : uint8_t {
+            kItemEnd = 0,
+            kItemWord = 1,
+            kItemString = 2,
+            kItemClassName = 3,
+        };
+
+        template <typename M>
+        uint32_t SlotIndex(M FunctionTable::* slot) {
+            static const FunctionTable probe = {};
+            const char* base = reinterpret_cast<const char*>(&probe);
+            return static_cast<uint32_t>((reinterpret_cast<const char*>(&(probe.*slot)) - base) / sizeof(void*));
+        }
+
+        inline int64_t NowNs() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        template <typename T>
+        uint64_t ToWord(T value) {
+            static_assert(sizeof(T) <= sizeof(uint64_t), "JNI value wider than a word");
+            uint64_t word = 0;
+            std::memcpy(&word, &value, sizeof(T));
+            return word;
+        }
+
+        template <typename T>
+        T FromWord(uint64_t word) {
+            T value;
+            std::memcpy(&value, &word, sizeof(T));
+            return value;
+        }
+
+        // First letter of each parameter in a method signature, with arrays
+        // folded into 'L': "(Ljava/lang/String;[II)V" -> "LLI"
+        inline std::string ParameterTypes(const char* signature) {
+            std::string types;
+            if (!signature || *signature != '(') return types;
+            const char* p = signature + 1;
+            while (*p && *p != ')') {
+                bool array = false;
+                while (*p == '[') {
+                    array = true;
+                    p++;
+                }
+                char type = array ? 'L' : *p;
+                if (*p == 'L') {
+                    while (*p && *p != ';') p++;
+                }
+                if (*p) p++;
+                types.push_back(type);
+            }
+            return types;
+        }
+
+        template <auto A, auto B>
+        constexpr bool SameSlot() {
+            if constexpr (std::is_same_v<decltype(A), decltype(B)>) return A == B;
+            else return false;
+        }
+
+        inline uint64_t JValueWord(char type, const jvalue& value) {
+            switch (type) {
+                case 'Z': return value.z;
+                case 'B': return ToWord(value.b);
+                case 'C': return value.c;
+                case 'S': return ToWord(value.s);
+                case 'I': return ToWord(value.i);
+                case 'J': return ToWord(value.j);
+                case 'F': return ToWord(value.f);
+                case 'D': return ToWord(value.d);
+                default: return ToWord(value.l);
+            }
+        }
+
+        inline uint64_t VarArgWord(char type, va_list& args) {
+            switch (type) {
+                case 'Z': case 'B': case 'C': case 'S': case 'I':
+                    return ToWord(static_cast<jint>(va_arg(args, int)));
+                case 'J': return ToWord(static_cast<jlong>(va_arg(args, jlong)));
+                case 'F': return ToWord(static_cast<jfloat>(va_arg(args, double)));
+                case 'D': return ToWord(va_arg(args, double));
+                default: return ToWord(va_arg(args, jobject));
+            }
+        }
+
+        // Modified UTF-8 size of a UTF-16 range, as GetStringUTFRegion writes it
+        inline size_t ModifiedUtf8Length(const jchar* chars, jsize length) {
+            size_t bytes = 0;
+            for (jsize i = 0; i < length; i++) {
+                jchar c = chars[i];
+                bytes += (c != 0 && c < 0x80) ? 1 : (c < 0x800 ? 2 : 3);
+            }
+            return bytes;
+        }
+
+        inline void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        inline bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                uint8_t byte = *p++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+    } // namespace detail
+
+    // JNIEnv that forwards to a real one and logs every call the JNIHelper
+    // and check code makes, with arguments, results, returned class names,
+    // strings and timings. Functions outside that set are forwarded without
+    // being logged. Use get() in place of the real env, then save() the trace.
+    class RecordingEnv {
+    public:
+        explicit RecordingEnv(JNIEnv* real)
+                : functions_(&table_), real_(real), original_(real->functions), table_(*real->functions) {
+            out_.insert(out_.end(), detail::kTraceMagic, detail::kTraceMagic + 4);
+            out_.push_back(detail::kTraceVersion);
+            resolveClassGetName();
+            install();
+        }
+
+        ~RecordingEnv() {
+            if (classClass_) original_->DeleteGlobalRef(real_, classClass_);
+        }
+
+        JNIEnv* get() { return reinterpret_cast<JNIEnv*>(this); }
+
+        // The env calls are forwarded to
+        JNIEnv* real() const { return real_; }
+
+        // Attach caller-defined values (context handles, pre-resolved IDs) to the trace
+        void addMeta(uint32_t key, const uint64_t* values, size_t count) {
+            detail::PutVarint(out_, detail::kMetaOp);
+            putWord(key);
+            for (size_t i = 0; i < count; i++) putWord(values[i]);
+            out_.push_back(detail::kItemEnd);
+            detail::PutVarint(out_, 0);
+        }
+
+        size_t callCount() const { return calls_; }
+
+        const std::vector<uint8_t>& data() const { return out_; }
+
+        bool save(const char* path) const {
+            FILE* file = fopen(path, "wb");
+            if (!file) return false;
+            bool ok = fwrite(out_.data(), 1, out_.size(), file) == out_.size();
+            return fclose(file) == 0 && ok;
+        }
+
+        // Disable copy
+        RecordingEnv(const RecordingEnv&) = delete;
+        RecordingEnv& operator=(const RecordingEnv&) = delete;
+
+    private:
+        static RecordingEnv* self(JNIEnv* env) { return reinterpret_cast<RecordingEnv*>(env); }
+
+        void resolveClassGetName() {
+            jclass cls = original_->FindClass(real_, "java/lang/Class");
+            if (!cls) {
+                original_->ExceptionClear(real_);
+                return;
+            }
+            classClass_ = static_cast<jclass>(original_->NewGlobalRef(real_, cls));
+            original_->DeleteLocalRef(real_, cls);
+            classGetName_ = original_->GetMethodID(real_, classClass_, "getName", "()Ljava/lang/String;");
+            if (!classGetName_) original_->ExceptionClear(real_);
+        }
+
+        // Record layout helpers
+        void begin(uint32_t op) {
+            detail::PutVarint(out_, op);
+            calls_++;
+        }
+        void putWord(uint64_t word) {
+            out_.push_back(detail::kItemWord);
+            detail::PutVarint(out_, word);
+        }
+        void putString(uint8_t tag, const char* str, size_t length) {
+            out_.push_back(tag);
+            detail::PutVarint(out_, length);
+            out_.insert(out_.end(), str, str + length);
+        }
+        void putString(const char* str) { putString(detail::kItemString, str ? str : "", str ? strlen(str) : 0); }
+        void end(int64_t startNs, int64_t endNs = detail::NowNs()) {
+            out_.push_back(detail::kItemEnd);
+            detail::PutVarint(out_, static_cast<uint64_t>(endNs - startNs));
+        }
+
+        // Name of the class of a returned object, looked up on the real env
+        // outside the trace
+        void putClassName(jobject obj) {
+            if (!obj || !classGetName_ || original_->ExceptionCheck(real_)) return;
+            jclass cls = original_->GetObjectClass(real_, obj);
+            jstring name = static_cast<jstring>(original_->CallObjectMethodA(real_, cls, classGetName_, nullptr));
+            if (name && !original_->ExceptionCheck(real_)) {
+                const char* chars = original_->GetStringUTFChars(real_, name, nullptr);
+                if (chars) {
+                    putString(detail::kItemClassName, chars, strlen(chars));
+                    original_->ReleaseStringUTFChars(real_, name, chars);
+                }
+            }
+            original_->ExceptionClear(real_);
+            if (name) original_->DeleteLocalRef(real_, name);
+            original_->DeleteLocalRef(real_, cls);
+        }
+
+        template <typename R>
+        void putResult(R result) {
+            if constexpr (std::is_convertible_v<R, jobject>) {
+                putWord(detail::ToWord(static_cast<jobject>(result)));
+                putClassName(result);
+            } else {
+                putWord(detail::ToWord(result));
+            }
+        }
+
+        void putJValues(jmethodID mid, const jvalue* args) {
+            auto it = paramTypes_.find(mid);
+            if (it == paramTypes_.end() || !args) return;
+            for (size_t i = 0; i < it->second.size(); i++) putWord(detail::JValueWord(it->second[i], args[i]));
+        }
+
+        void putVarArgs(jmethodID mid, va_list args) {
+            auto it = paramTypes_.find(mid);
+            if (it == paramTypes_.end()) return;
+            va_list copy;
+            va_copy(copy, args);
+            for (char type : it->second) putWord(detail::VarArgWord(type, copy));
+            va_end(copy);
+        }
+
+        // Generic wrappers, one instantiation per function table slot
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jmethodID, const jvalue*)>
+        static R callA(JNIEnv* env, Target target, jmethodID mid, const jvalue* args) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(Slot));
+            r->putWord(detail::ToWord(static_cast<jobject>(target)));
+            r->putWord(detail::ToWord(mid));
+            r->putJValues(mid, args);
+            int64_t start = detail::NowNs();
+            if constexpr (std::is_void_v<R>) {
+                (r->original_->*Slot)(r->real_, target, mid, args);
+                r->putWord(0);
+                r->end(start);
+            } else {
+                R result = (r->original_->*Slot)(r->real_, target, mid, args);
+                r->putResult(result);
+                r->end(start);
+                return result;
+            }
+        }
+
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jmethodID, va_list)>
+        static R callV(JNIEnv* env, Target target, jmethodID mid, va_list args) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(Slot));
+            r->putWord(detail::ToWord(static_cast<jobject>(target)));
+            r->putWord(detail::ToWord(mid));
+            r->putVarArgs(mid, args);
+            int64_t start = detail::NowNs();
+            if constexpr (std::is_void_v<R>) {
+                (r->original_->*Slot)(r->real_, target, mid, args);
+                r->putWord(0);
+                r->end(start);
+            } else {
+                R result = (r->original_->*Slot)(r->real_, target, mid, args);
+                r->putResult(result);
+                r->end(start);
+                return result;
+            }
+        }
+
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jfieldID)>
+        static R getField(JNIEnv* env, Target target, jfieldID fid) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(Slot));
+            r->putWord(detail::ToWord(static_cast<jobject>(target)));
+            r->putWord(detail::ToWord(fid));
+            int64_t start = detail::NowNs();
+            R result = (r->original_->*Slot)(r->real_, target, fid);
+            r->putResult(result);
+            r->end(start);
+            return result;
+        }
+
+        template <typename ID, ID (*FunctionTable::*Slot)(JNIEnv*, jclass, const char*, const char*)>
+        static ID getID(JNIEnv* env, jclass cls, const char* name, const char* sig) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(Slot));
+            r->putWord(detail::ToWord(cls));
+            r->putString(name);
+            r->putString(sig);
+            int64_t start = detail::NowNs();
+            ID id = (r->original_->*Slot)(r->real_, cls, name, sig);
+            r->putWord(detail::ToWord(id));
+            r->end(start);
+            if constexpr (std::is_same_v<ID, jmethodID>) {
+                if (id) r->paramTypes_[id] = detail::ParameterTypes(sig);
+            }
+            return id;
+        }
+
+        // Calls whose arguments are all scalars or handles
+        template <auto Slot, typename R, typename... Args>
+        static R simple(JNIEnv* env, Args... args) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(Slot));
+            (r->putWord(detail::ToWord(args)), ...);
+            int64_t start = detail::NowNs();
+            if constexpr (std::is_void_v<R>) {
+                (r->original_->*Slot)(r->real_, args...);
+                r->putWord(0);
+                r->end(start);
+            } else {
+                R result = (r->original_->*Slot)(r->real_, args...);
+                r->putResult(result);
+                r->end(start);
+                return result;
+            }
+        }
+
+        static jclass findClass(JNIEnv* env, const char* name) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(&FunctionTable::FindClass));
+            r->putString(name);
+            int64_t start = detail::NowNs();
+            jclass result = r->original_->FindClass(r->real_, name);
+            r->putWord(detail::ToWord(result));
+            r->end(start);
+            return result;
+        }
+
+        static jstring newStringUTF(JNIEnv* env, const char* bytes) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(&FunctionTable::NewStringUTF));
+            r->putString(bytes);
+            int64_t start = detail::NowNs();
+            jstring result = r->original_->NewStringUTF(r->real_, bytes);
+            r->putWord(detail::ToWord(result));
+            r->end(start);
+            return result;
+        }
+
+        static void getStringUTFRegion(JNIEnv* env, jstring str, jsize start, jsize len, char* buf) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(&FunctionTable::GetStringUTFRegion));
+            r->putWord(detail::ToWord(str));
+            r->putWord(detail::ToWord(start));
+            r->putWord(detail::ToWord(len));
+            int64_t startNs = detail::NowNs();
+            r->original_->GetStringUTFRegion(r->real_, str, start, len, buf);
+            int64_t endNs = detail::NowNs();
+
+            // The region is not NUL-terminated by contract, so size it from the UTF-16 source
+            size_t bytes = 0;
+            if (!r->original_->ExceptionCheck(r->real_)) {
+                std::vector<jchar> chars(static_cast<size_t>(len));
+                r->original_->GetStringRegion(r->real_, str, start, len, chars.data());
+                bytes = detail::ModifiedUtf8Length(chars.data(), len);
+            }
+            r->putString(detail::kItemString, buf, bytes);
+            r->putWord(0);
+            r->end(startNs, endNs);
+        }
+
+        static const char* getStringUTFChars(JNIEnv* env, jstring str, jboolean* isCopy) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(&FunctionTable::GetStringUTFChars));
+            r->putWord(detail::ToWord(str));
+            int64_t start = detail::NowNs();
+            const char* chars = r->original_->GetStringUTFChars(r->real_, str, isCopy);
+            r->putString(chars);
+            r->putWord(0);
+            r->end(start);
+            return chars;
+        }
+
+        static void releaseStringUTFChars(JNIEnv* env, jstring str, const char* chars) {
+            RecordingEnv* r = self(env);
+            r->begin(detail::SlotIndex(&FunctionTable::ReleaseStringUTFChars));
+            r->putWord(detail::ToWord(str));
+            int64_t start = detail::NowNs();
+            r->original_->ReleaseStringUTFChars(r->real_, str, chars);
+            r->putWord(0);
+            r->end(start);
+        }
+
+        void install();
+
+        // Must stay the first member: a RecordingEnv* doubles as the JNIEnv*
+        const FunctionTable* functions_;
+        JNIEnv* real_;
+        const FunctionTable* original_;
+        FunctionTable table_;
+        std::vector<uint8_t> out_;
+        std::unordered_map<jmethodID, std::string> paramTypes_;
+        jclass classClass_ = nullptr;
+        jmethodID classGetName_ = nullptr;
+        size_t calls_ = 0;
+    };
+
+// Install typed call wrappers for one JNI type (Object, Boolean, ...)
+#define JNI_RECORD_TYPED_SLOTS(Owner, Name, Type)                                                             \
+    table_.Call##Name##MethodA = &Owner::callA<Type, jobject, &FunctionTable::Call##Name##MethodA>;              \
+    table_.Call##Name##MethodV = &Owner::callV<Type, jobject, &FunctionTable::Call##Name##MethodV>;              \
+    table_.CallStatic##Name##MethodA = &Owner::callA<Type, jclass, &FunctionTable::CallStatic##Name##MethodA>;   \
+    table_.CallStatic##Name##MethodV = &Owner::callV<Type, jclass, &FunctionTable::CallStatic##Name##MethodV>
+
+#define JNI_RECORD_FIELD_SLOTS(Owner, Name, Type)                                                             \
+    table_.Get##Name##Field = &Owner::getField<Type, jobject, &FunctionTable::Get##Name##Field>;                 \
+    table_.GetStatic##Name##Field = &Owner::getField<Type, jclass, &FunctionTable::GetStatic##Name##Field>
+
+#define JNI_RECORD_ALL_SLOTS(Owner)                                                                           \
+    JNI_RECORD_TYPED_SLOTS(Owner, Object, jobject);                                                           \
+    JNI_RECORD_TYPED_SLOTS(Owner, Boolean, jboolean);                                                         \
+    JNI_RECORD_TYPED_SLOTS(Owner, Byte, jbyte);                                                               \
+    JNI_RECORD_TYPED_SLOTS(Owner, Char, jchar);                                                               \
+    JNI_RECORD_TYPED_SLOTS(Owner, Short, jshort);                                                             \
+    JNI_RECORD_TYPED_SLOTS(Owner, Int, jint);                                                                 \
+    JNI_RECORD_TYPED_SLOTS(Owner, Long, jlong);                                                               \
+    JNI_RECORD_TYPED_SLOTS(Owner, Float, jfloat);                                                             \
+    JNI_RECORD_TYPED_SLOTS(Owner, Double, jdouble);                                                           \
+    JNI_RECORD_TYPED_SLOTS(Owner, Void, void);                                                                \
+    JNI_RECORD_FIELD_SLOTS(Owner, Object, jobject);                                                           \
+    JNI_RECORD_FIELD_SLOTS(Owner, Boolean, jboolean);                                                         \
+    JNI_RECORD_FIELD_SLOTS(Owner, Byte, jbyte);                                                               \
+    JNI_RECORD_FIELD_SLOTS(Owner, Char, jchar);                                                               \
+    JNI_RECORD_FIELD_SLOTS(Owner, Short, jshort);                                                             \
+    JNI_RECORD_FIELD_SLOTS(Owner, Int, jint);                                                                 \
+    JNI_RECORD_FIELD_SLOTS(Owner, Long, jlong);                                                               \
+    JNI_RECORD_FIELD_SLOTS(Owner, Float, jfloat);                                                             \
+    JNI_RECORD_FIELD_SLOTS(Owner, Double, jdouble);                                                           \
+    table_.NewObjectA = &Owner::callA<jobject, jclass, &FunctionTable::NewObjectA>;                          \
+    table_.NewObjectV = &Owner::callV<jobject, jclass, &FunctionTable::NewObjectV>;                          \
+    table_.GetMethodID = &Owner::getID<jmethodID, &FunctionTable::GetMethodID>;                               \
+    table_.GetStaticMethodID = &Owner::getID<jmethodID, &FunctionTable::GetStaticMethodID>;                   \
+    table_.GetFieldID = &Owner::getID<jfieldID, &FunctionTable::GetFieldID>;                                  \
+    table_.GetStaticFieldID = &Owner::getID<jfieldID, &FunctionTable::GetStaticFieldID>;                      \
+    table_.GetObjectClass = &Owner::simple<&FunctionTable::GetObjectClass, jclass, jobject>;                  \
+    table_.GetStringUTFLength = &Owner::simple<&FunctionTable::GetStringUTFLength, jsize, jstring>;           \
+    table_.GetStringLength = &Owner::simple<&FunctionTable::GetStringLength, jsize, jstring>;                 \
+    table_.GetArrayLength = &Owner::simple<&FunctionTable::GetArrayLength, jsize, jarray>;                    \
+    table_.GetObjectArrayElement = &Owner::simple<&FunctionTable::GetObjectArrayElement, jobject, jobjectArray, jsize>; \
+    table_.DeleteLocalRef = &Owner::simple<&FunctionTable::DeleteLocalRef, void, jobject>;                    \
+    table_.DeleteGlobalRef = &Owner::simple<&FunctionTable::DeleteGlobalRef, void, jobject>;                  \
+    table_.NewGlobalRef = &Owner::simple<&FunctionTable::NewGlobalRef, jobject, jobject>;                     \
+    table_.NewLocalRef = &Owner::simple<&FunctionTable::NewLocalRef, jobject, jobject>;                       \
+    table_.IsSameObject = &Owner::simple<&FunctionTable::IsSameObject, jboolean, jobject, jobject>;           \
+    table_.PushLocalFrame = &Owner::simple<&FunctionTable::PushLocalFrame, jint, jint>;                       \
+    table_.PopLocalFrame = &Owner::simple<&FunctionTable::PopLocalFrame, jobject, jobject>;                   \
+    table_.EnsureLocalCapacity = &Owner::simple<&FunctionTable::EnsureLocalCapacity, jint, jint>;             \
+    table_.ExceptionCheck = &Owner::simple<&FunctionTable::ExceptionCheck, jboolean>;                         \
+    table_.ExceptionOccurred = &Owner::simple<&FunctionTable::ExceptionOccurred, jthrowable>;                 \
+    table_.ExceptionDescribe = &Owner::simple<&FunctionTable::ExceptionDescribe, void>;                       \
+    table_.ExceptionClear = &Owner::simple<&FunctionTable::ExceptionClear, void>;                             \
+    table_.FindClass = &Owner::findClass;                                                                     \
+    table_.NewStringUTF = &Owner::newStringUTF;                                                               \
+    table_.GetStringUTFRegion = &Owner::getStringUTFRegion;                                                   \
+    table_.GetStringUTFChars = &Owner::getStringUTFChars;                                                     \
+    table_.ReleaseStringUTFChars = &Owner::releaseStringUTFChars
+
+    inline void RecordingEnv::install() {
+        JNI_RECORD_ALL_SLOTS(RecordingEnv);
+    }
+
+    // JNIEnv that plays a RecordingEnv trace back without a VM. Each call must
+    // match the next record's function, arguments and strings; the recorded
+    // result, string contents and handles are returned. On the first mismatch
+    // the replay stops consuming records, reports a pending exception so
+    // JNI_CHECK_EXCEPTION unwinds the caller, and divergence() says where.
+    // Functions that were never recorded abort.
+    //
+    // Local references are tracked per local frame the way a VM's table would
+    // fill on a native thread that never returns to Java; liveLocalRefs() and
+    // peakLocalRefs() expose the counts, so leaks show up as unbounded growth
+    // across rewind()s.
+    class ReplayEnv {
+    public:
+        explicit ReplayEnv(bool simulateLatency = false)
+                : functions_(&table_), simulateLatency_(simulateLatency) {
+            void (*trap)() = &ReplayEnv::unimplemented;
+            unsigned char* raw = reinterpret_cast<unsigned char*>(&table_);
+            for (size_t offset = 0; offset + sizeof(trap) <= sizeof(table_); offset += sizeof(trap)) {
+                std::memcpy(raw + offset, &trap, sizeof(trap));
+            }
+            install();
+        }
+
+        JNIEnv* get() { return reinterpret_cast<JNIEnv*>(this); }
+
+        bool load(const char* path) {
+            FILE* file = fopen(path, "rb");
+            if (!file) return false;
+            std::vector<uint8_t> data;
+            uint8_t chunk[4096];
+            size_t n;
+            while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+            fclose(file);
+            return parse(data.data(), data.size());
+        }
+
+        // Decode a whole trace up front so replayed calls cost no parsing
+        bool parse(const uint8_t* data, size_t size) {
+            calls_.clear();
+            meta_.clear();
+            next_ = 0;
+            diverged_ = false;
+            divergence_.clear();
+
+            const uint8_t* p = data;
+            const uint8_t* end = data + size;
+            if (size < 5 || std::memcmp(p, detail::kTraceMagic, 4) != 0 || p[4] != detail::kTraceVersion) return false;
+            p += 5;
+
+            while (p < end) {
+                CallRecord record;
+                uint64_t value;
+                if (!detail::GetVarint(p, end, value)) return false;
+                record.op = static_cast<uint32_t>(value);
+
+                for (;;) {
+                    if (p >= end) return false;
+                    uint8_t tag = *p++;
+                    if (tag == detail::kItemEnd) break;
+                    if (!detail::GetVarint(p, end, value)) return false;
+                    if (tag == detail::kItemWord) {
+                        record.words.push_back(value);
+                    } else if (tag == detail::kItemString || tag == detail::kItemClassName) {
+                        if (value > static_cast<uint64_t>(end - p)) return false;
+                        std::string str(reinterpret_cast<const char*>(p), static_cast<size_t>(value));
+                        p += value;
+                        if (tag == detail::kItemString) record.strings.push_back(std::move(str));
+                        else record.className = std::move(str);
+                    } else {
+                        return false;
+                    }
+                }
+                if (!detail::GetVarint(p, end, record.durationNs)) return false;
+
+                if (record.op == detail::kMetaOp) {
+                    if (record.words.empty()) return false;
+                    meta_[static_cast<uint32_t>(record.words[0])].assign(record.words.begin() + 1, record.words.end());
+                } else {
+                    calls_.push_back(std::move(record));
+                }
+            }
+            return true;
+        }
+
+        // Values stored with RecordingEnv::addMeta, or null
+        const std::vector<uint64_t>* meta(uint32_t key) const {
+            auto it = meta_.find(key);
+            return it == meta_.end() ? nullptr : &it->second;
+        }
+
+        // Start the trace over for another run; local references stay live
+        // and the peak starts again from them
+        void rewind() {
+            peakLocalRefs_ = liveLocalRefs_;
+            next_ = 0;
+            diverged_ = false;
+            divergence_.clear();
+        }
+
+        size_t liveLocalRefs() const { return liveLocalRefs_; }
+        size_t peakLocalRefs() const { return peakLocalRefs_; }
+
+        void resetLocalRefs() {
+            frames_.assign(1, 0);
+            liveLocalRefs_ = 0;
+            peakLocalRefs_ = 0;
+        }
+
+        const std::vector<CallRecord>& calls() const { return calls_; }
+        size_t position() const { return next_; }
+        bool finished() const { return !diverged_ && next_ == calls_.size(); }
+        bool diverged() const { return diverged_; }
+        const std::string& divergence() const { return divergence_; }
+
+        // Disable copy
+        ReplayEnv(const ReplayEnv&) = delete;
+        ReplayEnv& operator=(const ReplayEnv&) = delete;
+
+    private:
+        static ReplayEnv* self(JNIEnv* env) { return reinterpret_cast<ReplayEnv*>(env); }
+
+        static void unimplemented() {
+            fprintf(stderr, "ReplayEnv: JNI function outside the recorded set\n");
+            abort();
+        }
+
+        void diverge(const char* what) {
+            if (diverged_) return;
+            diverged_ = true;
+            char buffer[160];
+            uint32_t expected = next_ < calls_.size() ? calls_[next_].op : 0;
+            snprintf(buffer, sizeof(buffer), "call %zu (recorded op %u): %s", next_, expected, what);
+            divergence_ = buffer;
+        }
+
+        // Consume the next record if it matches op, the argument words and the
+        // argument strings; null once the replay has diverged
+        const CallRecord* take(uint32_t op, const uint64_t* words, size_t wordCount,
+                               const char* const* strings = nullptr, size_t stringCount = 0) {
+            if (diverged_) return nullptr;
+            if (next_ >= calls_.size()) {
+                diverge("trace exhausted");
+                return nullptr;
+            }
+            const CallRecord& record = calls_[next_];
+            if (record.op != op) {
+                char what[48];
+                snprintf(what, sizeof(what), "called op %u", op);
+                diverge(what);
+                return nullptr;
+            }
+            if (record.words.size() != wordCount + 1 || !std::equal(words, words + wordCount, record.words.begin())) {
+                diverge("argument mismatch");
+                return nullptr;
+            }
+            for (size_t i = 0; i < stringCount; i++) {
+                if (i >= record.strings.size() || record.strings[i] != (strings[i] ? strings[i] : "")) {
+                    diverge("string argument mismatch");
+                    return nullptr;
+                }
+            }
+            next_++;
+            pace(record);
+            return &record;
+        }
+
+        // Busy-wait for the recorded duration; calls are microseconds long,
+        // well below what a sleep can resolve
+        void pace(const CallRecord& record) const {
+            if (!simulateLatency_ || record.durationNs == 0) return;
+            int64_t until = detail::NowNs() + static_cast<int64_t>(record.durationNs);
+            while (detail::NowNs() < until) {}
+        }
+
+        template <typename R>
+        static R result(const CallRecord* record) {
+            if (!record) return R();
+            return detail::FromWord<R>(record->words.back());
+        }
+
+        // Result of a function that returns a new local reference
+        template <typename R>
+        R localResult(const CallRecord* record) {
+            R ref = result<R>(record);
+            if (ref) {
+                frames_.back()++;
+                liveLocalRefs_++;
+                if (liveLocalRefs_ > peakLocalRefs_) peakLocalRefs_ = liveLocalRefs_;
+            }
+            return ref;
+        }
+
+        void deleteLocal(jobject ref) {
+            if (!ref || frames_.back() == 0) return;
+            frames_.back()--;
+            liveLocalRefs_--;
+        }
+
+        void appendJValues(jmethodID mid, const jvalue* args) {
+            auto it = paramTypes_.find(mid);
+            if (it == paramTypes_.end() || !args) return;
+            for (size_t i = 0; i < it->second.size(); i++) scratch_.push_back(detail::JValueWord(it->second[i], args[i]));
+        }
+
+        void appendVarArgs(jmethodID mid, va_list args) {
+            auto it = paramTypes_.find(mid);
+            if (it == paramTypes_.end()) return;
+            va_list copy;
+            va_copy(copy, args);
+            for (char type : it->second) scratch_.push_back(detail::VarArgWord(type, copy));
+            va_end(copy);
+        }
+
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jmethodID, const jvalue*)>
+        static R callA(JNIEnv* env, Target target, jmethodID mid, const jvalue* args) {
+            ReplayEnv* r = self(env);
+            r->scratch_.assign({detail::ToWord(static_cast<jobject>(target)), detail::ToWord(mid)});
+            r->appendJValues(mid, args);
+            const CallRecord* record = r->take(detail::SlotIndex(Slot), r->scratch_.data(), r->scratch_.size());
+            if constexpr (std::is_convertible_v<R, jobject>) return r->localResult<R>(record);
+            else if constexpr (!std::is_void_v<R>) return result<R>(record);
+        }
+
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jmethodID, va_list)>
+        static R callV(JNIEnv* env, Target target, jmethodID mid, va_list args) {
+            ReplayEnv* r = self(env);
+            r->scratch_.assign({detail::ToWord(static_cast<jobject>(target)), detail::ToWord(mid)});
+            r->appendVarArgs(mid, args);
+            const CallRecord* record = r->take(detail::SlotIndex(Slot), r->scratch_.data(), r->scratch_.size());
+            if constexpr (std::is_convertible_v<R, jobject>) return r->localResult<R>(record);
+            else if constexpr (!std::is_void_v<R>) return result<R>(record);
+        }
+
+        template <typename R, typename Target, R (*FunctionTable::*Slot)(JNIEnv*, Target, jfieldID)>
+        static R getField(JNIEnv* env, Target target, jfieldID fid) {
+            ReplayEnv* r = self(env);
+            uint64_t words[] = {detail::ToWord(static_cast<jobject>(target)), detail::ToWord(fid)};
+            const CallRecord* record = r->take(detail::SlotIndex(Slot), words, 2);
+            if constexpr (std::is_convertible_v<R, jobject>) return r->localResult<R>(record);
+            else return result<R>(record);
+        }
+
+        template <typename ID, ID (*FunctionTable::*Slot)(JNIEnv*, jclass, const char*, const char*)>
+        static ID getID(JNIEnv* env, jclass cls, const char* name, const char* sig) {
+            ReplayEnv* r = self(env);
+            uint64_t words[] = {detail::ToWord(cls)};
+            const char* strings[] = {name, sig};
+            ID id = result<ID>(r->take(detail::SlotIndex(Slot), words, 1, strings, 2));
+            if constexpr (std::is_same_v<ID, jmethodID>) {
+                if (id) r->paramTypes_[id] = detail::ParameterTypes(sig);
+            }
+            return id;
+        }
+
+        template <auto Slot, typename R, typename... Args>
+        static R simple(JNIEnv* env, Args... args) {
+            ReplayEnv* r = self(env);
+            // Stand in for a pending exception so the caller unwinds
+            if constexpr (detail::SameSlot<Slot, &FunctionTable::ExceptionCheck>()) {
+                if (r->diverged_) return JNI_TRUE;
+            }
+            uint64_t words[sizeof...(Args) + 1] = {detail::ToWord(args)...};
+            const CallRecord* record = r->take(detail::SlotIndex(Slot), words, sizeof...(Args));
+
+            if constexpr (detail::SameSlot<Slot, &FunctionTable::DeleteLocalRef>()) {
+                if (record) r->deleteLocal(args...);
+            } else if constexpr (detail::SameSlot<Slot, &FunctionTable::PushLocalFrame>()) {
+                jint status = result<jint>(record);
+                if (record && status == 0) r->frames_.push_back(0);
+                return status;
+            } else if constexpr (detail::SameSlot<Slot, &FunctionTable::PopLocalFrame>()) {
+                if (record && r->frames_.size() > 1) {
+                    r->liveLocalRefs_ -= r->frames_.back();
+                    r->frames_.pop_back();
+                }
+                return r->localResult<R>(record);
+            } else if constexpr (detail::SameSlot<Slot, &FunctionTable::NewGlobalRef>()) {
+                return result<R>(record);
+            } else if constexpr (std::is_convertible_v<R, jobject>) {
+                return r->localResult<R>(record);
+            } else if constexpr (!std::is_void_v<R>) {
+                return result<R>(record);
+            }
+        }
+
+        static jclass findClass(JNIEnv* env, const char* name) {
+            const char* strings[] = {name};
+            ReplayEnv* r = self(env);
+            return r->localResult<jclass>(r->take(detail::SlotIndex(&FunctionTable::FindClass), nullptr, 0, strings, 1));
+        }
+
+        static jstring newStringUTF(JNIEnv* env, const char* bytes) {
+            const char* strings[] = {bytes};
+            ReplayEnv* r = self(env);
+            return r->localResult<jstring>(r->take(detail::SlotIndex(&FunctionTable::NewStringUTF), nullptr, 0, strings, 1));
+        }
+
+        static void getStringUTFRegion(JNIEnv* env, jstring str, jsize start, jsize len, char* buf) {
+            uint64_t words[] = {detail::ToWord(str), detail::ToWord(start), detail::ToWord(len)};
+            const CallRecord* record = self(env)->take(detail::SlotIndex(&FunctionTable::GetStringUTFRegion), words, 3);
+            if (record && !record->strings.empty()) {
+                std::memcpy(buf, record->strings[0].data(), record->strings[0].size());
+            }
+        }
+
+        static const char* getStringUTFChars(JNIEnv* env, jstring str, jboolean* isCopy) {
+            if (isCopy) *isCopy = JNI_FALSE;
+            uint64_t words[] = {detail::ToWord(str)};
+            const CallRecord* record = self(env)->take(detail::SlotIndex(&FunctionTable::GetStringUTFChars), words, 1);
+            return record && !record->strings.empty() ? record->strings[0].c_str() : nullptr;
+        }
+
+        static void releaseStringUTFChars(JNIEnv* env, jstring str, const char* chars) {
+            (void)chars;
+            uint64_t words[] = {detail::ToWord(str)};
+            self(env)->take(detail::SlotIndex(&FunctionTable::ReleaseStringUTFChars), words, 1);
+        }
+
+        void install();
+
+        // Must stay the first member: a ReplayEnv* doubles as the JNIEnv*
+        const FunctionTable* functions_;
+        FunctionTable table_;
+        bool simulateLatency_;
+        std::vector<CallRecord> calls_;
+        std::unordered_map<uint32_t, std::vector<uint64_t>> meta_;
+        std::unordered_map<jmethodID, std::string> paramTypes_;
+        std::vector<uint64_t> scratch_;
+        size_t next_ = 0;
+        bool diverged_ = false;
+        std::string divergence_;
+        std::vector<size_t> frames_ = std::vector<size_t>(1, 0);
+        size_t liveLocalRefs_ = 0;
+        size_t peakLocalRefs_ = 0;
+    };
+
+    inline void ReplayEnv::install() {
+        JNI_RECORD_ALL_SLOTS(ReplayEnv);
+    }
+
+} // namespace jni
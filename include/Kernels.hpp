@@ -0,0 +1,645 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "CpuFeatures.hpp"
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Per-function ISA targets, so one binary carries every variant and the
+// dispatcher picks among them at load
+#if defined(__aarch64__)
+#if defined(__clang__)
+#define CHECK_TARGET_ARM_SHA2 __attribute__((target("crypto")))
+#define CHECK_TARGET_ARM_CRC32 __attribute__((target("crc")))
+#else
+#define CHECK_TARGET_ARM_SHA2 __attribute__((target("+crypto")))
+#define CHECK_TARGET_ARM_CRC32 __attribute__((target("+crc")))
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#define CHECK_TARGET_SSE2 __attribute__((target("sse2")))
+#define CHECK_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define CHECK_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define CHECK_TARGET_SHA_NI __attribute__((target("sha,ssse3,sse4.1")))
+#endif
+
+namespace checkbeer {
+
+    // Compress whole 64-byte blocks into a SHA-256 state
+    using Sha256BlocksFn = void (*)(uint32_t state[8], const uint8_t* data, size_t blocks);
+    // CRC-32C (Castagnoli), the polynomial both ARMv8 and SSE4.2 implement;
+    // pass the previous result to continue a running checksum
+    using Crc32cFn = uint32_t (*)(uint32_t crc, const uint8_t* data, size_t length);
+    using MemchrFn = const uint8_t* (*)(const uint8_t* data, size_t length, uint8_t value);
+    using MemmemFn = const uint8_t* (*)(const uint8_t* data, size_t length, const uint8_t* needle, size_t needleLength);
+
+    // Set of byte values for multi-pattern scanning. Besides the exact bitmap
+    // it keeps nibble tables for the SIMD scanners, which may report false
+    // candidates that the bitmap then rejects.
+    struct ByteSet {
+        uint64_t bits[4] = {};
+        alignas(16) uint8_t low[16] = {};
+        alignas(16) uint8_t high[16] = {};
+
+        void add(uint8_t value) {
+            bits[value >> 6] |= 1ull << (value & 63);
+            uint8_t bucket = static_cast<uint8_t>(1u << ((value >> 4) & 7));
+            low[value & 15] |= bucket;
+            high[value >> 4] = bucket;
+        }
+
+        bool contains(uint8_t value) const {
+            return (bits[value >> 6] >> (value & 63)) & 1;
+        }
+
+        bool empty() const {
+            return (bits[0] | bits[1] | bits[2] | bits[3]) == 0;
+        }
+    };
+
+    using ByteSetFn = const uint8_t* (*)(const uint8_t* data, size_t length, const ByteSet& set);
+    // First i with data[i] in first and data[i + 1] in second
+    using BytePairFn = const uint8_t* (*)(const uint8_t* data, size_t length, const ByteSet& first, const ByteSet& second);
+
+    template <typename Fn>
+    struct KernelVariant {
+        const char* name;
+        uint32_t features; // CpuFeature bits required
+        Fn fn;
+    };
+
+    namespace detail {
+
+        constexpr uint32_t kSha256K[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+
+        inline uint32_t Rotr(uint32_t x, int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        inline void Sha256BlocksScalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+            for (; blocks > 0; blocks--, data += 64) {
+                uint32_t w[64];
+                for (int i = 0; i < 16; i++) {
+                    w[i] = static_cast<uint32_t>(data[4 * i]) << 24 | static_cast<uint32_t>(data[4 * i + 1]) << 16 |
+                           static_cast<uint32_t>(data[4 * i + 2]) << 8 | data[4 * i + 3];
+                }
+                for (int i = 16; i < 64; i++) {
+                    uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+                uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+                for (int i = 0; i < 64; i++) {
+                    uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+                    uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+                state[0] += a;
+                state[1] += b;
+                state[2] += c;
+                state[3] += d;
+                state[4] += e;
+                state[5] += f;
+                state[6] += g;
+                state[7] += h;
+            }
+        }
+
+        struct Crc32cTables {
+            uint32_t t[8][256];
+        };
+
+        constexpr Crc32cTables MakeCrc32cTables() {
+            Crc32cTables tables = {};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+                tables.t[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; i++) {
+                for (int k = 1; k < 8; k++) {
+                    uint32_t prev = tables.t[k - 1][i];
+                    tables.t[k][i] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+                }
+            }
+            return tables;
+        }
+
+        inline constexpr Crc32cTables kCrc32cTables = MakeCrc32cTables();
+
+        // Slicing-by-8
+        inline uint32_t Crc32cScalar(uint32_t crc, const uint8_t* data, size_t length) {
+            const auto& t = kCrc32cTables.t;
+            crc = ~crc;
+            while (length >= 8) {
+                uint32_t lo, hi;
+                std::memcpy(&lo, data, 4);
+                std::memcpy(&hi, data + 4, 4);
+                lo ^= crc;
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+                data += 8;
+                length -= 8;
+            }
+            while (length--) crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+            return ~crc;
+        }
+
+        inline const uint8_t* MemchrLibc(const uint8_t* data, size_t length, uint8_t value) {
+            return static_cast<const uint8_t*>(std::memchr(data, value, length));
+        }
+
+        inline const uint8_t* MemmemScalar(const uint8_t* data, size_t length, const uint8_t* needle, size_t needleLength) {
+            if (needleLength == 0) return data;
+            if (needleLength > length) return nullptr;
+            const uint8_t* last = data + (length - needleLength);
+            for (const uint8_t* p = data; p <= last; p++) {
+                p = static_cast<const uint8_t*>(std::memchr(p, needle[0], static_cast<size_t>(last - p) + 1));
+                if (!p) return nullptr;
+                if (std::memcmp(p + 1, needle + 1, needleLength - 1) == 0) return p;
+            }
+            return nullptr;
+        }
+
+        inline const uint8_t* FindAnyByteScalar(const uint8_t* data, size_t length, const ByteSet& set) {
+            for (size_t i = 0; i < length; i++) {
+                if (set.contains(data[i])) return data + i;
+            }
+            return nullptr;
+        }
+
+        inline const uint8_t* FindBytePairScalar(const uint8_t* data, size_t length, const ByteSet& first, const ByteSet& second) {
+            for (size_t i = 0; i + 1 < length; i++) {
+                if (first.contains(data[i]) && second.contains(data[i + 1])) return data + i;
+            }
+            return nullptr;
+        }
+
+#if defined(__aarch64__)
+        CHECK_TARGET_ARM_SHA2
+        inline void Sha256BlocksArm(uint32_t state[8], const uint8_t* data, size_t blocks) {
+            uint32x4_t state0 = vld1q_u32(&state[0]);
+            uint32x4_t state1 = vld1q_u32(&state[4]);
+
+            for (; blocks > 0; blocks--, data += 64) {
+                uint32x4_t abcdSave = state0;
+                uint32x4_t efghSave = state1;
+
+                uint32x4_t msg[4];
+                for (int i = 0; i < 4; i++) {
+                    msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+                }
+
+                // Four rounds per step; the schedule for step i + 4 is derived
+                // in place from steps i..i+3
+                for (int i = 0; i < 16; i++) {
+                    uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&kSha256K[4 * i]));
+                    if (i < 12) msg[i & 3] = vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]);
+                    uint32x4_t abcd = state0;
+                    state0 = vsha256hq_u32(state0, state1, wk);
+                    state1 = vsha256h2q_u32(state1, abcd, wk);
+                    if (i < 12) msg[i & 3] = vsha256su1q_u32(msg[i & 3], msg[(i + 2) & 3], msg[(i + 3) & 3]);
+                }
+
+                state0 = vaddq_u32(state0, abcdSave);
+                state1 = vaddq_u32(state1, efghSave);
+            }
+
+            vst1q_u32(&state[0], state0);
+            vst1q_u32(&state[4], state1);
+        }
+
+        CHECK_TARGET_ARM_CRC32
+        inline uint32_t Crc32cArm(uint32_t crc, const uint8_t* data, size_t length) {
+            crc = ~crc;
+            while (length >= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+                crc = __crc32cd(crc, word);
+                data += 8;
+                length -= 8;
+            }
+            while (length--) crc = __crc32cb(crc, *data++);
+            return ~crc;
+        }
+
+        // One bit per byte lane packed four to a nibble: 0xF per match
+        inline uint64_t NeonMask(uint8x16_t matches) {
+            return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+        }
+
+        inline const uint8_t* MemchrNeon(const uint8_t* data, size_t length, uint8_t value) {
+            uint8x16_t target = vdupq_n_u8(value);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                uint64_t mask = NeonMask(vceqq_u8(vld1q_u8(data + i), target));
+                if (mask) return data + i + (__builtin_ctzll(mask) >> 2);
+            }
+            return MemchrLibc(data + i, length - i, value);
+        }
+
+        // First and last needle bytes filtered 16 positions at a time
+        inline const uint8_t* MemmemNeon(const uint8_t* data, size_t length, const uint8_t* needle, size_t needleLength) {
+            if (needleLength < 2 || needleLength > length) return MemmemScalar(data, length, needle, needleLength);
+            uint8x16_t first = vdupq_n_u8(needle[0]);
+            uint8x16_t last = vdupq_n_u8(needle[needleLength - 1]);
+            size_t i = 0;
+            for (; i + 16 + needleLength - 1 <= length; i += 16) {
+                uint8x16_t a = vceqq_u8(vld1q_u8(data + i), first);
+                uint8x16_t b = vceqq_u8(vld1q_u8(data + i + needleLength - 1), last);
+                uint64_t mask = NeonMask(vandq_u8(a, b));
+                while (mask) {
+                    int lane = __builtin_ctzll(mask) >> 2;
+                    if (std::memcmp(data + i + lane + 1, needle + 1, needleLength - 2) == 0) return data + i + lane;
+                    mask &= ~(0xFull << (lane * 4));
+                }
+            }
+            return MemmemScalar(data + i, length - i, needle, needleLength);
+        }
+
+        inline const uint8_t* FindAnyByteNeon(const uint8_t* data, size_t length, const ByteSet& set) {
+            uint8x16_t low = vld1q_u8(set.low);
+            uint8x16_t high = vld1q_u8(set.high);
+            uint8x16_t nibble = vdupq_n_u8(0x0F);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                uint8x16_t v = vld1q_u8(data + i);
+                uint8x16_t lo = vqtbl1q_u8(low, vandq_u8(v, nibble));
+                uint8x16_t hi = vqtbl1q_u8(high, vshrq_n_u8(v, 4));
+                uint64_t mask = NeonMask(vtstq_u8(lo, hi));
+                while (mask) {
+                    int lane = __builtin_ctzll(mask) >> 2;
+                    if (set.contains(data[i + lane])) return data + i + lane;
+                    mask &= ~(0xFull << (lane * 4));
+                }
+            }
+            return FindAnyByteScalar(data + i, length - i, set);
+        }
+
+        // Classify 16 bytes at i and 16 at i + 1, keep lanes where both hit
+        inline const uint8_t* FindBytePairNeon(const uint8_t* data, size_t length, const ByteSet& first, const ByteSet& second) {
+            uint8x16_t low0 = vld1q_u8(first.low);
+            uint8x16_t high0 = vld1q_u8(first.high);
+            uint8x16_t low1 = vld1q_u8(second.low);
+            uint8x16_t high1 = vld1q_u8(second.high);
+            uint8x16_t nibble = vdupq_n_u8(0x0F);
+            size_t i = 0;
+            for (; i + 17 <= length; i += 16) {
+                uint8x16_t a = vld1q_u8(data + i);
+                uint8x16_t b = vld1q_u8(data + i + 1);
+                uint8x16_t hitA = vtstq_u8(vqtbl1q_u8(low0, vandq_u8(a, nibble)), vqtbl1q_u8(high0, vshrq_n_u8(a, 4)));
+                uint8x16_t hitB = vtstq_u8(vqtbl1q_u8(low1, vandq_u8(b, nibble)), vqtbl1q_u8(high1, vshrq_n_u8(b, 4)));
+                uint64_t mask = NeonMask(vandq_u8(hitA, hitB));
+                while (mask) {
+                    int lane = __builtin_ctzll(mask) >> 2;
+                    if (first.contains(data[i + lane]) && second.contains(data[i + lane + 1])) return data + i + lane;
+                    mask &= ~(0xFull << (lane * 4));
+                }
+            }
+            return FindBytePairScalar(data + i, length - i, first, second);
+        }
+#elif defined(__x86_64__) || defined(__i386__)
+        CHECK_TARGET_SHA_NI
+        inline void Sha256BlocksShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+            // The SHA extensions want the state as ABEF / CDGH
+            __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+            __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+            __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+            state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+            const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+            for (; blocks > 0; blocks--, data += 64) {
+                __m128i abefSave = state0;
+                __m128i cdghSave = state1;
+
+                __m128i msg[4];
+                for (int i = 0; i < 4; i++) {
+                    msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+                }
+
+                // Four rounds per step; the schedule for step i + 4 is derived
+                // in place from steps i..i+3
+                for (int i = 0; i < 16; i++) {
+                    __m128i wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&kSha256K[4 * i])));
+                    state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+                    if (i < 12) {
+                        __m128i next = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                        next = _mm_add_epi32(next, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                        msg[i & 3] = _mm_sha256msg2_epu32(next, msg[(i + 3) & 3]);
+                    }
+                }
+
+                state0 = _mm_add_epi32(state0, abefSave);
+                state1 = _mm_add_epi32(state1, cdghSave);
+            }
+
+            tmp = _mm_shuffle_epi32(state0, 0x1B);
+            state1 = _mm_shuffle_epi32(state1, 0xB1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));
+        }
+
+        CHECK_TARGET_SSE42
+        inline uint32_t Crc32cSse42(uint32_t crc, const uint8_t* data, size_t length) {
+            crc = ~crc;
+#if defined(__x86_64__)
+            uint64_t crc64 = crc;
+            while (length >= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+                crc64 = _mm_crc32_u64(crc64, word);
+                data += 8;
+                length -= 8;
+            }
+            crc = static_cast<uint32_t>(crc64);
+#else
+            while (length >= 4) {
+                uint32_t word;
+                std::memcpy(&word, data, 4);
+                crc = _mm_crc32_u32(crc, word);
+                data += 4;
+                length -= 4;
+            }
+#endif
+            while (length--) crc = _mm_crc32_u8(crc, *data++);
+            return ~crc;
+        }
+
+        CHECK_TARGET_SSE2
+        inline const uint8_t* MemchrSse2(const uint8_t* data, size_t length, uint8_t value) {
+            __m128i target = _mm_set1_epi8(static_cast<char>(value));
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+                if (mask) return data + i + __builtin_ctz(static_cast<unsigned>(mask));
+            }
+            return MemchrLibc(data + i, length - i, value);
+        }
+
+        // First and last needle bytes filtered 16 positions at a time
+        CHECK_TARGET_SSE2
+        inline const uint8_t* MemmemSse2(const uint8_t* data, size_t length, const uint8_t* needle, size_t needleLength) {
+            if (needleLength < 2 || needleLength > length) return MemmemScalar(data, length, needle, needleLength);
+            __m128i first = _mm_set1_epi8(static_cast<char>(needle[0]));
+            __m128i last = _mm_set1_epi8(static_cast<char>(needle[needleLength - 1]));
+            size_t i = 0;
+            for (; i + 16 + needleLength - 1 <= length; i += 16) {
+                __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), first);
+                __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needleLength - 1)), last);
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+                while (mask) {
+                    int lane = __builtin_ctz(mask);
+                    if (std::memcmp(data + i + lane + 1, needle + 1, needleLength - 2) == 0) return data + i + lane;
+                    mask &= mask - 1;
+                }
+            }
+            return MemmemScalar(data + i, length - i, needle, needleLength);
+        }
+
+        CHECK_TARGET_SSSE3
+        inline const uint8_t* FindAnyByteSsse3(const uint8_t* data, size_t length, const ByteSet& set) {
+            __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(set.low));
+            __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(set.high));
+            __m128i nibble = _mm_set1_epi8(0x0F);
+            __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                __m128i lo = _mm_shuffle_epi8(low, _mm_and_si128(v, nibble));
+                __m128i hi = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero))) ^ 0xFFFFu;
+                while (mask) {
+                    int lane = __builtin_ctz(mask);
+                    if (set.contains(data[i + lane])) return data + i + lane;
+                    mask &= mask - 1;
+                }
+            }
+            return FindAnyByteScalar(data + i, length - i, set);
+        }
+
+        // Classify 16 bytes at i and 16 at i + 1, keep lanes where both hit
+        CHECK_TARGET_SSSE3
+        inline const uint8_t* FindBytePairSsse3(const uint8_t* data, size_t length, const ByteSet& first, const ByteSet& second) {
+            __m128i low0 = _mm_load_si128(reinterpret_cast<const __m128i*>(first.low));
+            __m128i high0 = _mm_load_si128(reinterpret_cast<const __m128i*>(first.high));
+            __m128i low1 = _mm_load_si128(reinterpret_cast<const __m128i*>(second.low));
+            __m128i high1 = _mm_load_si128(reinterpret_cast<const __m128i*>(second.high));
+            __m128i nibble = _mm_set1_epi8(0x0F);
+            __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 17 <= length; i += 16) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+                __m128i hitA = _mm_and_si128(_mm_shuffle_epi8(low0, _mm_and_si128(a, nibble)),
+                                             _mm_shuffle_epi8(high0, _mm_and_si128(_mm_srli_epi16(a, 4), nibble)));
+                __m128i hitB = _mm_and_si128(_mm_shuffle_epi8(low1, _mm_and_si128(b, nibble)),
+                                             _mm_shuffle_epi8(high1, _mm_and_si128(_mm_srli_epi16(b, 4), nibble)));
+                unsigned maskA = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(hitA, zero))) ^ 0xFFFFu;
+                unsigned maskB = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(hitB, zero))) ^ 0xFFFFu;
+                unsigned mask = maskA & maskB;
+                while (mask) {
+                    int lane = __builtin_ctz(mask);
+                    if (first.contains(data[i + lane]) && second.contains(data[i + lane + 1])) return data + i + lane;
+                    mask &= mask - 1;
+                }
+            }
+            return FindBytePairScalar(data + i, length - i, first, second);
+        }
+#endif
+
+    } // namespace detail
+
+    // Variants in order of preference; one entry in each needs nothing
+    inline const KernelVariant<Sha256BlocksFn> kSha256Variants[] = {
+#if defined(__aarch64__)
+            {"armv8-sha2", kCpuArmSha2, detail::Sha256BlocksArm},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"sha-ni", kCpuShaNi | kCpuSsse3 | kCpuSse41, detail::Sha256BlocksShaNi},
+#endif
+            {"scalar", 0, detail::Sha256BlocksScalar},
+    };
+
+    inline const KernelVariant<Crc32cFn> kCrc32cVariants[] = {
+#if defined(__aarch64__)
+            {"armv8-crc32", kCpuArmCrc32, detail::Crc32cArm},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"sse4.2", kCpuSse42, detail::Crc32cSse42},
+#endif
+            {"slice8", 0, detail::Crc32cScalar},
+    };
+
+    // libc's memchr is hand-vectorised on every platform we ship and beats the
+    // inline loops on long runs; those stay for the benchmark to keep it honest
+    inline const KernelVariant<MemchrFn> kMemchrVariants[] = {
+            {"libc", 0, detail::MemchrLibc},
+#if defined(__aarch64__)
+            {"neon", kCpuNeon, detail::MemchrNeon},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"sse2", kCpuSse2, detail::MemchrSse2},
+#endif
+    };
+
+    inline const KernelVariant<MemmemFn> kMemmemVariants[] = {
+#if defined(__aarch64__)
+            {"neon", kCpuNeon, detail::MemmemNeon},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"sse2", kCpuSse2, detail::MemmemSse2},
+#endif
+            {"scalar", 0, detail::MemmemScalar},
+    };
+
+    inline const KernelVariant<ByteSetFn> kByteSetVariants[] = {
+#if defined(__aarch64__)
+            {"neon", kCpuNeon, detail::FindAnyByteNeon},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"ssse3", kCpuSsse3, detail::FindAnyByteSsse3},
+#endif
+            {"scalar", 0, detail::FindAnyByteScalar},
+    };
+
+    inline const KernelVariant<BytePairFn> kBytePairVariants[] = {
+#if defined(__aarch64__)
+            {"neon", kCpuNeon, detail::FindBytePairNeon},
+#elif defined(__x86_64__) || defined(__i386__)
+            {"ssse3", kCpuSsse3, detail::FindBytePairSsse3},
+#endif
+            {"scalar", 0, detail::FindBytePairScalar},
+    };
+
+    // First variant whose requirements the CPU meets
+    template <typename Fn, size_t N>
+    const KernelVariant<Fn>& SelectVariant(const KernelVariant<Fn> (&variants)[N], uint32_t features) {
+        for (const KernelVariant<Fn>& variant : variants) {
+            if ((variant.features & features) == variant.features) return variant;
+        }
+        return variants[N - 1];
+    }
+
+    // The dispatch table every hashing and scanning feature calls through
+    struct Kernels {
+        KernelVariant<Sha256BlocksFn> sha256;
+        KernelVariant<Crc32cFn> crc32c;
+        KernelVariant<MemchrFn> memchr;
+        KernelVariant<MemmemFn> memmem;
+        KernelVariant<ByteSetFn> findAnyByte;
+        KernelVariant<BytePairFn> findBytePair;
+    };
+
+    inline Kernels SelectKernels(uint32_t features) {
+        return {SelectVariant(kSha256Variants, features), SelectVariant(kCrc32cVariants, features),
+                SelectVariant(kMemchrVariants, features), SelectVariant(kMemmemVariants, features),
+                SelectVariant(kByteSetVariants, features), SelectVariant(kBytePairVariants, features)};
+    }
+
+    // Selected on first use; SignatureCheck.hpp forces that at library load
+    inline const Kernels& GetKernels() {
+        static const Kernels kernels = SelectKernels(GetCpuFeatures());
+        return kernels;
+    }
+
+    inline uint32_t Crc32c(const void* data, size_t length, uint32_t crc = 0) {
+        return GetKernels().crc32c.fn(crc, static_cast<const uint8_t*>(data), length);
+    }
+
+    inline const uint8_t* FindByte(const uint8_t* data, size_t length, uint8_t value) {
+        return GetKernels().memchr.fn(data, length, value);
+    }
+
+    inline const uint8_t* FindBytes(const uint8_t* data, size_t length, const uint8_t* needle, size_t needleLength) {
+        return GetKernels().memmem.fn(data, length, needle, needleLength);
+    }
+
+    inline const uint8_t* FindAnyByte(const uint8_t* data, size_t length, const ByteSet& set) {
+        return GetKernels().findAnyByte.fn(data, length, set);
+    }
+
+    inline const uint8_t* FindBytePair(const uint8_t* data, size_t length, const ByteSet& first, const ByteSet& second) {
+        return GetKernels().findBytePair.fn(data, length, first, second);
+    }
+
+    // Incremental SHA-256 over the dispatched block function
+    class Sha256 {
+    public:
+        static constexpr size_t kDigestSize = 32;
+
+        explicit Sha256(Sha256BlocksFn blocks = GetKernels().sha256.fn) : blocks_(blocks) {}
+
+        void update(const void* data, size_t length) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            length_ += length;
+            if (buffered_ > 0) {
+                size_t take = length < 64 - buffered_ ? length : 64 - buffered_;
+                std::memcpy(buffer_ + buffered_, p, take);
+                buffered_ += take;
+                p += take;
+                length -= take;
+                if (buffered_ < 64) return;
+                blocks_(state_, buffer_, 1);
+                buffered_ = 0;
+            }
+            if (length >= 64) {
+                blocks_(state_, p, length / 64);
+                p += length & ~static_cast<size_t>(63);
+                length &= 63;
+            }
+            std::memcpy(buffer_, p, length);
+            buffered_ = length;
+        }
+
+        void final(uint8_t digest[kDigestSize]) {
+            uint64_t bits = length_ * 8;
+            uint8_t pad[72] = {0x80};
+            size_t padLength = (buffered_ < 56 ? 56 : 120) - buffered_;
+            for (int i = 0; i < 8; i++) pad[padLength + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            update(pad, padLength + 8);
+            for (int i = 0; i < 8; i++) {
+                digest[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+                digest[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+                digest[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+                digest[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+            }
+        }
+
+        static void hash(const void* data, size_t length, uint8_t digest[kDigestSize]) {
+            Sha256 sha;
+            sha.update(data, length);
+            sha.final(digest);
+        }
+
+    private:
+        uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        uint8_t buffer_[64];
+        size_t buffered_ = 0;
+        uint64_t length_ = 0;
+        Sha256BlocksFn blocks_;
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace checkbeer {
+
+    // Point-in-time view of a LatencyHistogram. Percentiles are reported as the
+    // midpoint of the bucket they fall in, so they are within about 3% of the
+    // true value.
+    struct LatencySnapshot {
+        uint64_t count;
+        int64_t minNs;
+        int64_t maxNs;
+        int64_t meanNs;
+        int64_t p50Ns;
+        int64_t p99Ns;
+        int64_t p999Ns;
+    };
+
+    // Lock-free log-linear histogram of nanosecond latencies in the style of
+    // HdrHistogram: each power of two is split into kSubBuckets linear buckets.
+    // Values of 2^kMaxExponent ns (~34 s) and above land in the last bucket.
+    // Recording is a handful of relaxed atomic adds, so concurrent writers never
+    // block each other; snapshot() and reset() are not atomic with respect to
+    // writers, which costs at most a sample or two.
+    class LatencyHistogram {
+    public:
+        static constexpr int kSubBucketBits = 4;
+        static constexpr int kSubBuckets = 1 << kSubBucketBits;
+        static constexpr int kMaxExponent = 35;
+        static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+        void record(int64_t ns) {
+            if (ns < 0) ns = 0;
+            counts_[bucketIndex(static_cast<uint64_t>(ns))].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(ns, std::memory_order_relaxed);
+
+            int64_t seen = min_.load(std::memory_order_relaxed);
+            while (ns < seen && !min_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+            seen = max_.load(std::memory_order_relaxed);
+            while (ns > seen && !max_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+        }
+
+        LatencySnapshot snapshot() const {
+            uint64_t counts[kBucketCount];
+            uint64_t total = 0;
+            for (int i = 0; i < kBucketCount; i++) {
+                counts[i] = counts_[i].load(std::memory_order_relaxed);
+                total += counts[i];
+            }
+
+            LatencySnapshot snap = {};
+            snap.count = total;
+            if (total == 0) return snap;
+
+            snap.minNs = min_.load(std::memory_order_relaxed);
+            snap.maxNs = max_.load(std::memory_order_relaxed);
+            snap.meanNs = sum_.load(std::memory_order_relaxed) / static_cast<int64_t>(total);
+            snap.p50Ns = clamp(percentile(counts, total, 500), snap.minNs, snap.maxNs);
+            snap.p99Ns = clamp(percentile(counts, total, 990), snap.minNs, snap.maxNs);
+            snap.p999Ns = clamp(percentile(counts, total, 999), snap.minNs, snap.maxNs);
+            return snap;
+        }
+
+        void reset() {
+            for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+            sum_.store(0, std::memory_order_relaxed);
+            min_.store(INT64_MAX, std::memory_order_relaxed);
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        static int bucketIndex(uint64_t v) {
+            if (v < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(v);
+            int exponent = 63 - __builtin_clzll(v);
+            if (exponent >= kMaxExponent) return kBucketCount - 1;
+            int shift = exponent - kSubBucketBits;
+            return (shift + 1) * kSubBuckets + static_cast<int>((v >> shift) - kSubBuckets);
+        }
+
+        // Midpoint of the value range covered by a bucket
+        static int64_t bucketValue(int index) {
+            if (index < kSubBuckets) return index;
+            int shift = index / kSubBuckets - 1;
+            int64_t lower = static_cast<int64_t>(index % kSubBuckets + kSubBuckets) << shift;
+            return lower + ((static_cast<int64_t>(1) << shift) >> 1);
+        }
+
+    private:
+        static int64_t clamp(int64_t v, int64_t lo, int64_t hi) {
+            return v < lo ? lo : (v > hi ? hi : v);
+        }
+
+        // perMille of 999 is p99.9
+        static int64_t percentile(const uint64_t* counts, uint64_t total, uint64_t perMille) {
+            uint64_t rank = (total * perMille + 999) / 1000;
+            if (rank == 0) rank = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < kBucketCount; i++) {
+                seen += counts[i];
+                if (seen >= rank) return bucketValue(i);
+            }
+            return bucketValue(kBucketCount - 1);
+        }
+
+        std::atomic<uint64_t> counts_[kBucketCount] = {};
+        std::atomic<int64_t> sum_{0};
+        std::atomic<int64_t> min_{INT64_MAX};
+        std::atomic<int64_t> max_{0};
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Kernels.hpp"
+#include "ProcReader.hpp"
+#include "Trace.hpp"
+
+namespace checkbeer {
+
+    enum class MappingKind : uint8_t {
+        File,       // backed by a path on disk
+        Anonymous,  // no path at all
+        Memfd,      // "/memfd:name", a file with no directory entry
+        Named,      // "[anon:name]", anonymous memory named with prctl
+        Special,    // "[stack]", "[vdso]" and the like
+    };
+
+    inline MappingKind ClassifyMapping(std::string_view path) {
+        if (path.empty()) return MappingKind::Anonymous;
+        if (path.compare(0, 7, "/memfd:") == 0) return MappingKind::Memfd;
+        if (path.compare(0, 6, "[anon:") == 0) return MappingKind::Named;
+        if (path[0] == '[') return MappingKind::Special;
+        return MappingKind::File;
+    }
+
+    // One mapping as remembered between runs: its range plus a CRC32C of the
+    // whole maps line, which covers permissions, offset, inode and path
+    struct MappingRecord {
+        uintptr_t start;
+        uintptr_t end;
+        uint32_t lineCrc;
+        uint32_t flags; // MappingMonitor::kFlagged, set by the caller's verdict
+    };
+
+    // Keeps the last /proc/self/maps as a sorted array and, on each update,
+    // hands only the mappings that are new or changed since then to the
+    // caller. Unchanged lines cost a hex parse and a CRC; only changed ones
+    // are fully parsed. Both arrays are reused, so steady-state updates do
+    // not allocate. Not thread-safe.
+    class MappingMonitor {
+    public:
+        static constexpr uint32_t kFlagged = 1u << 0;
+
+        struct UpdateStats {
+            size_t mappings;
+            size_t changed;
+            size_t flagged; // flagged mappings still present, new or not
+        };
+
+        // onChanged(const MapsEntry&) returns true to flag the mapping; the
+        // flag sticks for as long as the line stays the same. Returns false
+        // if the file cannot be read.
+        template <typename F>
+        bool update(const char* path, char* buffer, size_t size, F&& onChanged) {
+            ProcReader maps(path, buffer, size);
+            if (!maps.ok()) return false;
+
+            next_.clear();
+            stats_ = {};
+            size_t cursor = 0;
+            std::string_view line;
+            while (maps.next(line)) {
+                std::string_view text = line;
+                uint64_t start, end;
+                if (!detail::ParseHex(text, start) || !detail::Consume(text, '-') || !detail::ParseHex(text, end)) {
+                    continue;
+                }
+                MappingRecord record = {static_cast<uintptr_t>(start), static_cast<uintptr_t>(end),
+                                        Crc32c(line.data(), line.size()), 0};
+
+                // Both lists are sorted by address, so the old one is walked once
+                while (cursor < current_.size() && current_[cursor].start < record.start) cursor++;
+                if (cursor < current_.size() && current_[cursor].start == record.start &&
+                    current_[cursor].end == record.end && current_[cursor].lineCrc == record.lineCrc) {
+                    record.flags = current_[cursor].flags;
+                } else {
+                    stats_.changed++;
+                    MapsEntry entry;
+                    if (MapsEntry::parse(line, entry) && onChanged(static_cast<const MapsEntry&>(entry))) {
+                        record.flags |= kFlagged;
+                    }
+                }
+                if (record.flags & kFlagged) stats_.flagged++;
+                next_.push_back(record);
+            }
+
+            current_.swap(next_);
+            stats_.mappings = current_.size();
+            return true;
+        }
+
+        const std::vector<MappingRecord>& mappings() const { return current_; }
+
+        const UpdateStats& lastUpdate() const { return stats_; }
+
+    private:
+        std::vector<MappingRecord> current_;
+        std::vector<MappingRecord> next_;
+        UpdateStats stats_ = {};
+    };
+
+    // One mapping in a MappingIndex; path points into the index and is
+    // followed there by a NUL, so path.data() can be passed to open
+    struct MappingInfo {
+        uintptr_t start;
+        uintptr_t end;
+        uint64_t offset;
+        uint64_t inode;
+        uint32_t devMajor;
+        uint32_t devMinor;
+        std::string_view path;
+        bool readable;
+        bool writable;
+        bool executable;
+        bool shared;
+        MappingKind kind;
+    };
+
+    // Immutable snapshot of /proc/self/maps answering "which mapping holds
+    // this address". Start addresses sit in their own array so the search
+    // touches 8 bytes per probe; paths share one string. Build a new one
+    // when the maps change rather than updating in place, so lookups on a
+    // snapshot never take a lock.
+    class MappingIndex {
+    public:
+        // Read path twice at most: once to hash, and again to build only
+        // if the hash differs from previous'. Returns previous when nothing
+        // changed, nullptr if the file cannot be read. A rebuild reuses
+        // *spare, a retired snapshot no one else holds, when there is one,
+        // so its arrays only grow if the maps did.
+        static std::shared_ptr<const MappingIndex> Refresh(const std::shared_ptr<const MappingIndex>& previous,
+                                                          const char* path, char* buffer, size_t size,
+                                                          std::shared_ptr<MappingIndex>* spare = nullptr) {
+            if (previous) {
+                ProcReader maps(path, buffer, size);
+                if (!maps.ok()) return nullptr;
+                uint32_t crc = 0;
+                std::string_view lines;
+                while (maps.nextLines(lines)) crc = Crc32c(lines.data(), lines.size(), crc);
+                if (crc == previous->crc_) return previous;
+            }
+
+            std::shared_ptr<MappingIndex> index;
+            if (spare && *spare) {
+                index = std::move(*spare);
+                index->clear();
+            } else {
+                index.reset(new MappingIndex());
+            }
+            if (!index->build(path, buffer, size)) return nullptr;
+            return index;
+        }
+
+        // The mapping containing address, nullptr if none does
+        const MappingInfo* find(uintptr_t address) const {
+            size_t n = starts_.size();
+            if (n == 0) return nullptr;
+
+            // Branchless lower bound: the loop runs log2(n) times whatever
+            // the data, and the select compiles to a conditional move
+            const uintptr_t* base = starts_.data();
+            while (n > 1) {
+                size_t half = n / 2;
+                __builtin_prefetch(base + half / 2);
+                __builtin_prefetch(base + half + half / 2);
+                base = base[half] <= address ? base + half : base;
+                n -= half;
+            }
+            const MappingInfo& info = entries_[static_cast<size_t>(base - starts_.data())];
+            return address >= info.start && address < info.end ? &info : nullptr;
+        }
+
+        // Lowest address of the file that mapping comes from, i.e. where its
+        // ELF header is; 0 for mappings not backed by a file
+        uintptr_t moduleBase(const MappingInfo& info) const {
+            if (info.kind != MappingKind::File) return 0;
+            uintptr_t base = info.start - info.offset;
+            const MappingInfo* first = find(base);
+            return first && first->path == info.path ? base : 0;
+        }
+
+        size_t size() const { return entries_.size(); }
+
+        const MappingInfo& operator[](size_t i) const { return entries_[i]; }
+
+        // Position of a mapping returned by find, for walking its neighbours
+        size_t indexOf(const MappingInfo& info) const { return static_cast<size_t>(&info - entries_.data()); }
+
+        uint32_t crc() const { return crc_; }
+
+    private:
+        // Where each entry's path sits in paths_ until it stops growing
+        struct PendingPath {
+            size_t offset;
+            size_t length;
+        };
+
+        MappingIndex() = default;
+
+        // Empty the arrays but keep their capacity
+        void clear() {
+            starts_.clear();
+            entries_.clear();
+            pending_.clear();
+            paths_.clear();
+            crc_ = 0;
+        }
+
+        bool build(const char* path, char* buffer, size_t size) {
+            CHECK_TRACE_SPAN("MappingIndex:build");
+            ProcReader maps(path, buffer, size);
+            if (!maps.ok()) return false;
+
+            std::vector<PendingPath>& pending = pending_;
+            std::string_view lines;
+            while (maps.nextLines(lines)) {
+                crc_ = Crc32c(lines.data(), lines.size(), crc_);
+                while (!lines.empty()) {
+                    const uint8_t* start = reinterpret_cast<const uint8_t*>(lines.data());
+                    const uint8_t* newline = FindByte(start, lines.size(), '\n');
+                    size_t length = newline ? static_cast<size_t>(newline - start) : lines.size();
+                    std::string_view line = lines.substr(0, length);
+                    lines.remove_prefix(newline ? length + 1 : length);
+
+                    MapsEntry entry;
+                    if (!MapsEntry::parse(line, entry)) continue;
+
+                    // Consecutive mappings of one file share its path
+                    if (pending.empty() || paths_.compare(pending.back().offset, pending.back().length,
+                                                          entry.path.data(), entry.path.size()) != 0) {
+                        pending.push_back({paths_.size(), entry.path.size()});
+                        paths_.append(entry.path.data(), entry.path.size());
+                        paths_.push_back('\0');
+                    } else {
+                        pending.push_back(pending.back());
+                    }
+                    starts_.push_back(entry.start);
+                    entries_.push_back({entry.start, entry.end, entry.offset, entry.inode, entry.devMajor,
+                                        entry.devMinor, {}, entry.readable, entry.writable, entry.executable,
+                                        entry.shared, ClassifyMapping(entry.path)});
+                }
+            }
+
+            // paths_ has stopped growing, so views into it are now stable
+            for (size_t i = 0; i < entries_.size(); i++) {
+                entries_[i].path = std::string_view(paths_).substr(pending[i].offset, pending[i].length);
+            }
+            return true;
+        }
+
+        std::vector<uintptr_t> starts_;
+        std::vector<MappingInfo> entries_;
+        std::vector<PendingPath> pending_; // kept only for the next build into this snapshot
+        std::string paths_;
+        uint32_t crc_ = 0;
+    };
+
+    namespace detail {
+        inline std::mutex gMappingIndexLock;
+        inline std::shared_ptr<const MappingIndex> gMappingIndex;
+        inline std::shared_ptr<MappingIndex> gSpareMappingIndex;
+    } // namespace detail
+
+    // The process-wide snapshot, re-read from /proc/self/maps when refresh
+    // is set (or none exists yet) and rebuilt only if the maps changed.
+    // Callers keep the returned pointer for as long as they look things up.
+    inline std::shared_ptr<const MappingIndex> GetMappingIndex(bool refresh) {
+        std::lock_guard<std::mutex> guard(detail::gMappingIndexLock);
+        if (refresh || !detail::gMappingIndex) {
+            char buffer[16 << 10];
+            std::shared_ptr<const MappingIndex> index = MappingIndex::Refresh(
+                    detail::gMappingIndex, "/proc/self/maps", buffer, sizeof(buffer), &detail::gSpareMappingIndex);
+            if (index && index != detail::gMappingIndex) {
+                // Snapshots only reach callers through here, under the lock,
+                // so one held by nothing else stays that way and the next
+                // rebuild can reuse its storage
+                if (detail::gMappingIndex.use_count() == 1) {
+                    detail::gSpareMappingIndex = std::const_pointer_cast<MappingIndex>(std::move(detail::gMappingIndex));
+                }
+                detail::gMappingIndex = std::move(index);
+            }
+        }
+        return detail::gMappingIndex;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+#include "CheckMetrics.hpp"
+#include "MemoryScanner.hpp"
+
+namespace checkbeer {
+
+    // Map regionBytes of pseudo-random data with a signature at its tail and
+    // scan the whole process with MemoryScanner, unbudgeted and then in 2 ms
+    // slices, next to a direct PatternSet scan of the same region (no
+    // process_vm_readv copy). Meant for a Linux host. Returns false if the
+    // planted signature was missed.
+    inline bool RunMemoryScanBenchmark(char* buffer, size_t size, size_t regionBytes = 64 << 20) {
+        if (size == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        void* mapping = mmap(nullptr, regionBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            append("cannot map %zu bytes\n", regionBytes);
+            return false;
+        }
+        uint8_t* region = static_cast<uint8_t*>(mapping);
+        uint32_t seed = 0x2545F491;
+        for (size_t i = 0; i < regionBytes; i++) {
+            seed = seed * 1664525 + 1013904223;
+            region[i] = static_cast<uint8_t>('a' + (seed >> 24) % 26);
+        }
+
+        // Assembled at run time so the needle's only copy is inside region
+        std::string needle = std::string("bench") + "-signature-" + std::to_string(seed & 0xFFFF);
+        std::memcpy(region + regionBytes - needle.size() - 7, needle.data(), needle.size());
+        uintptr_t planted = reinterpret_cast<uintptr_t>(region + regionBytes - needle.size() - 7);
+        MemorySignature signature = {"bench signature", needle, false};
+
+        char lineBuffer[16 << 10];
+        bool found = false;
+        auto onMatch = [&](const MemorySignature&, uintptr_t address) { found |= address == planted; };
+
+        append("%-20s %10s %9s %8s %s\n", "mode", "MiB", "ms", "MB/s", "runs");
+
+        MemoryScanner full(&signature, 1);
+        ScanProgress progress = full.scan({SIZE_MAX, INT64_MAX}, lineBuffer, sizeof(lineBuffer), onMatch);
+        append("%-20s %10.1f %9.2f %8.0f %d\n", "process_vm_readv", progress.bytesScanned / 1048576.0,
+               progress.elapsedNs / 1e6,
+               progress.elapsedNs > 0 ? progress.bytesScanned * 1000.0 / progress.elapsedNs : 0.0, 1);
+        bool fullFound = found;
+
+        found = false;
+        MemoryScanner sliced(&signature, 1);
+        size_t bytes = 0;
+        int64_t elapsed = 0;
+        int runs = 0;
+        for (bool done = false; !done && runs < 100000; runs++) {
+            ScanProgress slice = sliced.scan({SIZE_MAX, 2000000}, lineBuffer, sizeof(lineBuffer), onMatch);
+            bytes += slice.bytesScanned;
+            elapsed += slice.elapsedNs;
+            done = slice.passCompleted;
+        }
+        append("%-20s %10.1f %9.2f %8.0f %d\n", "2 ms slices", bytes / 1048576.0, elapsed / 1e6,
+               elapsed > 0 ? bytes * 1000.0 / elapsed : 0.0, runs);
+        bool slicedFound = found;
+
+        std::string_view view(reinterpret_cast<const char*>(region), regionBytes);
+        PatternSet direct(&signature.bytes, 1);
+        size_t directHits = 0;
+        int64_t start = MonotonicNs();
+        direct.scan(view, [&](size_t, size_t) {
+            directHits++;
+            return true;
+        });
+        int64_t directNs = MonotonicNs() - start;
+        append("%-20s %10.1f %9.2f %8.0f %d\n", "direct (region)", regionBytes / 1048576.0, directNs / 1e6,
+               directNs > 0 ? regionBytes * 1000.0 / directNs : 0.0, 1);
+
+        munmap(mapping, regionBytes);
+        bool ok = fullFound && slicedFound && directHits == 1;
+        append("planted signature: %s\n", ok ? "found" : "MISSED");
+        return ok;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "CheckMetrics.hpp"
+#include "PatternSet.hpp"
+#include "ProcReader.hpp"
+
+namespace checkbeer {
+
+    // A byte string that gives away instrumentation when found in memory.
+    // The name is what gets reported and must not itself contain the bytes.
+    struct MemorySignature {
+        const char* name;
+        std::string_view bytes;
+        bool executableOnly; // code patterns, meaningless in data
+    };
+
+    struct ScanBudget {
+        size_t maxBytes;
+        int64_t maxNs;
+    };
+
+    struct ScanProgress {
+        size_t bytesScanned;
+        size_t unreadableBytes;
+        size_t regionsVisited;
+        size_t matches;
+        int64_t elapsedNs;
+        bool passCompleted; // reached the top of the address space this run
+    };
+
+    // Searches the readable private mappings of this process for a set of
+    // signatures, a bounded slice per call. Memory is copied out with
+    // process_vm_readv on our own pid, so a page unmapped underneath the scan
+    // fails the read instead of faulting. Where the previous call stopped is
+    // remembered and the next call resumes there; after the last region the
+    // scan wraps to the bottom on the following call. Not thread-safe.
+    class MemoryScanner {
+    public:
+        static constexpr size_t kChunkSize = 64 << 10;
+
+        MemoryScanner(const MemorySignature* signatures, size_t count) {
+            std::vector<std::string_view> all;
+            std::vector<std::string_view> data;
+            for (size_t i = 0; i < count; i++) {
+                if (signatures[i].bytes.empty()) continue;
+                signatures_.push_back(signatures[i]);
+                all.push_back(signatures[i].bytes);
+                if (!signatures[i].executableOnly) {
+                    data.push_back(signatures[i].bytes);
+                    dataIds_.push_back(signatures_.size() - 1);
+                }
+            }
+            codePatterns_ = std::make_unique<PatternSet>(all.data(), all.size());
+            dataPatterns_ = std::make_unique<PatternSet>(data.data(), data.size());
+            overlap_ = codePatterns_->maxLength() > 0 ? codePatterns_->maxLength() - 1 : 0;
+            chunk_.resize(kChunkSize + overlap_);
+        }
+
+        // Skip the file holding address, e.g. our own library, whose
+        // read-only data holds every signature. Goes by device and inode,
+        // so every mapping of the file is covered: the loaded module, a
+        // copy mapped to read its sections, or the APK it is loaded from
+        // uncompressed. Also skips the .bss right after the loaded module.
+        // Returns false if no file mapping contains address.
+        bool excludeModuleOf(const void* address, char* buffer, size_t size) {
+            uintptr_t target = reinterpret_cast<uintptr_t>(address);
+            uintptr_t moduleEnd = 0;
+            uint64_t inode = 0;
+            FileKey file = {};
+            bool found = false;
+
+            // Mappings are in address order: follow the run of mappings
+            // sharing an inode, and stop once the run holding target ends
+            MapsReader maps("/proc/self/maps", buffer, size);
+            for (const MapsEntry& entry : maps) {
+                bool sameModule = entry.inode != 0 && entry.inode == inode && entry.start == moduleEnd;
+                if (found) {
+                    if (sameModule) {
+                        moduleEnd = entry.end;
+                        continue;
+                    }
+                    if (entry.start == moduleEnd && entry.inode == 0 &&
+                        (entry.path.empty() || entry.path == "[anon:.bss]")) {
+                        excluded_.push_back({entry.start, entry.end});
+                    }
+                    break;
+                }
+                inode = entry.inode;
+                moduleEnd = entry.end;
+                if (target >= entry.start && target < entry.end && entry.inode != 0) {
+                    found = true;
+                    file = {entry.devMajor, entry.devMinor, entry.inode};
+                }
+            }
+            if (!found) return false;
+
+            excludedFiles_.push_back(file);
+            return true;
+        }
+
+        // onMatch(const MemorySignature&, uintptr_t address) is called for
+        // every hit. lineBuffer is for reading /proc/self/maps.
+        template <typename F>
+        ScanProgress scan(const ScanBudget& budget, char* lineBuffer, size_t lineBufferSize, F&& onMatch) {
+            CHECK_TRACE_SPAN("MemoryScanner:slice");
+            ScanProgress progress = {};
+            int64_t start = MonotonicNs();
+
+            // Our own stack holds the maps lines and the chunk buffer holds
+            // copies of what was just scanned; neither is evidence
+            int marker = 0;
+            uintptr_t stack = reinterpret_cast<uintptr_t>(&marker);
+            uintptr_t chunkStart = reinterpret_cast<uintptr_t>(chunk_.data());
+            uintptr_t chunkEnd = chunkStart + chunk_.size();
+
+            MapsReader maps("/proc/self/maps", lineBuffer, lineBufferSize);
+            bool stopped = false;
+            for (const MapsEntry& entry : maps) {
+                if (entry.end <= cursor_ || !entry.readable || entry.shared) continue;
+                if (stack >= entry.start && stack < entry.end) continue;
+                if (entry.path == "[vvar]" || entry.path == "[vsyscall]") continue;
+                if (entry.inode != 0 && isExcludedFile(entry)) continue;
+
+                uintptr_t from = entry.start > cursor_ ? entry.start : cursor_;
+                const PatternSet& patterns = entry.executable ? *codePatterns_ : *dataPatterns_;
+                const size_t* ids = entry.executable ? nullptr : dataIds_.data();
+                progress.regionsVisited++;
+
+                // Split around the ranges that must not be scanned
+                while (from < entry.end && !stopped) {
+                    uintptr_t to = entry.end;
+                    bool skipped = false;
+                    for (const Range& range : excluded_) {
+                        if (from >= range.start && from < range.end) {
+                            from = range.end;
+                            skipped = true;
+                        } else if (range.start > from && range.start < to) {
+                            to = range.start;
+                        }
+                    }
+                    if (from >= chunkStart && from < chunkEnd) {
+                        from = chunkEnd;
+                        skipped = true;
+                    } else if (chunkStart > from && chunkStart < to) {
+                        to = chunkStart;
+                    }
+                    if (skipped) continue;
+
+                    stopped = !scanRange(from, to, patterns, ids, budget, start, progress, onMatch);
+                    from = to;
+                }
+                if (stopped) break;
+            }
+
+            if (!stopped) {
+                cursor_ = 0;
+                reportedUpTo_ = 0;
+                passes_++;
+                lastPassMatches_ = passMatches_;
+                passMatches_ = 0;
+                progress.passCompleted = true;
+            }
+            progress.elapsedNs = MonotonicNs() - start;
+            return progress;
+        }
+
+        // Matches in the pass under way plus the last complete one, so a
+        // finding is not forgotten while the scan is elsewhere
+        size_t recentMatches() const { return passMatches_ + lastPassMatches_; }
+
+        size_t passes() const { return passes_; }
+
+        uintptr_t cursor() const { return cursor_; }
+
+        void reset() {
+            cursor_ = 0;
+            reportedUpTo_ = 0;
+            passMatches_ = lastPassMatches_ = 0;
+        }
+
+        // Disable copy
+        MemoryScanner(const MemoryScanner&) = delete;
+        MemoryScanner& operator=(const MemoryScanner&) = delete;
+
+    private:
+        struct Range {
+            uintptr_t start;
+            uintptr_t end;
+        };
+
+        struct FileKey {
+            uint32_t devMajor;
+            uint32_t devMinor;
+            uint64_t inode;
+        };
+
+        bool isExcludedFile(const MapsEntry& entry) const {
+            for (const FileKey& file : excludedFiles_) {
+                if (entry.inode == file.inode && entry.devMajor == file.devMajor && entry.devMinor == file.devMinor) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Scan [from, to) chunk by chunk, carrying the last overlap_ bytes
+        // so a signature split across chunks is still seen. Returns false
+        // once the budget is spent, with the cursor left to resume.
+        template <typename F>
+        bool scanRange(uintptr_t from, uintptr_t to, const PatternSet& patterns, const size_t* ids,
+                       const ScanBudget& budget, int64_t start, ScanProgress& progress, F& onMatch) {
+            pid_t pid = getpid();
+            size_t carry = 0;
+            uintptr_t address = from;
+            while (address < to) {
+                if (progress.bytesScanned >= budget.maxBytes || MonotonicNs() - start >= budget.maxNs) {
+                    // The next call rereads the carried tail for signatures
+                    // that straddle address; the ones wholly inside it have
+                    // been reported already
+                    cursor_ = address - carry;
+                    reportedUpTo_ = address;
+                    return false;
+                }
+
+                size_t want = to - address < kChunkSize ? to - address : kChunkSize;
+                struct iovec local = {chunk_.data() + carry, want};
+                struct iovec remote = {reinterpret_cast<void*>(address), want};
+                ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+                if (n <= 0) {
+                    // Unreadable page (guard, or unmapped meanwhile): skip it
+                    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+                    uintptr_t next = (address & ~(page - 1)) + page;
+                    progress.unreadableBytes += next - address;
+                    address = next;
+                    carry = 0;
+                    continue;
+                }
+
+                size_t length = carry + static_cast<size_t>(n);
+                uintptr_t base = address - carry;
+                patterns.scan(std::string_view(reinterpret_cast<const char*>(chunk_.data()), length),
+                              [&](size_t id, size_t offset) {
+                                  // Wholly inside the carried bytes: seen last chunk,
+                                  // or by the call that stopped there
+                                  size_t end = offset + patterns.pattern(id).size();
+                                  if (end <= carry || base + end <= reportedUpTo_) return true;
+                                  const MemorySignature& signature = signatures_[ids ? ids[id] : id];
+                                  progress.matches++;
+                                  passMatches_++;
+                                  onMatch(signature, base + offset);
+                                  return true;
+                              });
+
+                progress.bytesScanned += static_cast<size_t>(n);
+                address += static_cast<uintptr_t>(n);
+                carry = length < overlap_ ? length : overlap_;
+                std::memmove(chunk_.data(), chunk_.data() + length - carry, carry);
+            }
+            cursor_ = to;
+            return true;
+        }
+
+        std::vector<MemorySignature> signatures_;
+        std::vector<size_t> dataIds_;          // dataPatterns_ id -> signatures_ index
+        std::unique_ptr<PatternSet> codePatterns_; // every signature, for executable regions
+        std::unique_ptr<PatternSet> dataPatterns_; // data signatures only
+        std::vector<Range> excluded_;          // .bss of excluded modules
+        std::vector<FileKey> excludedFiles_;
+        std::vector<uint8_t> chunk_;
+        size_t overlap_ = 0;
+        uintptr_t cursor_ = 0;
+        uintptr_t reportedUpTo_ = 0; // where a stopped slice had reported matches to
+        size_t passes_ = 0;
+        size_t passMatches_ = 0;
+        size_t lastPassMatches_ = 0;
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <poll.h>
+
+#include "ProcReader.hpp"
+#include "RawSyscall.hpp"
+#include "Trace.hpp"
+
+namespace checkbeer {
+
+    namespace detail {
+        // Undo mountinfo's octal escapes: "\040" space, "\011" tab,
+        // "\012" newline, "\134" backslash
+        inline std::string UnescapeMountPath(std::string_view text) {
+            std::string out;
+            out.reserve(text.size());
+            for (size_t i = 0; i < text.size(); i++) {
+                auto octal = [&](size_t at, char highest) { return text[at] >= '0' && text[at] <= highest; };
+                if (text[i] == '\\' && i + 3 < text.size() && octal(i + 1, '3') && octal(i + 2, '7') &&
+                    octal(i + 3, '7')) {
+                    out.push_back(static_cast<char>((text[i + 1] - '0') * 64 + (text[i + 2] - '0') * 8 +
+                                                    (text[i + 3] - '0')));
+                    i += 3;
+                } else {
+                    out.push_back(text[i]);
+                }
+            }
+            return out;
+        }
+
+        // path is dir itself or somewhere under it
+        inline bool IsUnder(std::string_view path, std::string_view dir) {
+            while (dir.size() > 1 && dir.back() == '/') dir.remove_suffix(1);
+            if (path.compare(0, dir.size(), dir) != 0) return false;
+            return path.size() == dir.size() || path[dir.size()] == '/' || dir == "/";
+        }
+    } // namespace detail
+
+    // One mount as kept by MountTable, paths unescaped
+    struct MountPoint {
+        uint32_t mountId;
+        uint32_t parentId;
+        uint32_t devMajor;
+        uint32_t devMinor;
+        std::string root;       // what part of the source is mounted here
+        std::string mountPoint;
+        std::string fsType;
+        std::string source;
+    };
+
+    // This process's mount table, parsed from /proc/self/mountinfo and kept
+    // between runs. The file stays open: the kernel flags it with POLLPRI
+    // whenever a mount is added, moved or removed in our namespace, so
+    // refresh() polls it without waiting and re-reads only when flagged.
+    // Not thread-safe.
+    class MountTable {
+    public:
+        explicit MountTable(size_t bufferSize = 16 << 10) : MountTable("/proc/self/mountinfo", bufferSize) {}
+
+        // A table read from another mountinfo file, e.g. a saved copy
+        MountTable(const char* path, size_t bufferSize)
+                : buffer_(bufferSize), reader_(path, buffer_.data(), buffer_.size()) {}
+
+        // Returns false if mountinfo cannot be read; reread() tells whether
+        // this call parsed it again
+        bool refresh() {
+            reread_ = false;
+            if (!reader_.ok()) return false;
+            if (loaded_) {
+                struct pollfd event = {reader_.fd(), POLLPRI, 0};
+                if (RawPoll(&event, 1, 0) == 0) return true;
+            }
+
+            CHECK_TRACE_SPAN("MountTable:reread");
+            mounts_.clear();
+            reader_.rewind();
+            std::string_view line;
+            while (reader_.next(line)) {
+                MountInfoEntry entry;
+                if (!MountInfoEntry::parse(line, entry)) continue;
+                mounts_.push_back({entry.mountId, entry.parentId, entry.devMajor, entry.devMinor,
+                                   detail::UnescapeMountPath(entry.root), detail::UnescapeMountPath(entry.mountPoint),
+                                   std::string(entry.fsType), detail::UnescapeMountPath(entry.source)});
+            }
+            loaded_ = true;
+            reread_ = true;
+            reads_++;
+            return true;
+        }
+
+        // Call fn(const MountPoint&) for each mount placed over path: on
+        // path itself, anywhere under it, or on a directory above it that
+        // is still under root. root is where path's file system should
+        // have been mounted from the top, e.g. "/data/app", so mounts of
+        // "/" or "/data" do not count.
+        template <typename F>
+        size_t forEachCovering(std::string_view path, std::string_view root, F&& fn) const {
+            size_t count = 0;
+            for (const MountPoint& mount : mounts_) {
+                bool inside = detail::IsUnder(mount.mountPoint, path);
+                bool above = detail::IsUnder(path, mount.mountPoint) && detail::IsUnder(mount.mountPoint, root);
+                if (!inside && !above) continue;
+                count++;
+                fn(mount);
+            }
+            return count;
+        }
+
+        const std::vector<MountPoint>& mounts() const { return mounts_; }
+
+        bool reread() const { return reread_; }
+
+        size_t reads() const { return reads_; }
+
+        // Disable copy
+        MountTable(const MountTable&) = delete;
+        MountTable& operator=(const MountTable&) = delete;
+
+    private:
+        std::vector<char> buffer_;
+        ProcReader reader_;
+        std::vector<MountPoint> mounts_;
+        size_t reads_ = 0;
+        bool loaded_ = false;
+        bool reread_ = false;
+    };
+
+} // namespace checkbeer
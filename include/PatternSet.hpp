@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+#include "Kernels.hpp"
+
+namespace checkbeer {
+
+    // A fixed set of substrings matched against text in one pass: an
+    // Aho-Corasick automaton built once (typically as a function-local
+    // static), after which scanning never allocates.
+    //
+    // The automaton is a dense DFA over byte classes. Bytes that occur in no
+    // pattern share class 0, so a set of a few dozen names needs a few KB of
+    // uint16_t transitions that stay in L1.
+    //
+    // While the DFA sits in its root state no match is in progress, so the
+    // scan jumps ahead with a SIMD prefilter to the next position where a
+    // pattern could start: the first two bytes both plausible, or only the
+    // first when some pattern is a single byte.
+    class PatternSet {
+    public:
+        enum class Prefilter {
+            None,
+            FirstByte,
+            BytePair,
+        };
+
+        // Patterns must outlive the set; string literals are the usual case.
+        // The sum of pattern lengths must stay below 65535.
+        PatternSet(std::initializer_list<const char*> patterns) {
+            for (const char* pattern : patterns) {
+                if (pattern[0] != '\0') patterns_.emplace_back(pattern);
+            }
+            build();
+        }
+
+        // Binary patterns may contain NUL bytes; empty ones are ignored
+        PatternSet(const std::string_view* patterns, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                if (!patterns[i].empty()) patterns_.push_back(patterns[i]);
+            }
+            build();
+        }
+
+        size_t size() const { return patterns_.size(); }
+
+        std::string_view pattern(size_t id) const { return patterns_[id]; }
+
+        size_t stateCount() const { return stateCount_; }
+
+        size_t classCount() const { return classCount_; }
+
+        size_t maxLength() const { return maxLength_; }
+
+        Prefilter prefilter() const { return prefilter_; }
+
+        // Benchmarks compare the prefilters; BytePair falls back to FirstByte
+        // when a pattern is a single byte
+        void setPrefilter(Prefilter prefilter) {
+            prefilter_ = prefilter == Prefilter::BytePair && minLength_ < 2 ? Prefilter::FirstByte : prefilter;
+        }
+
+        // Call fn(patternId, offset) for every occurrence in text, in order of
+        // where the occurrence ends; fn returns false to stop early
+        template <typename F>
+        void scan(std::string_view text, F&& fn) const {
+            if (patterns_.empty()) return;
+
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+            const uint8_t* end = data + text.size();
+            const uint8_t* p = data;
+            const uint16_t* transitions = transitions_.data();
+            uint32_t state = 0;
+
+            while (p < end) {
+                if (state == 0) {
+                    size_t remaining = static_cast<size_t>(end - p);
+                    if (prefilter_ == Prefilter::BytePair) {
+                        p = FindBytePair(p, remaining, firstBytes_, secondBytes_);
+                    } else if (prefilter_ == Prefilter::FirstByte) {
+                        p = FindAnyByte(p, remaining, firstBytes_);
+                    }
+                    if (!p) return;
+                }
+
+                state = transitions[state * classCount_ + classes_[*p]];
+                p++;
+                for (uint32_t i = outputStart_[state]; i < outputStart_[state + 1]; i++) {
+                    uint16_t id = outputs_[i];
+                    size_t offset = static_cast<size_t>(p - data) - patterns_[id].size();
+                    if (!fn(static_cast<size_t>(id), offset)) return;
+                }
+            }
+        }
+
+        bool matches(std::string_view text) const {
+            bool found = false;
+            scan(text, [&](size_t, size_t) {
+                found = true;
+                return false;
+            });
+            return found;
+        }
+
+    private:
+        void build() {
+            // Byte classes: one per byte that appears in some pattern
+            std::memset(classes_, 0, sizeof(classes_));
+            classCount_ = 1;
+            minLength_ = SIZE_MAX;
+            for (std::string_view pattern : patterns_) {
+                for (char c : pattern) {
+                    uint8_t byte = static_cast<uint8_t>(c);
+                    if (classes_[byte] == 0) classes_[byte] = static_cast<uint16_t>(classCount_++);
+                }
+                firstBytes_.add(static_cast<uint8_t>(pattern[0]));
+                if (pattern.size() > 1) secondBytes_.add(static_cast<uint8_t>(pattern[1]));
+                if (pattern.size() < minLength_) minLength_ = pattern.size();
+                if (pattern.size() > maxLength_) maxLength_ = pattern.size();
+            }
+
+            // Trie, with 0 meaning "no edge" (the root is never a target)
+            std::vector<uint16_t> trie(classCount_, 0);
+            std::vector<std::vector<uint16_t>> matches(1);
+            stateCount_ = 1;
+            for (size_t id = 0; id < patterns_.size(); id++) {
+                uint32_t state = 0;
+                for (char c : patterns_[id]) {
+                    uint16_t& next = trie[state * classCount_ + classes_[static_cast<uint8_t>(c)]];
+                    if (next == 0) {
+                        next = static_cast<uint16_t>(stateCount_++);
+                        trie.resize(stateCount_ * classCount_, 0);
+                        matches.emplace_back();
+                    }
+                    state = trie[state * classCount_ + classes_[static_cast<uint8_t>(c)]];
+                }
+                matches[state].push_back(static_cast<uint16_t>(id));
+            }
+
+            // Breadth-first over the trie: failure links become DFA edges and
+            // each state inherits the matches of its failure state
+            transitions_.assign(stateCount_ * classCount_, 0);
+            std::vector<uint16_t> failure(stateCount_, 0);
+            std::vector<uint16_t> queue;
+            queue.reserve(stateCount_);
+            for (size_t c = 0; c < classCount_; c++) {
+                uint16_t next = trie[c];
+                transitions_[c] = next;
+                if (next != 0) queue.push_back(next);
+            }
+            for (size_t head = 0; head < queue.size(); head++) {
+                uint16_t state = queue[head];
+                const std::vector<uint16_t>& inherited = matches[failure[state]];
+                matches[state].insert(matches[state].end(), inherited.begin(), inherited.end());
+
+                for (size_t c = 0; c < classCount_; c++) {
+                    uint16_t next = trie[state * classCount_ + c];
+                    uint16_t fallback = transitions_[failure[state] * classCount_ + c];
+                    if (next != 0) {
+                        failure[next] = fallback;
+                        transitions_[state * classCount_ + c] = next;
+                        queue.push_back(next);
+                    } else {
+                        transitions_[state * classCount_ + c] = fallback;
+                    }
+                }
+            }
+
+            outputStart_.assign(stateCount_ + 1, 0);
+            for (size_t state = 0; state < stateCount_; state++) {
+                outputStart_[state + 1] = outputStart_[state] + static_cast<uint32_t>(matches[state].size());
+                outputs_.insert(outputs_.end(), matches[state].begin(), matches[state].end());
+            }
+
+            setPrefilter(Prefilter::BytePair);
+        }
+
+        std::vector<std::string_view> patterns_;
+        uint16_t classes_[256];
+        size_t classCount_ = 1;
+        size_t stateCount_ = 1;
+        size_t minLength_ = 0;
+        size_t maxLength_ = 0;
+        std::vector<uint16_t> transitions_;  // [state * classCount_ + class]
+        std::vector<uint32_t> outputStart_;  // outputs_[outputStart_[s]..outputStart_[s + 1]) end at s
+        std::vector<uint16_t> outputs_;
+        ByteSet firstBytes_;
+        ByteSet secondBytes_;
+        Prefilter prefilter_ = Prefilter::BytePair;
+    };
+
+} // namespace checkbeer
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+#include "CheckMetrics.hpp"
+#include "Kernels.hpp"
+#include "ThreadPool.hpp"
+
+namespace checkbeer {
+
+    // Hash taskCount slices of a shared buffer on pools of different shapes:
+    // one pinned worker, every core, the efficiency cores, and the same
+    // worker counts under SCHED_IDLE. Meant for a Linux host, where cpus can
+    // be pinned freely; on a phone the "efficiency" row is the one that
+    // matters. Reports wall time, summed task CPU time, speedup over the
+    // single pinned worker and the number of steals.
+    inline bool RunPoolBenchmark(char* buffer, size_t size, size_t taskCount = 64, size_t taskBytes = 256 << 10) {
+        if (size == 0 || taskCount == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        std::vector<uint8_t> data(taskCount * taskBytes);
+        uint32_t seed = 0x9E3779B9;
+        for (uint8_t& byte : data) {
+            seed = seed * 1664525 + 1013904223;
+            byte = static_cast<uint8_t>(seed >> 24);
+        }
+
+        std::vector<uint8_t> reference(taskCount * Sha256::kDigestSize);
+        for (size_t i = 0; i < taskCount; i++) {
+            Sha256::hash(&data[i * taskBytes], taskBytes, &reference[i * Sha256::kDigestSize]);
+        }
+
+        struct Config {
+            const char* name;
+            ThreadPoolOptions options;
+        };
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t cores = online > 0 ? static_cast<size_t>(online) : 1;
+        std::vector<int> efficiency = EfficiencyCpus();
+
+        std::vector<Config> configs;
+        auto add = [&](const char* name, size_t threads, std::vector<int> cpus, PoolPriority priority) {
+            Config config{name, ThreadPoolOptions()};
+            config.options.threads = threads;
+            config.options.efficiencyCores = false;
+            config.options.cpus = std::move(cpus);
+            config.options.priority = priority;
+            configs.push_back(std::move(config));
+        };
+        add("1 pinned cpu0", 1, {0}, PoolPriority::Nice);
+        if (cores >= 2) add("2 pinned cpu0-1", 2, {0, 1}, PoolPriority::Nice);
+        add("all cores", cores, {}, PoolPriority::Nice);
+        add("all cores idle", cores, {}, PoolPriority::Idle);
+        if (!efficiency.empty()) {
+            add("efficiency", efficiency.size(), efficiency, PoolPriority::Nice);
+            add("efficiency idle", efficiency.size(), efficiency, PoolPriority::Idle);
+        }
+
+        append("cores: %zu, efficiency cores: %zu, tasks: %zu x %zu KiB\n",
+               cores, efficiency.size(), taskCount, taskBytes >> 10);
+        append("%-18s %7s %9s %9s %7s %7s %s\n", "config", "threads", "wall ms", "cpu ms", "speedup", "steals", "result");
+
+        bool allMatch = true;
+        double baselineNs = 0;
+        for (const Config& config : configs) {
+            std::vector<uint8_t> digests(taskCount * Sha256::kDigestSize);
+            ThreadPool pool(config.options);
+            TaskGroup group(pool);
+
+            int64_t start = MonotonicNs();
+            for (size_t i = 0; i < taskCount; i++) {
+                pool.submit(group, "bench.sha256", [&, i](TaskContext&) {
+                    Sha256::hash(&data[i * taskBytes], taskBytes, &digests[i * Sha256::kDigestSize]);
+                });
+            }
+            group.wait();
+            int64_t wallNs = MonotonicNs() - start;
+
+            bool match = group.failed() == 0 && digests == reference;
+            allMatch &= match;
+            if (baselineNs == 0) baselineNs = static_cast<double>(wallNs);
+            append("%-18s %7zu %9.2f %9.2f %6.2fx %7" PRIu64 " %s\n", config.name, pool.size(),
+                   static_cast<double>(wallNs) / 1e6, static_cast<double>(group.cpuNs()) / 1e6,
+                   wallNs > 0 ? baselineNs / static_cast<double>(wallNs) : 0.0, pool.stats().steals,
+                   match ? "ok" : "MISMATCH");
+        }
+        return allMatch;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "CheckMetrics.hpp"
+#include "Mappings.hpp"
+#include "ProcReader.hpp"
+
+namespace checkbeer {
+
+    // Write a maps-format file of lineCount lines to scratchPath, then parse
+    // it with MapsReader and with the std::getline + sscanf loop it replaces,
+    // and report the best of a few passes of each. /proc/self/maps is parsed
+    // too for reference. Returns false if the two parsers disagree.
+    inline bool RunProcBenchmark(char* buffer, size_t size, const char* scratchPath,
+                                 size_t lineCount = 10000) {
+        if (size == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        FILE* file = fopen(scratchPath, "we");
+        if (!file) {
+            append("cannot write %s\n", scratchPath);
+            return false;
+        }
+        uint64_t address = 0x7000000000;
+        for (size_t i = 0; i < lineCount; i++) {
+            uint64_t length = 0x1000 * (1 + i % 64);
+            if (i % 3 == 0) {
+                fprintf(file, "%" PRIx64 "-%" PRIx64 " r-xp %08zx fd:05 %zu                     /system/lib64/libfoo%zu.so\n",
+                        address, address + length, (i % 16) * 0x1000, 1000 + i, i % 200);
+            } else {
+                fprintf(file, "%" PRIx64 "-%" PRIx64 " rw-p 00000000 00:00 0 \n", address, address + length);
+            }
+            address += length;
+        }
+        fclose(file);
+
+        const int passes = 5;
+        auto best = [&](auto&& pass) {
+            int64_t fastest = INT64_MAX;
+            for (int i = 0; i < passes; i++) {
+                int64_t start = MonotonicNs();
+                pass();
+                int64_t elapsed = MonotonicNs() - start;
+                if (elapsed < fastest) fastest = elapsed;
+            }
+            return static_cast<double>(fastest) / 1000.0;
+        };
+
+        char lineBuffer[16 << 10];
+        size_t readerLines = 0;
+        uint64_t readerSum = 0;
+        double readerUs = best([&] {
+            readerLines = 0;
+            readerSum = 0;
+            MapsReader maps(scratchPath, lineBuffer, sizeof(lineBuffer));
+            for (const MapsEntry& entry : maps) {
+                readerLines++;
+                readerSum += (entry.end - entry.start) + entry.inode + entry.path.size();
+            }
+        });
+
+        size_t streamLines = 0;
+        uint64_t streamSum = 0;
+        double streamUs = best([&] {
+            streamLines = 0;
+            streamSum = 0;
+            std::ifstream maps(scratchPath);
+            std::string line;
+            while (std::getline(maps, line)) {
+                unsigned long long start, end, offset, inode;
+                unsigned major, minor;
+                char perms[5];
+                int pathOffset = 0;
+                if (sscanf(line.c_str(), "%llx-%llx %4s %llx %x:%x %llu %n",
+                           &start, &end, perms, &offset, &major, &minor, &inode, &pathOffset) < 7) {
+                    continue;
+                }
+                std::string path = line.substr(static_cast<size_t>(pathOffset));
+                streamLines++;
+                streamSum += (end - start) + inode + path.size();
+            }
+        });
+
+        size_t selfLines = 0;
+        double selfUs = best([&] {
+            selfLines = 0;
+            MapsReader maps("/proc/self/maps", lineBuffer, sizeof(lineBuffer));
+            for (auto it = maps.begin(); it != maps.end(); ++it) selfLines++;
+        });
+
+        bool match = readerLines == streamLines && readerSum == streamSum && readerLines == lineCount;
+        append("%-24s %8s %10s\n", "parser", "lines", "us");
+        append("%-24s %8zu %10.1f\n", "MapsReader", readerLines, readerUs);
+        append("%-24s %8zu %10.1f\n", "getline + sscanf", streamLines, streamUs);
+        append("%-24s %8zu %10.1f\n", "MapsReader self", selfLines, selfUs);
+        append("speedup: %.1fx %s\n", readerUs > 0 ? streamUs / readerUs : 0.0, match ? "ok" : "MISMATCH");
+
+        remove(scratchPath);
+        return match;
+    }
+
+    // Write a maps-format file of lineCount mappings with gaps between them
+    // to scratchPath, index it with MappingIndex, and time lookups of
+    // random addresses (hits and misses) against std::upper_bound over an
+    // array of ranges and a linear walk. Also times a refresh that finds the
+    // file unchanged against a full rebuild. Returns false if the lookups
+    // disagree.
+    inline bool RunMappingIndexBenchmark(char* buffer, size_t size, const char* scratchPath,
+                                         size_t lineCount = 4000, size_t lookups = 1 << 20) {
+        if (size == 0) return false;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+
+        struct Range {
+            uintptr_t start;
+            uintptr_t end;
+        };
+        std::vector<Range> ranges;
+        FILE* file = fopen(scratchPath, "we");
+        if (!file) {
+            append("cannot write %s\n", scratchPath);
+            return false;
+        }
+        uint64_t address = 0x7000000000;
+        for (size_t i = 0; i < lineCount; i++) {
+            uint64_t length = 0x1000 * (1 + i % 64);
+            fprintf(file, "%" PRIx64 "-%" PRIx64 " r-xp %08zx fd:05 %zu                     /system/lib64/libfoo%zu.so\n",
+                    address, address + length, (i % 4) * 0x1000, 1000 + i / 4, i / 4);
+            ranges.push_back({static_cast<uintptr_t>(address), static_cast<uintptr_t>(address + length)});
+            address += length + (i % 5 == 0 ? 0x10000 : 0);
+        }
+        fclose(file);
+
+        char lineBuffer[16 << 10];
+        int64_t start = MonotonicNs();
+        std::shared_ptr<const MappingIndex> index =
+                MappingIndex::Refresh(nullptr, scratchPath, lineBuffer, sizeof(lineBuffer));
+        int64_t buildNs = MonotonicNs() - start;
+        if (!index || index->size() != lineCount) {
+            append("cannot index %s\n", scratchPath);
+            remove(scratchPath);
+            return false;
+        }
+        start = MonotonicNs();
+        std::shared_ptr<const MappingIndex> same =
+                MappingIndex::Refresh(index, scratchPath, lineBuffer, sizeof(lineBuffer));
+        int64_t refreshNs = MonotonicNs() - start;
+        remove(scratchPath);
+
+        // Random addresses across the whole span, so some land in gaps
+        std::vector<uintptr_t> probes(lookups);
+        uint32_t seed = 0x9E3779B9;
+        uintptr_t span = ranges.back().end - ranges.front().start;
+        for (uintptr_t& probe : probes) {
+            seed = seed * 1664525 + 1013904223;
+            uint64_t r = (static_cast<uint64_t>(seed) << 20) ^ (seed >> 7);
+            probe = ranges.front().start + static_cast<uintptr_t>(r % span);
+        }
+
+        auto time = [&](size_t count, auto&& lookup) {
+            uint64_t sum = 0;
+            int64_t begin = MonotonicNs();
+            for (size_t i = 0; i < count; i++) sum += lookup(probes[i]);
+            int64_t elapsed = MonotonicNs() - begin;
+            return std::make_pair(sum, count > 0 ? static_cast<double>(elapsed) / count : 0.0);
+        };
+
+        auto indexed = time(lookups, [&](uintptr_t probe) -> uint64_t {
+            const MappingInfo* info = index->find(probe);
+            return info ? info->start : 0;
+        });
+        auto bisect = time(lookups, [&](uintptr_t probe) -> uint64_t {
+            auto it = std::upper_bound(ranges.begin(), ranges.end(), probe,
+                                       [](uintptr_t value, const Range& range) { return value < range.start; });
+            if (it == ranges.begin()) return 0;
+            --it;
+            return probe < it->end ? it->start : 0;
+        });
+        size_t linearCount = lookups / 64;
+        auto linear = time(linearCount, [&](uintptr_t probe) -> uint64_t {
+            for (const Range& range : ranges) {
+                if (probe >= range.start && probe < range.end) return range.start;
+            }
+            return 0;
+        });
+        auto indexedPrefix = time(linearCount, [&](uintptr_t probe) -> uint64_t {
+            const MappingInfo* info = index->find(probe);
+            return info ? info->start : 0;
+        });
+
+        bool match = indexed.first == bisect.first && linear.first == indexedPrefix.first && same == index;
+        append("%-24s %10s %12s\n", "lookup", "count", "ns/lookup");
+        append("%-24s %10zu %12.1f\n", "MappingIndex", lookups, indexed.second);
+        append("%-24s %10zu %12.1f\n", "std::upper_bound", lookups, bisect.second);
+        append("%-24s %10zu %12.1f\n", "linear", linearCount, linear.second);
+        append("build %zu mappings: %.1f us, unchanged refresh: %.1f us %s\n", index->size(), buildNs / 1000.0,
+               refreshNs / 1000.0, match ? "ok" : "MISMATCH");
+        return match;
+    }
+
+} // namespace checkbeer
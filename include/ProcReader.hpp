@@ -0,0 +1,501 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Kernels.hpp"
+#include "RawSyscall.hpp"
+
+namespace checkbeer {
+
+    // Streams the lines of a /proc file through a caller-owned buffer with
+    // raw pread, so nothing is allocated however large the file is and a
+    // libc hook filtering what we read sees nothing. Lines are
+    // views into the buffer and stay valid only until the next call. Lines
+    // longer than the buffer are skipped and counted.
+    class ProcReader {
+    public:
+        ProcReader(const char* path, char* buffer, size_t size)
+                : fd_(RawOpenAt(AT_FDCWD, path, O_RDONLY | O_CLOEXEC)), buffer_(buffer), size_(size) {}
+
+        ProcReader(int dirFd, const char* path, char* buffer, size_t size)
+                : fd_(RawOpenAt(dirFd, path, O_RDONLY | O_CLOEXEC)), buffer_(buffer), size_(size) {}
+
+        ~ProcReader() {
+            if (fd_ >= 0) RawClose(fd_);
+        }
+
+        bool ok() const { return fd_ >= 0; }
+
+        // For poll(), on files that report changes that way
+        int fd() const { return fd_; }
+
+        size_t overlongLines() const { return overlong_; }
+
+        // Next line without its '\n'; false at end of file
+        bool next(std::string_view& line) {
+            for (;;) {
+                const uint8_t* start = reinterpret_cast<const uint8_t*>(buffer_ + begin_);
+                const uint8_t* newline = FindByte(start, end_ - begin_, '\n');
+                if (newline) {
+                    size_t length = static_cast<size_t>(newline - start);
+                    bool skip = discarding_;
+                    discarding_ = false;
+                    line = std::string_view(buffer_ + begin_, length);
+                    begin_ += length + 1;
+                    if (skip) continue;
+                    return true;
+                }
+                if (eof_) {
+                    if (begin_ == end_ || discarding_) return false;
+                    line = std::string_view(buffer_ + begin_, end_ - begin_);
+                    begin_ = end_;
+                    return true;
+                }
+                if (!fill()) return false;
+            }
+        }
+
+        // Every complete line in the buffer at once, '\n'-separated without
+        // the final one. Scanners that look for substrings go through the
+        // file a buffer at a time instead of a line at a time.
+        bool nextLines(std::string_view& lines) {
+            for (;;) {
+                if (discarding_) {
+                    const uint8_t* start = reinterpret_cast<const uint8_t*>(buffer_ + begin_);
+                    const uint8_t* newline = FindByte(start, end_ - begin_, '\n');
+                    if (newline) {
+                        begin_ += static_cast<size_t>(newline - start) + 1;
+                        discarding_ = false;
+                        continue;
+                    }
+                } else {
+                    const void* last = memrchr(buffer_ + begin_, '\n', end_ - begin_);
+                    if (last) {
+                        size_t length = static_cast<size_t>(static_cast<const char*>(last) - (buffer_ + begin_));
+                        lines = std::string_view(buffer_ + begin_, length);
+                        begin_ += length + 1;
+                        return true;
+                    }
+                }
+                if (eof_) {
+                    if (begin_ == end_ || discarding_) return false;
+                    lines = std::string_view(buffer_ + begin_, end_ - begin_);
+                    begin_ = end_;
+                    return true;
+                }
+                if (!fill()) return false;
+            }
+        }
+
+        // Start again from the top; /proc files are regenerated on read
+        void rewind() {
+            offset_ = 0;
+            begin_ = end_ = 0;
+            eof_ = discarding_ = false;
+        }
+
+        // Disable copy
+        ProcReader(const ProcReader&) = delete;
+        ProcReader& operator=(const ProcReader&) = delete;
+
+    private:
+        bool fill() {
+            if (fd_ < 0 || size_ == 0) return false;
+
+            // Keep the partial line, or drop it if it already fills the buffer
+            if (begin_ == 0 && end_ == size_) {
+                if (!discarding_) overlong_++;
+                discarding_ = true;
+                end_ = 0;
+            } else if (begin_ > 0) {
+                std::memmove(buffer_, buffer_ + begin_, end_ - begin_);
+                end_ -= begin_;
+                begin_ = 0;
+            }
+
+            ssize_t n = RawPread(fd_, buffer_ + end_, size_ - end_, offset_);
+            if (n <= 0) {
+                eof_ = true;
+            } else {
+                offset_ += n;
+                end_ += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        int fd_;
+        char* buffer_;
+        size_t size_;
+        size_t begin_ = 0;
+        size_t end_ = 0;
+        off_t offset_ = 0;
+        size_t overlong_ = 0;
+        bool eof_ = false;
+        bool discarding_ = false;
+    };
+
+    namespace detail {
+
+        inline void SkipSpaces(std::string_view& text) {
+            size_t i = 0;
+            while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) i++;
+            text.remove_prefix(i);
+        }
+
+        // Next space-separated field
+        inline std::string_view NextField(std::string_view& text) {
+            SkipSpaces(text);
+            size_t i = 0;
+            while (i < text.size() && text[i] != ' ' && text[i] != '\t') i++;
+            std::string_view field = text.substr(0, i);
+            text.remove_prefix(i);
+            return field;
+        }
+
+        inline bool ParseHex(std::string_view& text, uint64_t& value) {
+            size_t i = 0;
+            value = 0;
+            for (; i < text.size(); i++) {
+                char c = text[i];
+                unsigned digit;
+                if (c >= '0' && c <= '9') digit = static_cast<unsigned>(c - '0');
+                else if (c >= 'a' && c <= 'f') digit = static_cast<unsigned>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') digit = static_cast<unsigned>(c - 'A' + 10);
+                else break;
+                value = (value << 4) | digit;
+            }
+            text.remove_prefix(i);
+            return i > 0;
+        }
+
+        inline bool ParseDecimal(std::string_view& text, uint64_t& value) {
+            size_t i = 0;
+            value = 0;
+            for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+                value = value * 10 + static_cast<uint64_t>(text[i] - '0');
+            }
+            text.remove_prefix(i);
+            return i > 0;
+        }
+
+        inline bool Consume(std::string_view& text, char c) {
+            if (text.empty() || text[0] != c) return false;
+            text.remove_prefix(1);
+            return true;
+        }
+
+        // "major:minor", hexadecimal in maps and decimal in mountinfo
+        inline bool ParseDevice(std::string_view& text, bool hex, uint32_t& major, uint32_t& minor) {
+            uint64_t a = 0, b = 0;
+            bool ok = (hex ? ParseHex(text, a) : ParseDecimal(text, a)) && Consume(text, ':') &&
+                      (hex ? ParseHex(text, b) : ParseDecimal(text, b));
+            major = static_cast<uint32_t>(a);
+            minor = static_cast<uint32_t>(b);
+            return ok;
+        }
+
+    } // namespace detail
+
+    // One line of /proc/<pid>/maps
+    struct MapsEntry {
+        uintptr_t start;
+        uintptr_t end;
+        uint64_t offset;
+        uint64_t inode;
+        uint32_t devMajor;
+        uint32_t devMinor;
+        bool readable;
+        bool writable;
+        bool executable;
+        bool shared;
+        std::string_view path; // empty for anonymous mappings
+
+        static bool parse(std::string_view line, MapsEntry& out) {
+            uint64_t start, end;
+            if (!detail::ParseHex(line, start) || !detail::Consume(line, '-') || !detail::ParseHex(line, end)) {
+                return false;
+            }
+            out.start = static_cast<uintptr_t>(start);
+            out.end = static_cast<uintptr_t>(end);
+
+            std::string_view perms = detail::NextField(line);
+            if (perms.size() < 4) return false;
+            out.readable = perms[0] == 'r';
+            out.writable = perms[1] == 'w';
+            out.executable = perms[2] == 'x';
+            out.shared = perms[3] == 's';
+
+            detail::SkipSpaces(line);
+            if (!detail::ParseHex(line, out.offset)) return false;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDevice(line, true, out.devMajor, out.devMinor)) return false;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDecimal(line, out.inode)) return false;
+
+            // The path keeps embedded spaces and a " (deleted)" suffix
+            detail::SkipSpaces(line);
+            out.path = line;
+            return true;
+        }
+    };
+
+    // One "Key:\tvalue" line of /proc/<pid>/status
+    struct StatusEntry {
+        std::string_view key;
+        std::string_view value;
+
+        // Leading decimal of the value ("TracerPid", "VmRSS" in kB), -1 if none
+        int64_t number() const {
+            std::string_view text = value;
+            uint64_t n;
+            return detail::ParseDecimal(text, n) ? static_cast<int64_t>(n) : -1;
+        }
+
+        static bool parse(std::string_view line, StatusEntry& out) {
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos) return false;
+            out.key = line.substr(0, colon);
+            line.remove_prefix(colon + 1);
+            detail::SkipSpaces(line);
+            out.value = line;
+            return true;
+        }
+    };
+
+    // One line of /proc/<pid>/mountinfo. Paths keep the kernel's octal
+    // escapes ("\040" for a space) since they are not copied out.
+    struct MountInfoEntry {
+        uint32_t mountId;
+        uint32_t parentId;
+        uint32_t devMajor;
+        uint32_t devMinor;
+        std::string_view root;
+        std::string_view mountPoint;
+        std::string_view mountOptions;
+        std::string_view optionalFields; // "shared:1 master:2", may be empty
+        std::string_view fsType;
+        std::string_view source;
+        std::string_view superOptions;
+
+        static bool parse(std::string_view line, MountInfoEntry& out) {
+            uint64_t mountId, parentId;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDecimal(line, mountId)) return false;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDecimal(line, parentId)) return false;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDevice(line, false, out.devMajor, out.devMinor)) return false;
+            out.mountId = static_cast<uint32_t>(mountId);
+            out.parentId = static_cast<uint32_t>(parentId);
+
+            out.root = detail::NextField(line);
+            out.mountPoint = detail::NextField(line);
+            out.mountOptions = detail::NextField(line);
+
+            size_t separator = line.find(" - ");
+            if (separator == std::string_view::npos) return false;
+            std::string_view optional = line.substr(0, separator);
+            detail::SkipSpaces(optional);
+            out.optionalFields = optional;
+            line.remove_prefix(separator + 3);
+
+            out.fsType = detail::NextField(line);
+            out.source = detail::NextField(line);
+            out.superOptions = detail::NextField(line);
+            return !out.fsType.empty();
+        }
+    };
+
+    // One socket line of /proc/net/tcp or tcp6. Addresses are left as the
+    // kernel's hex (8 digits for IPv4, 32 for IPv6); the header is skipped.
+    struct TcpEntry {
+        std::string_view localAddress;
+        uint32_t localPort;
+        std::string_view remoteAddress;
+        uint32_t remotePort;
+        uint32_t state; // 0x0A is LISTEN
+        uint32_t uid;
+        uint64_t inode;
+
+        static bool parse(std::string_view line, TcpEntry& out) {
+            uint64_t slot, port, state, uid;
+            detail::SkipSpaces(line);
+            if (!detail::ParseDecimal(line, slot) || !detail::Consume(line, ':')) return false;
+
+            auto endpoint = [&](std::string_view& address, uint32_t& endpointPort) {
+                std::string_view field = detail::NextField(line);
+                size_t colon = field.find(':');
+                if (colon == std::string_view::npos) return false;
+                address = field.substr(0, colon);
+                field.remove_prefix(colon + 1);
+                if (!detail::ParseHex(field, port)) return false;
+                endpointPort = static_cast<uint32_t>(port);
+                return true;
+            };
+            if (!endpoint(out.localAddress, out.localPort) || !endpoint(out.remoteAddress, out.remotePort)) {
+                return false;
+            }
+
+            std::string_view field = detail::NextField(line);
+            if (!detail::ParseHex(field, state)) return false;
+            out.state = static_cast<uint32_t>(state);
+
+            detail::NextField(line); // tx_queue:rx_queue
+            detail::NextField(line); // tr:tm->when
+            detail::NextField(line); // retrnsmt
+            field = detail::NextField(line);
+            if (!detail::ParseDecimal(field, uid)) return false;
+            out.uid = static_cast<uint32_t>(uid);
+            detail::NextField(line); // timeout
+            field = detail::NextField(line);
+            return detail::ParseDecimal(field, out.inode);
+        }
+    };
+
+    // Typed view over a /proc file: lines that do not parse as Record are
+    // skipped. Usable with range-for; each record's views die on increment.
+    template <typename Record>
+    class ProcRecords {
+    public:
+        ProcRecords(const char* path, char* buffer, size_t size) : reader_(path, buffer, size) {}
+
+        bool ok() const { return reader_.ok(); }
+
+        bool next(Record& out) {
+            std::string_view line;
+            while (reader_.next(line)) {
+                if (Record::parse(line, out)) return true;
+            }
+            return false;
+        }
+
+        void rewind() { reader_.rewind(); }
+
+        class iterator {
+        public:
+            explicit iterator(ProcRecords* owner) : owner_(owner) { advance(); }
+
+            const Record& operator*() const { return record_; }
+            const Record* operator->() const { return &record_; }
+
+            iterator& operator++() {
+                advance();
+                return *this;
+            }
+
+            bool operator!=(const iterator& other) const { return owner_ != other.owner_; }
+            bool operator==(const iterator& other) const { return owner_ == other.owner_; }
+
+        private:
+            void advance() {
+                if (owner_ && !owner_->next(record_)) owner_ = nullptr;
+            }
+
+            ProcRecords* owner_;
+            Record record_ = {};
+        };
+
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(nullptr); }
+
+    private:
+        ProcReader reader_;
+    };
+
+    using MapsReader = ProcRecords<MapsEntry>;
+    using StatusReader = ProcRecords<StatusEntry>;
+    using MountInfoReader = ProcRecords<MountInfoEntry>;
+    using TcpReader = ProcRecords<TcpEntry>;
+
+    namespace detail {
+        struct LinuxDirent64 {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+    } // namespace detail
+
+    // Call fn(tid, comm) for every thread of this process. Directory entries
+    // are read with raw getdents64 into the caller's buffer rather than
+    // through opendir, which allocates. Returns the number of threads, -1 on error.
+    template <typename F>
+    int ForEachTaskComm(char* buffer, size_t size, F&& fn) {
+        int dirFd = RawOpenAt(AT_FDCWD, "/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return -1;
+
+        int count = 0;
+        for (;;) {
+            long n = RawGetdents64(dirFd, buffer, size);
+            if (n <= 0) break;
+            for (long offset = 0; offset < n;) {
+                const detail::LinuxDirent64* entry = reinterpret_cast<const detail::LinuxDirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+
+                std::string_view name(entry->d_name);
+                uint64_t tid;
+                std::string_view digits = name;
+                if (!detail::ParseDecimal(digits, tid) || !digits.empty()) continue;
+
+                char path[32];
+                char comm[64];
+                snprintf(path, sizeof(path), "%.*s/comm", static_cast<int>(name.size()), name.data());
+                int fd = RawOpenAt(dirFd, path, O_RDONLY | O_CLOEXEC);
+                if (fd < 0) continue; // the thread exited meanwhile
+                ssize_t length = RawPread(fd, comm, sizeof(comm), 0);
+                RawClose(fd);
+                if (length <= 0) continue;
+                if (comm[length - 1] == '\n') length--;
+
+                fn(static_cast<pid_t>(tid), std::string_view(comm, static_cast<size_t>(length)));
+                count++;
+            }
+        }
+        RawClose(dirFd);
+        return count;
+    }
+
+    // Call fn(fd, target) for every open descriptor of this process, target
+    // being where its /proc/self/fd link points, e.g. "/data/app/.../base.apk"
+    // or "socket:[1234]". Read the same way as ForEachTaskComm. Returns the
+    // number of descriptors, -1 on error.
+    template <typename F>
+    int ForEachOpenFile(char* buffer, size_t size, F&& fn) {
+        int dirFd = RawOpenAt(AT_FDCWD, "/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return -1;
+
+        int count = 0;
+        for (;;) {
+            long n = RawGetdents64(dirFd, buffer, size);
+            if (n <= 0) break;
+            for (long offset = 0; offset < n;) {
+                const detail::LinuxDirent64* entry = reinterpret_cast<const detail::LinuxDirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+
+                std::string_view name(entry->d_name);
+                uint64_t fd;
+                std::string_view digits = name;
+                if (!detail::ParseDecimal(digits, fd) || !digits.empty() || static_cast<int>(fd) == dirFd) continue;
+
+                char target[512];
+                ssize_t length = RawReadlinkAt(dirFd, entry->d_name, target, sizeof(target));
+                if (length <= 0) continue; // closed meanwhile
+
+                fn(static_cast<int>(fd), std::string_view(target, static_cast<size_t>(length)));
+                count++;
+            }
+        }
+        RawClose(dirFd);
+        return count;
+    }
+
+} // namespace checkbeer
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ElfImage.hpp"
+#include "Mappings.hpp"
+
+namespace checkbeer {
+
+    // Inline hooks overwrite the first instructions of a function with a
+    // branch to the hook. This compares the start of each watched function
+    // in memory with the same bytes in its library's file. Where those bytes
+    // are is worked out once per function, and the file stays mapped, so a
+    // run is one memcmp per function. Not thread-safe.
+    class PrologueScanner {
+    public:
+        static constexpr size_t kMaxBytes = 32;
+
+        struct Function {
+            const char* name;
+            const LoadedModule* module;
+            uintptr_t address;   // in memory
+            const uint8_t* disk; // the same bytes in the mapped file
+            size_t length;
+        };
+
+        struct Result {
+            size_t functions;
+            size_t patched;
+        };
+
+        // bytes per function; 16 covers an arm64 ldr/br/.quad trampoline
+        // and the usual x86-64 absolute jumps
+        explicit PrologueScanner(size_t bytes = 16) : bytes_(bytes < kMaxBytes ? bytes : kMaxBytes) {}
+
+        // Watch an exported function of a loaded library. Returns false if
+        // the library is not loaded or does not export it as a function.
+        bool watchSymbol(ModuleCache& cache, const MappingIndex& index, const char* library, const char* symbol) {
+            const LoadedModule* module = cache.moduleNamed(index, library);
+            if (!module) return false;
+            const ElfFile::Sym* sym = module->file->findSymbol(symbol);
+            if (!sym || detail::SymbolType(sym->st_info) != STT_FUNC) return false;
+
+            uintptr_t vaddr = static_cast<uintptr_t>(sym->st_value);
+#if defined(__arm__)
+            vaddr &= ~static_cast<uintptr_t>(1); // Thumb bit
+#endif
+            return add(index, symbol, *module, vaddr, static_cast<size_t>(sym->st_size));
+        }
+
+        // Watch a function by address, e.g. one of our own
+        bool watchAddress(ModuleCache& cache, const MappingIndex& index, const char* name, const void* function) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(function);
+#if defined(__arm__)
+            address &= ~static_cast<uintptr_t>(1);
+#endif
+            const LoadedModule* module = cache.moduleAt(index, address);
+            if (!module) return false;
+            return add(index, name, *module, address - module->bias, 0);
+        }
+
+        // onPatched(const Function&) for each function whose first bytes no
+        // longer match the file
+        template <typename F>
+        Result verify(F&& onPatched) const {
+            Result result = {functions_.size(), 0};
+            for (const Function& function : functions_) {
+                if (std::memcmp(reinterpret_cast<const void*>(function.address), function.disk, function.length) != 0) {
+                    result.patched++;
+                    onPatched(function);
+                }
+            }
+            return result;
+        }
+
+        const std::vector<Function>& functions() const { return functions_; }
+
+    private:
+        bool add(const MappingIndex& index, const char* name, const LoadedModule& module, uintptr_t vaddr,
+                 size_t symbolSize) {
+            uintptr_t address = module.bias + vaddr;
+            for (const Function& function : functions_) {
+                if (function.address == address) return true;
+            }
+
+            // Short functions are compared whole; reading past them would
+            // reach into whatever the linker placed next
+            size_t length = symbolSize > 0 && symbolSize < bytes_ ? symbolSize : bytes_;
+            const uint8_t* disk = module.file->bytesAt(vaddr, length);
+            if (!disk) return false;
+
+            // Execute-only code cannot be compared
+            const MappingInfo* info = index.find(address);
+            if (!info || !info->readable || info->end - address < length) return false;
+            functions_.push_back({name, &module, address, disk, length});
+            return true;
+        }
+
+        size_t bytes_;
+        std::vector<Function> functions_;
+    };
+
+} // namespace checkbeer
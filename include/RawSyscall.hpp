@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace checkbeer {
+
+    // File system calls that trap into the kernel directly instead of going
+    // through libc, whose exports and GOT entries are the first thing an IO
+    // redirect hooks. On arm64 and x86-64 the trap is inline; elsewhere they
+    // fall back to libc's syscall(), which is better than nothing. Each
+    // behaves like its libc namesake: -1 and errno on failure.
+#if defined(__aarch64__) || defined(__x86_64__)
+    constexpr bool kRawSyscalls = true;
+#else
+    constexpr bool kRawSyscalls = false;
+#endif
+
+    namespace detail {
+#if defined(__aarch64__)
+        inline long RawSyscall6(long nr, long a, long b, long c, long d, long e, long f) {
+            register long x8 __asm__("x8") = nr;
+            register long x0 __asm__("x0") = a;
+            register long x1 __asm__("x1") = b;
+            register long x2 __asm__("x2") = c;
+            register long x3 __asm__("x3") = d;
+            register long x4 __asm__("x4") = e;
+            register long x5 __asm__("x5") = f;
+            __asm__ volatile("svc #0"
+                             : "+r"(x0)
+                             : "r"(x8), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5)
+                             : "memory", "cc");
+            return x0;
+        }
+#elif defined(__x86_64__)
+        inline long RawSyscall6(long nr, long a, long b, long c, long d, long e, long f) {
+            long result;
+            register long r10 __asm__("r10") = d;
+            register long r8 __asm__("r8") = e;
+            register long r9 __asm__("r9") = f;
+            __asm__ volatile("syscall"
+                             : "=a"(result)
+                             : "a"(nr), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+                             : "rcx", "r11", "memory", "cc");
+            return result;
+        }
+#else
+        inline long RawSyscall6(long nr, long a, long b, long c, long d, long e, long f) {
+            long result = syscall(nr, a, b, c, d, e, f);
+            return result == -1 ? -errno : result;
+        }
+#endif
+
+        // The kernel returns -errno; libc callers expect -1 and errno
+        inline long RawResult(long result) {
+            if (result < 0 && result > -4096) {
+                errno = static_cast<int>(-result);
+                return -1;
+            }
+            return result;
+        }
+
+        template <typename T>
+        long RawArg(T value) {
+            if constexpr (std::is_pointer_v<T>) {
+                return reinterpret_cast<long>(value);
+            } else {
+                return static_cast<long>(value);
+            }
+        }
+
+        template <typename... Args>
+        long RawCall(long nr, Args... args) {
+            long values[6] = {RawArg(args)...};
+            return RawResult(RawSyscall6(nr, values[0], values[1], values[2], values[3], values[4], values[5]));
+        }
+    } // namespace detail
+
+    inline int RawOpenAt(int dirFd, const char* path, int flags, mode_t mode = 0) {
+        long result;
+        do {
+            result = detail::RawCall(__NR_openat, dirFd, path, flags, mode);
+        } while (result < 0 && errno == EINTR);
+        return static_cast<int>(result);
+    }
+
+    inline int RawClose(int fd) { return static_cast<int>(detail::RawCall(__NR_close, fd)); }
+
+    // The 32-bit ABIs split the 64-bit offset into register pairs, aligned
+    // differently on each (arm EABI pads before it, i386 does not), so they
+    // use libc's pread64 rather than a generic syscall()
+    inline ssize_t RawPread(int fd, void* buffer, size_t size, off_t offset) {
+#if defined(__LP64__)
+        long result;
+        do {
+            result = detail::RawCall(__NR_pread64, fd, buffer, size, offset);
+        } while (result < 0 && errno == EINTR);
+        return static_cast<ssize_t>(result);
+#else
+        ssize_t result;
+        do {
+            result = pread64(fd, buffer, size, static_cast<off64_t>(offset));
+        } while (result < 0 && errno == EINTR);
+        return result;
+#endif
+    }
+
+    // newfstatat's struct stat is libc's on the 64-bit ABIs; 32-bit ones
+    // only have fstatat64, so they go through libc
+    inline int RawFstatAt(int dirFd, const char* path, struct stat* st, int flags) {
+#if defined(__NR_newfstatat) && defined(__LP64__)
+        return static_cast<int>(detail::RawCall(__NR_newfstatat, dirFd, path, st, flags));
+#else
+        return fstatat(dirFd, path, st, flags);
+#endif
+    }
+
+    inline int RawFstat(int fd, struct stat* st) { return RawFstatAt(fd, "", st, AT_EMPTY_PATH); }
+
+    // struct statx as the kernel lays it out, so the header it comes from
+    // (bionic, glibc or linux/stat.h) does not matter
+    struct RawStatx {
+        uint32_t mask;
+        uint32_t blockSize;
+        uint64_t attributes;
+        uint32_t links;
+        uint32_t uid;
+        uint32_t gid;
+        uint16_t mode;
+        uint16_t spare0;
+        uint64_t inode;
+        uint64_t size;
+        uint64_t blocks;
+        uint64_t attributesMask;
+        struct {
+            int64_t sec;
+            uint32_t nsec;
+            int32_t reserved;
+        } atime, btime, ctime, mtime;
+        uint32_t rdevMajor;
+        uint32_t rdevMinor;
+        uint32_t devMajor;
+        uint32_t devMinor;
+        uint64_t mountId;  // with kStatxMountId, Linux 5.8+
+        uint64_t spare[13];
+    };
+    static_assert(sizeof(RawStatx) == 256, "struct statx is 256 bytes");
+
+    constexpr uint32_t kStatxBasicStats = 0x7ff;
+    constexpr uint32_t kStatxMountId = 0x1000;
+
+    // -1 with ENOSYS before Linux 4.11
+    inline int RawStatxAt(int dirFd, const char* path, int flags, uint32_t mask, RawStatx* out) {
+#if defined(__NR_statx)
+        return static_cast<int>(detail::RawCall(__NR_statx, dirFd, path, flags, mask, out));
+#else
+        (void)dirFd, (void)path, (void)flags, (void)mask, (void)out;
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    // faccessat takes no flags in the kernel before faccessat2
+    inline int RawFaccessAt(int dirFd, const char* path, int mode) {
+        return static_cast<int>(detail::RawCall(__NR_faccessat, dirFd, path, mode));
+    }
+
+    inline int RawFchmodAt(int dirFd, const char* path, mode_t mode) {
+        return static_cast<int>(detail::RawCall(__NR_fchmodat, dirFd, path, mode));
+    }
+
+    inline ssize_t RawReadlinkAt(int dirFd, const char* path, char* buffer, size_t size) {
+        return static_cast<ssize_t>(detail::RawCall(__NR_readlinkat, dirFd, path, buffer, size));
+    }
+
+    inline long RawGetdents64(int fd, void* buffer, size_t size) {
+        return detail::RawCall(__NR_getdents64, fd, buffer, size);
+    }
+
+    // ppoll, since arm64 has no poll syscall
+    inline int RawPoll(struct pollfd* fds, nfds_t count, int timeoutMs) {
+        struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+        return static_cast<int>(detail::RawCall(__NR_ppoll, fds, count, timeoutMs < 0 ? nullptr : &timeout,
+                                                static_cast<const void*>(nullptr), sizeof(uint64_t)));
+    }
+
+    // Answers the same questions through the raw calls above and, when
+    // cross-checking, through libc too. Libc disagreeing with the kernel
+    // about a file means something sits in between; each disagreement is
+    // recorded with the caller's path pointer, which must outlive the probe.
+    class FileProbe {
+    public:
+        struct Mismatch {
+            const char* call;
+            const char* path;
+            long raw;     // result, or the first differing field
+            long libc;
+        };
+
+        explicit FileProbe(bool crossCheck) : crossCheck_(crossCheck) {}
+
+        int stat(const char* path, struct stat* st) {
+            int raw = RawFstatAt(AT_FDCWD, path, st, 0);
+            int rawErrno = errno;
+            if (!crossCheck_) return raw;
+
+            struct stat viaLibc;
+            int libc = ::fstatat(AT_FDCWD, path, &viaLibc, 0);
+            if (raw != libc || (raw < 0 && rawErrno != errno)) {
+                record("stat", path, raw < 0 ? -rawErrno : raw, libc < 0 ? -errno : libc);
+            } else if (raw == 0) {
+                struct {
+                    const char* name;
+                    long raw;
+                    long libc;
+                } fields[] = {
+                        {"stat.dev", static_cast<long>(st->st_dev), static_cast<long>(viaLibc.st_dev)},
+                        {"stat.ino", static_cast<long>(st->st_ino), static_cast<long>(viaLibc.st_ino)},
+                        {"stat.mode", static_cast<long>(st->st_mode), static_cast<long>(viaLibc.st_mode)},
+                        {"stat.uid", static_cast<long>(st->st_uid), static_cast<long>(viaLibc.st_uid)},
+                        {"stat.size", static_cast<long>(st->st_size), static_cast<long>(viaLibc.st_size)},
+                };
+                for (const auto& field : fields) {
+                    if (field.raw == field.libc) continue;
+                    record(field.name, path, field.raw, field.libc);
+                    break;
+                }
+            }
+            errno = rawErrno;
+            return raw;
+        }
+
+        int access(const char* path, int mode) {
+            int raw = RawFaccessAt(AT_FDCWD, path, mode);
+            int rawErrno = errno;
+            if (!crossCheck_) return raw;
+
+            int libc = ::faccessat(AT_FDCWD, path, mode, 0);
+            if (raw != libc || (raw < 0 && rawErrno != errno)) {
+                record("access", path, raw < 0 ? -rawErrno : raw, libc < 0 ? -errno : libc);
+            }
+            errno = rawErrno;
+            return raw;
+        }
+
+        ssize_t readlink(const char* path, char* buffer, size_t size) {
+            ssize_t raw = RawReadlinkAt(AT_FDCWD, path, buffer, size);
+            int rawErrno = errno;
+            if (!crossCheck_) return raw;
+
+            char viaLibc[512];
+            ssize_t libc = ::readlinkat(AT_FDCWD, path, viaLibc, sizeof(viaLibc));
+            if (raw != libc && (raw < 0 || libc < 0 || static_cast<size_t>(raw) < sizeof(viaLibc))) {
+                record("readlink", path, raw < 0 ? -rawErrno : raw, libc < 0 ? -errno : libc);
+            } else if (raw > 0 && std::memcmp(buffer, viaLibc, static_cast<size_t>(raw < libc ? raw : libc)) != 0) {
+                record("readlink.target", path, raw, libc);
+            }
+            errno = rawErrno;
+            return raw;
+        }
+
+        // Modifies the file, so it is never repeated through libc
+        int chmod(const char* path, mode_t mode) { return RawFchmodAt(AT_FDCWD, path, mode); }
+
+        const std::vector<Mismatch>& mismatches() const { return mismatches_; }
+
+    private:
+        void record(const char* call, const char* path, long raw, long libc) {
+            mismatches_.push_back({call, path, raw, libc});
+        }
+
+        bool crossCheck_;
+        std::vector<Mismatch> mismatches_;
+    };
+
+} // namespace checkbeer
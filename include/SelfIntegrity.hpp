@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <link.h>
+#include <vector>
+
+#include "CheckMetrics.hpp"
+#include "Kernels.hpp"
+
+namespace checkbeer {
+
+    // Filled in after linking by tools/embed_text_digest.py, which finds the
+    // record by its magic in the library file. Lives in .data, which is
+    // never part of an executable segment, so writing it does not change
+    // the bytes it describes.
+    struct EmbeddedDigest {
+        char magic[16];      // "CheckBeerTextSha", no terminator
+        uint32_t version;    // layout of this record, 1
+        uint32_t chunkSize;  // bytes per chunk digest
+        uint32_t embedded;   // 0 until the tool has run
+        uint32_t reserved;
+        uint8_t digest[32];
+    };
+
+    namespace detail {
+        __attribute__((used, aligned(16))) inline EmbeddedDigest gEmbeddedDigest = {
+                {'C', 'h', 'e', 'c', 'k', 'B', 'e', 'e', 'r', 'T', 'e', 'x', 't', 'S', 'h', 'a'}, 1, 4096, 0, 0, {}};
+
+        // Read through volatile: the compiler must not fold the zeros of the
+        // initializer into the code that checks them
+        inline EmbeddedDigest LoadEmbeddedDigest() {
+            EmbeddedDigest copy;
+            const volatile uint8_t* source = reinterpret_cast<const volatile uint8_t*>(&gEmbeddedDigest);
+            uint8_t* target = reinterpret_cast<uint8_t*>(&copy);
+            for (size_t i = 0; i < sizeof(copy); i++) target[i] = source[i];
+            return copy;
+        }
+    } // namespace detail
+
+    // Hashes the executable segments of the library this header is compiled
+    // into and compares them with the digest embedded at build time.
+    //
+    // The digest is SHA-256 over the SHA-256 of each 4 KiB chunk of each
+    // executable segment, in order. The first run hashes every chunk, which
+    // yields both the digest and a per-chunk reference; once the digest
+    // matches, later runs re-hash only a sample of chunks against that
+    // reference. Half the sample is random and half walks a cursor, so
+    // every chunk is revisited within a bounded number of runs. Without an
+    // embedded digest (the post-link step was skipped) the first run's
+    // hashes become the reference. Not thread-safe.
+    class TextIntegrity {
+    public:
+        enum class Status {
+            Match,     // matches the embedded digest, or the reference chunks
+            Mismatch,  // differs; stays so until reset()
+            NoDigest,  // nothing embedded; compared with the first run only
+            NoText,    // our own executable segments were not found
+        };
+
+        struct Result {
+            Status status;
+            bool full;           // every chunk was hashed this run
+            size_t chunks;       // hashed this run
+            size_t changedChunks;
+            size_t bytesHashed;
+            int64_t elapsedNs;
+        };
+
+        // onChanged(uintptr_t address, size_t length) for each sampled
+        // chunk that no longer matches its reference
+        template <typename F>
+        Result verify(size_t sampleChunks, F&& onChanged) {
+            int64_t start = MonotonicNs();
+            Result result = {Status::Match, false, 0, 0, 0, 0};
+            if (chunks_.empty() && !findText()) {
+                result.status = Status::NoText;
+            } else if (mismatched_) {
+                result.status = Status::Mismatch;
+            } else if (reference_.empty()) {
+                hashAll(result);
+            } else {
+                sample(sampleChunks, result, onChanged);
+            }
+            result.elapsedNs = MonotonicNs() - start;
+            return result;
+        }
+
+        // Drop the reference; the next run hashes everything again
+        void reset() {
+            reference_.clear();
+            mismatched_ = false;
+            noDigest_ = false;
+        }
+
+        size_t chunkCount() const { return chunks_.size(); }
+
+    private:
+        static constexpr size_t kChunkSize = 4096;
+
+        struct Chunk {
+            uintptr_t address;
+            size_t length;
+        };
+
+        static int OnObject(struct dl_phdr_info* info, size_t, void* data) {
+            TextIntegrity* self = static_cast<TextIntegrity*>(data);
+            uintptr_t marker = reinterpret_cast<uintptr_t>(&detail::gEmbeddedDigest);
+            bool ours = false;
+            for (ElfW(Half) i = 0; i < info->dlpi_phnum && !ours; i++) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                uintptr_t begin = info->dlpi_addr + ph.p_vaddr;
+                ours = ph.p_type == PT_LOAD && marker >= begin && marker < begin + ph.p_memsz;
+            }
+            if (!ours) return 0;
+
+            for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                if (ph.p_type != PT_LOAD || !(ph.p_flags & PF_X)) continue;
+                uintptr_t begin = info->dlpi_addr + ph.p_vaddr;
+                for (size_t offset = 0; offset < ph.p_filesz; offset += kChunkSize) {
+                    size_t length = ph.p_filesz - offset < kChunkSize ? ph.p_filesz - offset : kChunkSize;
+                    self->chunks_.push_back({begin + offset, length});
+                }
+            }
+            return 1;
+        }
+
+        bool findText() {
+            dl_iterate_phdr(OnObject, this);
+            return !chunks_.empty();
+        }
+
+        void hashAll(Result& result) {
+            CHECK_TRACE_SPAN("TextIntegrity:hashAll");
+            reference_.resize(chunks_.size() * Sha256::kDigestSize);
+            Sha256 outer;
+            for (size_t i = 0; i < chunks_.size(); i++) {
+                uint8_t* digest = &reference_[i * Sha256::kDigestSize];
+                Sha256::hash(reinterpret_cast<const void*>(chunks_[i].address), chunks_[i].length, digest);
+                outer.update(digest, Sha256::kDigestSize);
+                result.bytesHashed += chunks_[i].length;
+            }
+            uint8_t digest[Sha256::kDigestSize];
+            outer.final(digest);
+            result.full = true;
+            result.chunks = chunks_.size();
+
+            EmbeddedDigest embedded = detail::LoadEmbeddedDigest();
+            if (!embedded.embedded || embedded.version != 1 || embedded.chunkSize != kChunkSize) {
+                result.status = Status::NoDigest;
+                noDigest_ = true;
+            } else if (std::memcmp(digest, embedded.digest, sizeof(digest)) != 0) {
+                result.status = Status::Mismatch;
+                mismatched_ = true;
+            }
+        }
+
+        template <typename F>
+        void sample(size_t count, Result& result, F& onChanged) {
+            CHECK_TRACE_SPAN("TextIntegrity:sample");
+            if (count > chunks_.size()) count = chunks_.size();
+            for (size_t n = 0; n < count; n++) {
+                size_t i;
+                if (n % 2 == 0) {
+                    i = cursor_;
+                    cursor_ = (cursor_ + 1) % chunks_.size();
+                } else {
+                    seed_ = seed_ * 6364136223846793005ull + static_cast<uint64_t>(MonotonicNs());
+                    i = static_cast<size_t>(seed_ >> 33) % chunks_.size();
+                }
+                uint8_t digest[Sha256::kDigestSize];
+                Sha256::hash(reinterpret_cast<const void*>(chunks_[i].address), chunks_[i].length, digest);
+                result.chunks++;
+                result.bytesHashed += chunks_[i].length;
+                if (std::memcmp(digest, &reference_[i * Sha256::kDigestSize], sizeof(digest)) != 0) {
+                    result.changedChunks++;
+                    onChanged(chunks_[i].address, chunks_[i].length);
+                }
+            }
+            if (result.changedChunks > 0) {
+                result.status = Status::Mismatch;
+                mismatched_ = true;
+            } else if (noDigest_) {
+                result.status = Status::NoDigest;
+            }
+        }
+
+        std::vector<Chunk> chunks_;
+        std::vector<uint8_t> reference_; // kDigestSize bytes per chunk
+        size_t cursor_ = 0;
+        uint64_t seed_ = 0x853c49e6748fea9bull;
+        bool mismatched_ = false;
+        bool noDigest_ = false;
+    };
+
+} // namespace checkbeer
@@ -1,41 +1,165 @@
 #include <jni.h>
+#include <cinttypes>
+#include <mutex>
+#include <new>
 #include <string>
-#include <android/log.h>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <thread>
 #include <vector>
+#include <malloc.h>
+#ifdef __ANDROID__
 #include <android/log.h>
-
+#include <sys/system_properties.h>
+#else
+#include <cstdio>
+#endif
+
+#include "Arena.hpp"
+#include "CheckBindings.hpp"
+#include "CheckMetrics.hpp"
+#include "CheckReport.hpp"
+#include "DexMappings.hpp"
+#include "ElfImage.hpp"
+#include "FileIdentity.hpp"
+#include "GotScanner.hpp"
+#include "JNIEnvManager.hpp"
 #include "JNIHelper.hpp"
+#include "JNIIntegrity.hpp"
+#include "JNIRecorder.hpp"
+#include "Kernels.hpp"
+#include "Mappings.hpp"
+#include "MemoryScanner.hpp"
+#include "MountTable.hpp"
+#include "PatternSet.hpp"
+#include "PrologueScanner.hpp"
+#include "ProcReader.hpp"
+#include "RawSyscall.hpp"
+#include "SelfIntegrity.hpp"
+#include "Soak.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
 
 #define LOG_TAG "CheckBeer"
+#ifdef __ANDROID__
 #define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
 #define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+#else
+// Host builds (trace and replay harnesses) log to stderr; soak runs mute it
+static bool gCheckLogsMuted = false;
+#define LOGI(...) ((void)(gCheckLogsMuted || (fprintf(stderr, "I/" LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))))
+#define LOGE(...) ((void)(gCheckLogsMuted || (fprintf(stderr, "E/" LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))))
+#endif
+
+// Size of the stack-resident first block of the per-run arena
+#define CHECK_ARENA_SIZE 4096
+
+// 1: resolve every JNI binding on a background thread from checkOnLoad
+// 0: resolve lazily on the first checkSignatureBypass call
+#ifndef CHECK_EAGER_WARMUP
+#define CHECK_EAGER_WARMUP 0
+#endif
+
+// 1: define JNI_OnLoad here and have it call checkOnLoad
+// 0: the app's own JNI_OnLoad must call checkOnLoad
+#ifndef CHECK_DEFINE_JNI_ONLOAD
+#define CHECK_DEFINE_JNI_ONLOAD 0
+#endif
+
+// Kotlin class whose external functions are bound in checkOnLoad
+#ifndef CHECK_NATIVE_CLASS
+#define CHECK_NATIVE_CLASS "com/signature/check/android/CheckBeerNative"
+#endif
+
+// Local references each check may hold at once; its frame frees them all
+// when the check returns
+#ifndef CHECK_LOCAL_FRAME_SIZE
+#define CHECK_LOCAL_FRAME_SIZE 32
+#endif
+
+// Read buffer for streaming /proc files; lines longer than this are skipped
+#ifndef CHECK_PROC_BUFFER_SIZE
+#define CHECK_PROC_BUFFER_SIZE 16384
+#endif
+
+// Per-run budget of the memory signature scan; it resumes where it stopped
+#ifndef CHECK_SCAN_BYTES_PER_RUN
+#define CHECK_SCAN_BYTES_PER_RUN (8 << 20)
+#endif
+#ifndef CHECK_SCAN_BUDGET_US
+#define CHECK_SCAN_BUDGET_US 2000
+#endif
+
+// Chunks of our own code re-hashed per run once the full hash has matched
+#ifndef CHECK_SELF_SAMPLE_CHUNKS
+#define CHECK_SELF_SAMPLE_CHUNKS 8
+#endif
+
+// Leading bytes of each watched function compared with its library file
+#ifndef CHECK_PROLOGUE_BYTES
+#define CHECK_PROLOGUE_BYTES 16
+#endif
+
+// 1: file probes are repeated through libc, and any answer that differs
+// from the raw syscall's is reported; 0: raw syscalls only
+#ifndef CHECK_SYSCALL_CROSS_CHECK
+#define CHECK_SYSCALL_CROSS_CHECK 1
+#endif
+
+// Per-run budget of the dex and oat mapping comparison; it resumes where
+// it stopped
+#ifndef CHECK_DEX_BUDGET_US
+#define CHECK_DEX_BUDGET_US 4000
+#endif
+
+// Metadata key under which recorded JNI traces keep the context handle
+#define CHECK_TRACE_META_CONTEXT 1
 
 // Forward declarations
-bool checkCreator(JNIEnv* env);
-bool checkField(JNIEnv* env);
-bool checkCreators(JNIEnv* env);
-bool checkPMProxy(JNIEnv* env, jobject context);
-bool checkAppComponentFactory(JNIEnv* env);
-bool checkApkPaths(JNIEnv* env, jobject context);
+bool checkCreator(JNIEnv* env, checkbeer::MonotonicArena& arena);
+bool checkField(JNIEnv* env, checkbeer::MonotonicArena& arena);
+bool checkCreators(JNIEnv* env, checkbeer::MonotonicArena& arena);
+bool checkPMProxy(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena);
+bool checkAppComponentFactory(JNIEnv* env, checkbeer::MonotonicArena& arena);
+bool checkApkPaths(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena);
+bool checkApkIdentity(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena, checkbeer::CheckReport& report);
+bool checkApkMounts(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena, checkbeer::CheckReport& report);
+bool checkInjectedLibraries(checkbeer::CheckReport& report);
+bool checkAnonymousExecutable(checkbeer::CheckReport& report);
+bool checkMemorySignatures(checkbeer::CheckReport& report);
+bool checkJniFunctionTable(JNIEnv* env, checkbeer::CheckReport& report);
+bool checkGotHooks(checkbeer::CheckReport& report);
+bool checkInlineHooks(checkbeer::CheckReport& report);
+bool checkSelfIntegrity(checkbeer::CheckReport& report);
+bool checkDexMappings(checkbeer::CheckReport& report);
 jobject getApplication(JNIEnv* env);
 std::string getAppComponentFactory(JNIEnv* env, jobject context);
-
-
-bool checkCreator(JNIEnv* env) {
+std::string_view getApkPath(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena);
+bool checkSignatureBypass(JNIEnv* env, jobject context);
+bool recordSignatureBypass(JNIEnv* env, jobject context, const char* path);
+bool replaySignatureBypass(const char* path, bool simulateLatency, bool* suspicious);
+bool soakSignatureBypass(const char* path, uint64_t iterations, char* report, size_t reportSize,
+                         const checkbeer::SoakLimits& limits = checkbeer::SoakLimits());
+void startBindingWarmup();
+void registerCheckNatives(JNIEnv* env);
+jint checkOnLoad(JavaVM* vm);
+
+
+bool checkCreator(JNIEnv* env, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
     const char* expectedCreatorName = "android.content.pm.PackageInfo$1";
 
     LOGI("Expected Creator Name: %s", expectedCreatorName);
 
     try {
-        jobject creatorObject = jni::GetStaticField<jobject>(env, "android/content/pm/PackageInfo", "CREATOR", "Landroid/os/Parcelable$Creator;");
-        jobject creatorClass = jni::CallMethod<jobject>(env, creatorObject, "getClass", "()Ljava/lang/Class;");
-        jstring jCreatorName = jni::CallMethod<jstring>(env, creatorClass, "getName", "()Ljava/lang/String;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject creatorObject = jni::GetStaticField<jobject>(env, b.packageInfoClass, b.packageInfoCreator);
+        jobject creatorClass = jni::CallMethod<jobject>(env, creatorObject, b.objectGetClass);
+        jstring jCreatorName = jni::CallMethod<jstring>(env, creatorClass, b.classGetName);
 
-        std::string currentCreatorName = jni::JStringToString(env, static_cast<jstring>(jCreatorName));
-        LOGI("Current Creator Name: %s", currentCreatorName.c_str());
+        std::string_view currentCreatorName = jni::JStringToArena(env, static_cast<jstring>(jCreatorName), arena);
+        LOGI("Current Creator Name: %s", currentCreatorName.data());
 
         if (currentCreatorName.find("android.content.pm.PackageInfo$") != 0) {
             LOGE("Current Creator Name does not start with expected prefix");
@@ -43,7 +167,7 @@ bool checkCreator(JNIEnv* env) {
         }
 
         if (expectedCreatorName != currentCreatorName) {
-            LOGE("Creator name mismatch: expected=%s, found=%s", expectedCreatorName, currentCreatorName.c_str());
+            LOGE("Creator name mismatch: expected=%s, found=%s", expectedCreatorName, currentCreatorName.data());
             suspicious = true;
         } else {
             LOGI("Creator name verification passed");
@@ -58,13 +182,14 @@ bool checkCreator(JNIEnv* env) {
 }
 
 
-bool checkField(JNIEnv* env) {
+bool checkField(JNIEnv* env, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
 
     try {
-        jobject creatorObject = jni::GetStaticField<jobject>(env, "android/content/pm/PackageInfo", "CREATOR", "Landroid/os/Parcelable$Creator;");
-        jobject creatorClass = jni::CallMethod<jobject>(env, creatorObject, "getClass", "()Ljava/lang/Class;");
-        jobjectArray fieldArray = jni::CallMethod<jobjectArray>(env, creatorClass, "getDeclaredFields", "()[Ljava/lang/reflect/Field;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject creatorObject = jni::GetStaticField<jobject>(env, b.packageInfoClass, b.packageInfoCreator);
+        jobject creatorClass = jni::CallMethod<jobject>(env, creatorObject, b.objectGetClass);
+        jobjectArray fieldArray = jni::CallMethod<jobjectArray>(env, creatorClass, b.classGetDeclaredFields);
 
         jint fieldCount = env->GetArrayLength(fieldArray);
         LOGI("Expected Declared field count: 0, found: %d", fieldCount);
@@ -75,10 +200,10 @@ bool checkField(JNIEnv* env) {
 
             for (jint i = 0; i < fieldCount; i++) {
                 jni::ScopedLocalRef<jobject> field(env, env->GetObjectArrayElement(fieldArray, i));
-                jstring fieldName = jni::CallMethod<jstring>(env, field.get(), "getName", "()Ljava/lang/String;");
+                jni::ScopedLocalRef<jstring> fieldName(env, jni::CallMethod<jstring>(env, field.get(), b.fieldGetName));
 
-                std::string fieldNameStr = jni::JStringToString(env, fieldName);
-                LOGE("Declared Field Name: %s", fieldNameStr.c_str());
+                std::string_view fieldNameStr = jni::JStringToArena(env, fieldName.get(), arena);
+                LOGE("Declared Field Name: %s", fieldNameStr.data());
             }
 
         } else {
@@ -93,40 +218,41 @@ bool checkField(JNIEnv* env) {
     return suspicious;
 }
 
-bool checkCreators(JNIEnv* env) {
+bool checkCreators(JNIEnv* env, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
 
     try {
-        jobject creator = jni::GetStaticField<jobject>(env, "android/content/pm/PackageInfo", "CREATOR", "Landroid/os/Parcelable$Creator;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject creator = jni::GetStaticField<jobject>(env, b.packageInfoClass, b.packageInfoCreator);
 
-        jstring jCreatorString = jni::CallMethod<jstring>(env, creator, "toString", "()Ljava/lang/String;");
-        std::string creatorString = jni::JStringToString(env, jCreatorString);
+        jstring jCreatorString = jni::CallMethod<jstring>(env, creator, b.objectToString);
+        std::string_view creatorString = jni::JStringToArena(env, jCreatorString, arena);
 
         if (!creatorString.empty()) {
             if (creatorString.find("android.content.pm.PackageInfo$") != 0) {
-                LOGE("Creator object is suspicious: %s", creatorString.c_str());
+                LOGE("Creator object is suspicious: %s", creatorString.data());
                 suspicious = true;
             } else {
-                LOGI("Creator object is correct: %s", creatorString.c_str());
+                LOGI("Creator object is correct: %s", creatorString.data());
             }
         }
 
-        jobject creatorClass = jni::CallMethod<jobject>(env, creator, "getClass", "()Ljava/lang/Class;");
-        jobject creatorClassloader = jni::CallMethod<jobject>(env, creatorClass, "getClassLoader", "()Ljava/lang/ClassLoader;");
+        jobject creatorClass = jni::CallMethod<jobject>(env, creator, b.objectGetClass);
+        jobject creatorClassloader = jni::CallMethod<jobject>(env, creatorClass, b.classGetClassLoader);
 
-        jobject sysClassloader = jni::CallStaticMethod<jobject>(env, "java/lang/ClassLoader", "getSystemClassLoader", "()Ljava/lang/ClassLoader;");
+        jobject sysClassloader = jni::CallStaticMethod<jobject>(env, b.classLoaderClass, b.classLoaderGetSystemClassLoader);
 
-        jobject creatorClassloaderClass = jni::CallMethod<jobject>(env, creatorClassloader, "getClass", "()Ljava/lang/Class;");
-        jobject sysClassloaderClass = jni::CallMethod<jobject>(env, sysClassloader, "getClass", "()Ljava/lang/Class;");
+        jobject creatorClassloaderClass = jni::CallMethod<jobject>(env, creatorClassloader, b.objectGetClass);
+        jobject sysClassloaderClass = jni::CallMethod<jobject>(env, sysClassloader, b.objectGetClass);
 
-        jstring jCreatorClassloaderName = jni::CallMethod<jstring>(env, creatorClassloaderClass, "getName", "()Ljava/lang/String;");
-        jstring jSysClassloaderName = jni::CallMethod<jstring>(env, sysClassloaderClass, "getName", "()Ljava/lang/String;");
+        jstring jCreatorClassloaderName = jni::CallMethod<jstring>(env, creatorClassloaderClass, b.classGetName);
+        jstring jSysClassloaderName = jni::CallMethod<jstring>(env, sysClassloaderClass, b.classGetName);
 
-        std::string creatorClassloaderName = jni::JStringToString(env, jCreatorClassloaderName);
-        std::string sysClassloaderName = jni::JStringToString(env, jSysClassloaderName);
+        std::string_view creatorClassloaderName = jni::JStringToArena(env, jCreatorClassloaderName, arena);
+        std::string_view sysClassloaderName = jni::JStringToArena(env, jSysClassloaderName, arena);
 
-        LOGI("Creator ClassLoader: %s", creatorClassloaderName.c_str());
-        LOGI("System ClassLoader: %s", sysClassloaderName.c_str());
+        LOGI("Creator ClassLoader: %s", creatorClassloaderName.data());
+        LOGI("System ClassLoader: %s", sysClassloaderName.data());
 
         if (creatorClassloader == nullptr || sysClassloader == nullptr) {
             LOGE("One of the class loaders is null");
@@ -146,32 +272,30 @@ bool checkCreators(JNIEnv* env) {
     return suspicious;
 }
 
-bool checkPMProxy(JNIEnv* env, jobject context) {
+bool checkPMProxy(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
     const char* expectedPMName = "android.content.pm.IPackageManager$Stub$Proxy";
     LOGI("Expected PM Name: %s", expectedPMName);
 
     try {
-        jobject packageManager = jni::CallMethod<jobject>(env, context, "getPackageManager", "()Landroid/content/pm/PackageManager;");
-
-        jobject packageManagerClass = jni::CallMethod<jobject>(env, packageManager, "getClass", "()Ljava/lang/Class;");
-        jstring fieldNameStr = env->NewStringUTF("mPM");
-        jobject mPMField = jni::CallMethod<jobject>(env, packageManagerClass, "getDeclaredField", "(Ljava/lang/String;)Ljava/lang/reflect/Field;", fieldNameStr);
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject packageManager = jni::CallMethod<jobject>(env, context, b.contextGetPackageManager);
 
-        jni::CallMethod<void>(env, mPMField, "setAccessible", "(Z)V", JNI_TRUE);
+        jobject packageManagerClass = jni::CallMethod<jobject>(env, packageManager, b.objectGetClass);
+        jobject mPMField = jni::CallMethod<jobject>(env, packageManagerClass, b.classGetDeclaredField, "mPM");
 
-        jobject mPM = jni::CallMethod<jobject>(env, mPMField, "get", "(Ljava/lang/Object;)Ljava/lang/Object;", packageManager);
+        jni::CallMethod<void>(env, mPMField, b.fieldSetAccessible, JNI_TRUE);
 
-        jobject mPMClass = jni::CallMethod<jobject>(env, mPM, "getClass", "()Ljava/lang/Class;");
-        jstring jPMName = jni::CallMethod<jstring>(env, mPMClass, "getName", "()Ljava/lang/String;");
+        jobject mPM = jni::CallMethod<jobject>(env, mPMField, b.fieldGet, packageManager);
 
-        std::string currentPMName = jni::JStringToString(env, jPMName);
-        LOGI("Current PM Name: %s", currentPMName.c_str());
+        jobject mPMClass = jni::CallMethod<jobject>(env, mPM, b.objectGetClass);
+        jstring jPMName = jni::CallMethod<jstring>(env, mPMClass, b.classGetName);
 
-        env->DeleteLocalRef(fieldNameStr);
+        std::string_view currentPMName = jni::JStringToArena(env, jPMName, arena);
+        LOGI("Current PM Name: %s", currentPMName.data());
 
         if (expectedPMName != currentPMName) {
-            LOGE("PM Name mismatch: expected=%s, found=%s", expectedPMName, currentPMName.c_str());
+            LOGE("PM Name mismatch: expected=%s, found=%s", expectedPMName, currentPMName.data());
             suspicious = true;
         } else {
             LOGI("PM Name verification passed");
@@ -187,8 +311,13 @@ bool checkPMProxy(JNIEnv* env, jobject context) {
 
 jobject getApplication(JNIEnv* env) {
     try {
-        jobject activityThread = jni::CallStaticMethod<jobject>(env, "android/app/ActivityThread", "currentActivityThread", "()Landroid/app/ActivityThread;");
-        return jni::GetField<jobject>(env, activityThread, "mInitialApplication", "Landroid/app/Application;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        if (!b.activityThreadCurrentActivityThread || !b.activityThreadInitialApplication) {
+            LOGE("ActivityThread is not accessible");
+            return nullptr;
+        }
+        jni::ScopedLocalRef<jobject> activityThread(env, jni::CallStaticMethod<jobject>(env, b.activityThreadClass, b.activityThreadCurrentActivityThread));
+        return jni::GetField<jobject>(env, activityThread.get(), b.activityThreadInitialApplication);
     } catch (const std::exception& e) {
         LOGE("Error getting application: %s", e.what());
         return nullptr;
@@ -197,17 +326,20 @@ jobject getApplication(JNIEnv* env) {
 
 std::string getAppComponentFactory(JNIEnv* env, jobject context) {
     try {
-        jobject packageManager = jni::CallMethod<jobject>(env, context, "getPackageManager", "()Landroid/content/pm/PackageManager;");
-        jstring packageName = jni::CallMethod<jstring>(env, context, "getPackageName", "()Ljava/lang/String;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        // Called outside the per-check frames, so every reference is scoped
+        jni::ScopedLocalRef<jobject> packageManager(env, jni::CallMethod<jobject>(env, context, b.contextGetPackageManager));
+        jni::ScopedLocalRef<jstring> packageName(env, jni::CallMethod<jstring>(env, context, b.contextGetPackageName));
 
-        jobject applicationInfo = jni::CallMethod<jobject>(env, packageManager, "getApplicationInfo",
-                                                                 "(Ljava/lang/String;I)Landroid/content/pm/ApplicationInfo;",
-                                                                 packageName, 0);
+        jni::ScopedLocalRef<jobject> applicationInfo(env, jni::CallMethod<jobject>(
+                env, packageManager.get(), b.packageManagerGetApplicationInfo, packageName.get(), 0));
 
-        jstring appComponentFactory = jni::GetField<jstring>(env, applicationInfo, "appComponentFactory", "Ljava/lang/String;");
+        jni::ScopedLocalRef<jstring> appComponentFactory(env, b.applicationInfoAppComponentFactory
+                ? jni::GetField<jstring>(env, applicationInfo.get(), b.applicationInfoAppComponentFactory)
+                : nullptr);
 
-        if (appComponentFactory != nullptr) {
-            return jni::JStringToString(env, appComponentFactory);
+        if (appComponentFactory.get() != nullptr) {
+            return jni::JStringToString(env, appComponentFactory.get());
         }
 
     } catch (const std::exception& e) {
@@ -218,25 +350,28 @@ std::string getAppComponentFactory(JNIEnv* env, jobject context) {
 }
 
 
-bool checkAppComponentFactory(JNIEnv* env) {
+bool checkAppComponentFactory(JNIEnv* env, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
-    const std::string originalAppComponentFactory = "androidx.core.app.CoreComponentFactory";
-    LOGI("Expected AppComponentFactory: %s", originalAppComponentFactory.c_str());
+    const char* originalAppComponentFactory = "androidx.core.app.CoreComponentFactory";
+    LOGI("Expected AppComponentFactory: %s", originalAppComponentFactory);
 
     try {
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
         jobject application = getApplication(env);
         if (application != nullptr) {
-            jobject applicationInfo = jni::CallMethod<jobject>(env, application, "getApplicationInfo", "()Landroid/content/pm/ApplicationInfo;");
+            jobject applicationInfo = jni::CallMethod<jobject>(env, application, b.contextGetApplicationInfo);
 
-            jstring jAppComponentFactory = jni::GetField<jstring>(env, applicationInfo, "appComponentFactory", "Ljava/lang/String;");
+            jstring jAppComponentFactory = b.applicationInfoAppComponentFactory
+                    ? jni::GetField<jstring>(env, applicationInfo, b.applicationInfoAppComponentFactory)
+                    : nullptr;
 
             if (jAppComponentFactory != nullptr) {
-                std::string appComponentFactory = jni::JStringToString(env, jAppComponentFactory);
-                LOGI("Detected AppComponentFactory: %s", appComponentFactory.c_str());
+                std::string_view appComponentFactory = jni::JStringToArena(env, jAppComponentFactory, arena);
+                LOGI("Detected AppComponentFactory: %s", appComponentFactory.data());
 
                 if (appComponentFactory != originalAppComponentFactory) {
                     LOGE("AppComponentFactory mismatch: expected=%s, found=%s",
-                         originalAppComponentFactory.c_str(), appComponentFactory.c_str());
+                         originalAppComponentFactory, appComponentFactory.data());
                     suspicious = true;
                 } else {
                     LOGI("AppComponentFactory verification passed");
@@ -253,76 +388,80 @@ bool checkAppComponentFactory(JNIEnv* env) {
     return suspicious;
 }
 
-std::string getApkPath(JNIEnv* env, jobject context) {
+std::string_view getApkPath(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena) {
     try {
-        jobject applicationInfo = jni::CallMethod<jobject>(env, context, "getApplicationInfo", "()Landroid/content/pm/ApplicationInfo;");
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject applicationInfo = jni::CallMethod<jobject>(env, context, b.contextGetApplicationInfo);
 
-        jstring jSourceDir = jni::GetField<jstring>(env, applicationInfo, "sourceDir", "Ljava/lang/String;");
-        return jni::JStringToString(env, jSourceDir);
+        jstring jSourceDir = jni::GetField<jstring>(env, applicationInfo, b.applicationInfoSourceDir);
+        return jni::JStringToArena(env, jSourceDir, arena);
 
     } catch (const std::exception& e) {
         LOGE("Error getting APK path: %s", e.what());
-        return "";
+        return {};
     }
 }
 
 
-bool checkApkPaths(JNIEnv* env, jobject context) {
+bool checkApkPaths(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena) {
     bool suspicious = false;
 
     try {
-        jstring jResourcePath = jni::CallMethod<jstring>(env, context, "getPackageResourcePath", "()Ljava/lang/String;");
-        std::string resourcePath = jni::JStringToString(env, jResourcePath);
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        CHECK_TRACE_BEGIN(jniSpan, "checkApkPaths:jni");
+        jstring jResourcePath = jni::CallMethod<jstring>(env, context, b.contextGetPackageResourcePath);
+        std::string_view resourcePath = jni::JStringToArena(env, jResourcePath, arena);
 
-        jstring jCodePath = jni::CallMethod<jstring>(env, context, "getPackageCodePath", "()Ljava/lang/String;");
-        std::string codePath = jni::JStringToString(env, jCodePath);
+        jstring jCodePath = jni::CallMethod<jstring>(env, context, b.contextGetPackageCodePath);
+        std::string_view codePath = jni::JStringToArena(env, jCodePath, arena);
 
-        jobject applicationInfo = jni::CallMethod<jobject>(env, context, "getApplicationInfo", "()Landroid/content/pm/ApplicationInfo;");
+        jobject applicationInfo = jni::CallMethod<jobject>(env, context, b.contextGetApplicationInfo);
 
-        jstring jSourceDir = jni::GetField<jstring>(env, applicationInfo, "sourceDir", "Ljava/lang/String;");
-        std::string sourceDir = jni::JStringToString(env, jSourceDir);
+        jstring jSourceDir = jni::GetField<jstring>(env, applicationInfo, b.applicationInfoSourceDir);
+        std::string_view sourceDir = jni::JStringToArena(env, jSourceDir, arena);
 
-        jstring jPublicSourceDir = jni::GetField<jstring>(env, applicationInfo, "publicSourceDir", "Ljava/lang/String;");
-        std::string publicSourceDir = jni::JStringToString(env, jPublicSourceDir);
+        jstring jPublicSourceDir = jni::GetField<jstring>(env, applicationInfo, b.applicationInfoPublicSourceDir);
+        std::string_view publicSourceDir = jni::JStringToArena(env, jPublicSourceDir, arena);
 
-        jobject packageManager = jni::CallMethod<jobject>(env, context, "getPackageManager", "()Landroid/content/pm/PackageManager;");
-        jstring packageName = jni::CallMethod<jstring>(env, context, "getPackageName", "()Ljava/lang/String;");
+        jobject packageManager = jni::CallMethod<jobject>(env, context, b.contextGetPackageManager);
+        jstring packageName = jni::CallMethod<jstring>(env, context, b.contextGetPackageName);
 
-        jobject applicationInfo2 = jni::CallMethod<jobject>(env, 
-                packageManager,
-                "getApplicationInfo",
-                "(Ljava/lang/String;I)Landroid/content/pm/ApplicationInfo;",
-                packageName,
-                0
-        );
+        jobject applicationInfo2 = jni::CallMethod<jobject>(env, packageManager, b.packageManagerGetApplicationInfo, packageName, 0);
 
-        jstring jPackageInfoSourceDir = jni::GetField<jstring>(env, applicationInfo2, "sourceDir", "Ljava/lang/String;");
-        std::string packageInfoSourceDir = jni::JStringToString(env, jPackageInfoSourceDir);
+        jstring jPackageInfoSourceDir = jni::GetField<jstring>(env, applicationInfo2, b.applicationInfoSourceDir);
+        std::string_view packageInfoSourceDir = jni::JStringToArena(env, jPackageInfoSourceDir, arena);
 
-        std::string nativeApkPath;
+        std::string_view nativeApkPath;
         try {
-            nativeApkPath = getApkPath(env, context);
-            LOGI("Native APK Path: %s", nativeApkPath.c_str());
+            nativeApkPath = getApkPath(env, context, arena);
+            if (nativeApkPath.empty()) {
+                LOGE("Cannot get native APK path");
+            } else {
+                LOGI("Native APK Path: %s", nativeApkPath.data());
+            }
         } catch (const std::exception& e) {
             LOGE("Failed to get native APK path: %s", e.what());
         }
+        CHECK_TRACE_END(jniSpan);
 
-        LOGI("Package Resource Path: %s", resourcePath.c_str());
-        LOGI("Package Code Path: %s", codePath.c_str());
-        LOGI("ApplicationInfo SourceDir: %s", sourceDir.c_str());
-        LOGI("ApplicationInfo publicSourceDir: %s", publicSourceDir.c_str());
-        LOGI("PackageManager SourceDir: %s", packageInfoSourceDir.c_str());
+        LOGI("Package Resource Path: %s", resourcePath.data());
+        LOGI("Package Code Path: %s", codePath.data());
+        LOGI("ApplicationInfo SourceDir: %s", sourceDir.data());
+        LOGI("ApplicationInfo publicSourceDir: %s", publicSourceDir.data());
+        LOGI("PackageManager SourceDir: %s", packageInfoSourceDir.data());
 
-        std::vector<std::string> paths = {resourcePath, codePath, sourceDir, publicSourceDir, packageInfoSourceDir};
+        // Every entry is NUL-terminated arena memory, so data() is safe to log and stat
+        std::string_view paths[6] = {resourcePath, codePath, sourceDir, publicSourceDir, packageInfoSourceDir};
+        size_t pathCount = 5;
         if (!nativeApkPath.empty()) {
-            paths.push_back(nativeApkPath);
+            paths[pathCount++] = nativeApkPath;
         }
 
         bool allPathsSame = true;
-        for (size_t i = 1; i < paths.size(); i++) {
+        for (size_t i = 1; i < pathCount; i++) {
             if (paths[i] != paths[0]) {
                 allPathsSame = false;
-                LOGE("Path mismatch: %s != %s", paths[0].c_str(), paths[i].c_str());
+                LOGE("Path mismatch: %s != %s", paths[0].data(), paths[i].data());
                 suspicious = true;
                 break;
             }
@@ -335,10 +474,11 @@ bool checkApkPaths(JNIEnv* env, jobject context) {
         }
 
         bool allStartWithDataApp = true;
-        for (const auto& path : paths) {
+        for (size_t i = 0; i < pathCount; i++) {
+            std::string_view path = paths[i];
             if (path.find("/data/app/") != 0) {
                 allStartWithDataApp = false;
-                LOGE("Path doesn't start with /data/app/: %s", path.c_str());
+                LOGE("Path doesn't start with /data/app/: %s", path.data());
                 suspicious = true;
                 break;
             }
@@ -351,10 +491,11 @@ bool checkApkPaths(JNIEnv* env, jobject context) {
         }
 
         bool allEndWithBaseApk = true;
-        for (const auto& path : paths) {
+        for (size_t i = 0; i < pathCount; i++) {
+            std::string_view path = paths[i];
             if (path.length() < 9 || path.substr(path.length() - 9) != "/base.apk") {
                 allEndWithBaseApk = false;
-                LOGE("Path doesn't end with /base.apk: %s", path.c_str());
+                LOGE("Path doesn't end with /base.apk: %s", path.data());
                 suspicious = true;
                 break;
             }
@@ -366,37 +507,52 @@ bool checkApkPaths(JNIEnv* env, jobject context) {
             LOGI("All APK paths end with /base.apk");
         }
 
-        for (const auto& path : paths) {
+        // Straight to the kernel: a libc hook redirecting these paths to a
+        // clean APK would otherwise answer for it
+        CHECK_TRACE_BEGIN(statSpan, "checkApkPaths:stat");
+        checkbeer::FileProbe probe(CHECK_SYSCALL_CROSS_CHECK);
+        for (size_t i = 0; i < pathCount; i++) {
+            const char* path = paths[i].data();
             struct stat st;
-            if (stat(path.c_str(), &st) == 0) {
+            if (probe.access(path, R_OK) != 0) {
+                LOGE("Path %s is not readable (errno: %d)", path, errno);
+                suspicious = true;
+            }
+            if (probe.stat(path, &st) == 0) {
                 bool correctPermissions = (st.st_mode & 0777) == 0644;
                 bool correctOwner = st.st_uid == 1000;
 
                 if (!correctPermissions) {
                     LOGE("Path %s has incorrect permissions: %o (expected 644)",
-                         path.c_str(), st.st_mode & 0777);
+                         path, st.st_mode & 0777);
                     suspicious = true;
                 }
 
                 if (!correctOwner) {
                     LOGE("Path %s has incorrect owner: %d (expected 1000/system)",
-                         path.c_str(), st.st_uid);
+                         path, st.st_uid);
                     suspicious = true;
                 }
 
-                bool canChangePermissions = chmod(path.c_str(), 0777) == 0;
+                bool canChangePermissions = probe.chmod(path, 0777) == 0;
                 if (canChangePermissions) {
-                    LOGE("Path %s permissions could be changed - suspicious", path.c_str());
+                    LOGE("Path %s permissions could be changed - suspicious", path);
                     suspicious = true;
-                    chmod(path.c_str(), 0644);
+                    probe.chmod(path, 0644);
                 } else {
-                    LOGI("Path %s permissions check passed", path.c_str());
+                    LOGI("Path %s permissions check passed", path);
                 }
             } else {
-                LOGE("Error accessing path: %s (errno: %d)", path.c_str(), errno);
+                LOGE("Error accessing path: %s (errno: %d)", path, errno);
                 suspicious = true;
             }
         }
+        for (const checkbeer::FileProbe::Mismatch& mismatch : probe.mismatches()) {
+            LOGE("libc %s of %s disagrees with the kernel: %ld != %ld", mismatch.call, mismatch.path,
+                 mismatch.libc, mismatch.raw);
+            suspicious = true;
+        }
+        CHECK_TRACE_END(statSpan);
 
     } catch (const std::exception& e) {
         LOGE("Error while checking APK paths: %s", e.what());
@@ -406,20 +562,1184 @@ bool checkApkPaths(JNIEnv* env, jobject context) {
     return suspicious;
 }
 
+// A hook can point sourceDir and getPackageCodePath at the original APK
+// while the process runs the repackaged one. The kernel still knows which
+// file is mapped and which is open, so the device and inode behind
+// sourceDir must be those of its mappings, of the descriptors open on it,
+// and of the APK or directory our own library was loaded from.
+bool checkApkIdentity(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena, checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    try {
+        std::string_view sourceDir = getApkPath(env, context, arena);
+        checkbeer::FileId onDisk;
+        if (sourceDir.empty()) {
+            LOGE("Cannot get sourceDir");
+            suspicious = true;
+        } else if (!checkbeer::IdentifyPath(sourceDir.data(), onDisk)) {
+            LOGE("Cannot stat sourceDir %s (errno: %d)", sourceDir.data(), errno);
+            suspicious = true;
+        } else {
+            LOGI("sourceDir %s is %u:%u inode %" PRIu64, sourceDir.data(), onDisk.devMajor, onDisk.devMinor,
+                 onDisk.inode);
+            auto mismatch = [&](const char* what, const checkbeer::FileId& actual, const checkbeer::FileId& expected) {
+                LOGE("%s is %u:%u inode %" PRIu64 ", expected %u:%u inode %" PRIu64, what, actual.devMajor,
+                     actual.devMinor, actual.inode, expected.devMajor, expected.devMinor, expected.inode);
+                report.add(checkbeer::CheckId::ApkIdentity, "%s is inode %" PRIu64 ", expected %" PRIu64, what,
+                           actual.inode, expected.inode);
+                suspicious = true;
+            };
+
+            // Mappings of the APK, including one replaced since it was mapped
+            std::shared_ptr<const checkbeer::MappingIndex> index = checkbeer::GetMappingIndex(true);
+            size_t mapped = 0;
+            for (size_t i = 0; index && i < index->size(); i++) {
+                const checkbeer::MappingInfo& info = (*index)[i];
+                if (info.path.compare(0, sourceDir.size(), sourceDir) != 0) continue;
+                std::string_view suffix = info.path.substr(sourceDir.size());
+                if (!suffix.empty() && suffix != " (deleted)") continue;
+                mapped++;
+                checkbeer::FileId actual = checkbeer::IdentifyMapping(info);
+                if (actual != onDisk || !suffix.empty()) {
+                    mismatch("Mapped APK", actual, onDisk);
+                    break;
+                }
+            }
+            if (!index) {
+                LOGE("Cannot index /proc/self/maps (errno: %d)", errno);
+            } else {
+                LOGI("sourceDir mapped %zu times", mapped);
+            }
+
+            // Our own library: inside one of the app's APKs when it is loaded
+            // uncompressed, otherwise extracted under the APK's directory.
+            // App Bundles put it in split_config.<abi>.apk, not base.apk.
+            const checkbeer::MappingInfo* self =
+                    index ? index->find(reinterpret_cast<uintptr_t>(&checkApkIdentity)) : nullptr;
+            if (self && self->path.size() > 4 && self->path.substr(self->path.size() - 4) == ".apk") {
+                std::string_view holder = self->path == sourceDir ? sourceDir : std::string_view();
+                if (holder.empty()) {
+                    const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+                    jobject applicationInfo = jni::CallMethod<jobject>(env, context, b.contextGetApplicationInfo);
+                    jobjectArray splits = static_cast<jobjectArray>(
+                            jni::GetField<jobject>(env, applicationInfo, b.applicationInfoSplitSourceDirs));
+                    jint splitCount = splits ? env->GetArrayLength(splits) : 0;
+                    for (jint i = 0; i < splitCount && holder.empty(); i++) {
+                        jni::ScopedLocalRef<jstring> split(env, static_cast<jstring>(env->GetObjectArrayElement(splits, i)));
+                        std::string_view splitPath = split.get() ? jni::JStringToArena(env, split.get(), arena)
+                                                                 : std::string_view();
+                        if (splitPath == self->path) holder = splitPath;
+                    }
+                }
+
+                checkbeer::FileId actual = checkbeer::IdentifyMapping(*self);
+                checkbeer::FileId expected;
+                if (holder.empty()) {
+                    LOGE("Our library runs from %.*s, which is not one of the app's APKs",
+                         static_cast<int>(self->path.size()), self->path.data());
+                    report.add(checkbeer::CheckId::ApkIdentity, "library mapped from %.*s",
+                               static_cast<int>(self->path.size()), self->path.data());
+                    suspicious = true;
+                } else if (!checkbeer::IdentifyPath(holder.data(), expected)) {
+                    LOGE("Cannot stat %s (errno: %d)", holder.data(), errno);
+                    suspicious = true;
+                } else if (actual != expected) {
+                    mismatch("APK holding our library", actual, expected);
+                }
+            } else if (self && self->path.compare(0, 10, "/data/app/") == 0) {
+                // Copied into the arena for their NUL terminators
+                std::string_view libraryDir = arena.copy(checkbeer::AppCodeDirectory(self->path));
+                size_t slash = sourceDir.rfind('/');
+                std::string_view apkDir = arena.copy(sourceDir.substr(0, slash == std::string_view::npos ? 0 : slash + 1));
+                checkbeer::FileId libraryDirId, apkDirId;
+                if (checkbeer::IdentifyPath(libraryDir.data(), libraryDirId) &&
+                    checkbeer::IdentifyPath(apkDir.data(), apkDirId) && libraryDirId != apkDirId) {
+                    LOGE("Our library runs from %s, sourceDir is in %s", libraryDir.data(), apkDir.data());
+                    mismatch("Directory holding our library", libraryDirId, apkDirId);
+                }
+            }
+
+            // Descriptors the runtime keeps open on the APK
+            char buffer[CHECK_PROC_BUFFER_SIZE];
+            size_t open = 0;
+            checkbeer::ForEachOpenFile(buffer, sizeof(buffer), [&](int fd, std::string_view target) {
+                if (target.compare(0, sourceDir.size(), sourceDir) != 0) return;
+                std::string_view suffix = target.substr(sourceDir.size());
+                if (!suffix.empty() && suffix != " (deleted)") return;
+                open++;
+                checkbeer::FileId actual;
+                if (checkbeer::IdentifyFd(fd, actual) && (actual != onDisk || !suffix.empty())) {
+                    mismatch("Open APK descriptor", actual, onDisk);
+                }
+            });
+            LOGI("sourceDir open %zu times", open);
+        }
+
+        if (!suspicious) LOGI("APK identity verification passed");
+    } catch (const std::exception& e) {
+        LOGE("Error while checking APK identity: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// A bind mount over base.apk, a split or the library directory makes every
+// path and identity comparison pass, since the kernel itself now answers
+// with the original files. Such a mount shows up in our mount namespace's
+// table, which is re-read only when the kernel says it changed.
+bool checkApkMounts(JNIEnv* env, jobject context, checkbeer::MonotonicArena& arena, checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static std::mutex tableLock;
+    static checkbeer::MountTable table(CHECK_PROC_BUFFER_SIZE);
+
+    try {
+        const checkbeer::CheckBindings& b = checkbeer::GetCheckBindings(env);
+        jobject applicationInfo = jni::CallMethod<jobject>(env, context, b.contextGetApplicationInfo);
+        jstring jSourceDir = jni::GetField<jstring>(env, applicationInfo, b.applicationInfoSourceDir);
+        std::string_view sourceDir = jni::JStringToArena(env, jSourceDir, arena);
+        jstring jNativeLibraryDir = jni::GetField<jstring>(env, applicationInfo, b.applicationInfoNativeLibraryDir);
+        std::string_view nativeLibraryDir = jNativeLibraryDir ? jni::JStringToArena(env, jNativeLibraryDir, arena)
+                                                              : std::string_view();
+
+        // The APK's directory, the library directory and any split that
+        // lives elsewhere, in the arena like the strings they point into
+        jobjectArray splits = static_cast<jobjectArray>(
+                jni::GetField<jobject>(env, applicationInfo, b.applicationInfoSplitSourceDirs));
+        jint splitCount = splits ? env->GetArrayLength(splits) : 0;
+        size_t watchedCapacity = 2 + static_cast<size_t>(splitCount);
+        std::string_view* watched = static_cast<std::string_view*>(
+                arena.allocate(sizeof(std::string_view) * watchedCapacity, alignof(std::string_view)));
+        size_t watchedCount = 0;
+        size_t slash = sourceDir.rfind('/');
+        if (slash != std::string_view::npos && slash > 0) watched[watchedCount++] = sourceDir.substr(0, slash);
+        if (!nativeLibraryDir.empty()) watched[watchedCount++] = nativeLibraryDir;
+        for (jint i = 0; i < splitCount; i++) {
+            jni::ScopedLocalRef<jstring> split(env, static_cast<jstring>(env->GetObjectArrayElement(splits, i)));
+            if (split.get()) watched[watchedCount++] = jni::JStringToArena(env, split.get(), arena);
+        }
+
+        // Where installed apps live: "/data/app", or "/mnt/expand/<uuid>/app"
+        // on adopted storage. Mounts above it are the system's.
+        size_t app = sourceDir.find("/app/");
+        std::string_view root = app == std::string_view::npos ? sourceDir : sourceDir.substr(0, app + 4);
+
+        std::lock_guard<std::mutex> guard(tableLock);
+        if (watchedCount == 0) {
+            LOGE("Cannot get the APK's paths");
+            suspicious = true;
+        } else if (!table.refresh()) {
+            LOGE("Cannot read /proc/self/mountinfo (errno: %d)", errno);
+        } else {
+            LOGI("Mount table %s (%zu mounts, read %zu times)", table.reread() ? "read" : "unchanged",
+                 table.mounts().size(), table.reads());
+
+            // Sized for every mount in the table, and only once one is found
+            uint32_t* reported = nullptr;
+            size_t reportedCount = 0;
+            for (size_t i = 0; i < watchedCount; i++) {
+                std::string_view path = watched[i];
+                table.forEachCovering(path, root, [&](const checkbeer::MountPoint& mount) {
+                    for (size_t j = 0; j < reportedCount; j++) {
+                        if (reported[j] == mount.mountId) return;
+                    }
+                    if (!reported) {
+                        reported = static_cast<uint32_t*>(
+                                arena.allocate(sizeof(uint32_t) * table.mounts().size(), alignof(uint32_t)));
+                    }
+                    reported[reportedCount++] = mount.mountId;
+                    LOGE("%s is mounted over %.*s (%s from %s%s)", mount.mountPoint.c_str(),
+                         static_cast<int>(path.size()), path.data(), mount.fsType.c_str(), mount.source.c_str(),
+                         mount.root.c_str());
+                    report.add(checkbeer::CheckId::ApkMounts, "%s mounted from %s%s", mount.mountPoint.c_str(),
+                               mount.source.c_str(), mount.root.c_str());
+                    suspicious = true;
+                });
+            }
+            if (reportedCount == 0) LOGI("No mounts over the APK's %zu paths", watchedCount);
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while checking mounts over the APK: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Hooking frameworks have to map their code into the process, and most do it
+// from a file whose name gives them away
+bool checkInjectedLibraries(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static const checkbeer::PatternSet patterns = {
+            "frida", "gum-js-loop", "gadget", "linjector",
+            "xposed", "lspd", "lsposed", "lspatch", "npatch", "edxp",
+            "riru", "zygisk", "magisk", "substrate", "libsandhook",
+            "libpine", "libwhale", "libdobby", "/data/local/tmp/",
+    };
+
+    try {
+        char buffer[CHECK_PROC_BUFFER_SIZE];
+        checkbeer::ProcReader maps("/proc/self/maps", buffer, sizeof(buffer));
+        if (!maps.ok()) {
+            LOGE("Cannot open /proc/self/maps (errno: %d)", errno);
+            return false;
+        }
+
+        // A library spans several mappings; report each path once
+        std::string_view lastPath;
+        std::string_view lines;
+        while (maps.nextLines(lines)) {
+            lastPath = {};
+            patterns.scan(lines, [&](size_t id, size_t offset) {
+                const char* base = lines.data();
+                const void* before = memrchr(base, '\n', offset);
+                size_t lineStart = before ? static_cast<size_t>(static_cast<const char*>(before) - base) + 1 : 0;
+                const uint8_t* after = checkbeer::FindByte(reinterpret_cast<const uint8_t*>(base) + offset,
+                                                           lines.size() - offset, '\n');
+                size_t lineEnd = after ? static_cast<size_t>(reinterpret_cast<const char*>(after) - base) : lines.size();
+                std::string_view line = lines.substr(lineStart, lineEnd - lineStart);
+
+                // Only the pathname column counts
+                checkbeer::MapsEntry entry;
+                if (!checkbeer::MapsEntry::parse(line, entry) || entry.path.empty() ||
+                    offset < static_cast<size_t>(entry.path.data() - lines.data()) || entry.path == lastPath) {
+                    return true;
+                }
+                lastPath = entry.path;
+
+                std::string_view pattern = patterns.pattern(id);
+                LOGE("Injected library \"%.*s\" mapped: %.*s",
+                     static_cast<int>(pattern.size()), pattern.data(),
+                     static_cast<int>(entry.path.size()), entry.path.data());
+                report.add(checkbeer::CheckId::InjectedLibraries, "%.*s (%c%c%c)",
+                           static_cast<int>(entry.path.size()), entry.path.data(),
+                           entry.readable ? 'r' : '-', entry.writable ? 'w' : '-', entry.executable ? 'x' : '-');
+                suspicious = true;
+                return true;
+            });
+        }
+
+        if (maps.overlongLines() > 0) {
+            LOGE("Skipped %zu overlong lines in /proc/self/maps", maps.overlongLines());
+        }
+        if (!suspicious) {
+            LOGI("No injected libraries mapped");
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while scanning mapped libraries: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Shellcode, inline-hook trampolines and in-memory loaders run from memory
+// that no library file backs. Only mappings that changed since the previous
+// run are examined; ones flagged earlier stay flagged while they remain.
+bool checkAnonymousExecutable(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static std::mutex monitorLock;
+    static checkbeer::MappingMonitor monitor;
+
+    try {
+        std::lock_guard<std::mutex> guard(monitorLock);
+        char buffer[CHECK_PROC_BUFFER_SIZE];
+        size_t newlyFlagged = 0;
+        bool readable = monitor.update("/proc/self/maps", buffer, sizeof(buffer), [&](const checkbeer::MapsEntry& entry) {
+            if (!entry.executable) return false;
+
+            using checkbeer::MappingKind;
+            MappingKind kind = checkbeer::ClassifyMapping(entry.path);
+            if (kind == MappingKind::File || kind == MappingKind::Special) return false;
+
+            // ART's JIT code caches ("/memfd:jit-cache", "[anon:dalvik-jit-code-cache]"
+            // and their zygote twins) are the legitimate ones
+            std::string_view path = entry.path;
+            if (path.find("jit-cache") != std::string_view::npos ||
+                path.find("jit-zygote-cache") != std::string_view::npos ||
+                path.find("jit-code-cache") != std::string_view::npos) {
+                return false;
+            }
+
+            const char* what = kind == MappingKind::Memfd ? "memfd" : "anonymous";
+            LOGE("New executable %s mapping %" PRIxPTR "-%" PRIxPTR " %s %.*s", what, entry.start, entry.end,
+                 entry.writable ? "rwx" : "r-x", static_cast<int>(entry.path.size()), entry.path.data());
+            report.add(checkbeer::CheckId::AnonymousExecutable, "%s %s %" PRIxPTR "-%" PRIxPTR " %.*s",
+                       entry.writable ? "rwx" : "r-x", what, entry.start, entry.end,
+                       static_cast<int>(entry.path.size()), entry.path.data());
+            newlyFlagged++;
+            return true;
+        });
+        if (!readable) {
+            LOGE("Cannot open /proc/self/maps (errno: %d)", errno);
+            return false;
+        }
+
+        const auto& stats = monitor.lastUpdate();
+        LOGI("Mappings: %zu, changed since last run: %zu", stats.mappings, stats.changed);
+        if (stats.flagged > 0) {
+            LOGE("%zu executable anonymous or memfd mappings present", stats.flagged);
+            if (stats.flagged > newlyFlagged) {
+                report.add(checkbeer::CheckId::AnonymousExecutable, "%zu flagged on earlier runs, still mapped",
+                           stats.flagged - newlyFlagged);
+            }
+            suspicious = true;
+        } else {
+            LOGI("No executable anonymous or memfd mappings");
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while checking executable mappings: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Renamed or memory-loaded instrumentation still carries its own strings and
+// writes recognisable trampolines over hooked code. Each run scans a budgeted
+// slice of memory; a hit counts until a full pass comes back clean.
+bool checkMemorySignatures(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static const checkbeer::MemorySignature signatures[] = {
+            {"Frida RPC protocol tag", "frida:rpc", false},
+            {"Frida script engine class", "FridaScriptEngine", false},
+            {"Frida agent entry point", "frida_agent_main", false},
+            {"Gum JavaScript loop thread", "gum-js-loop", false},
+            {"Gum interceptor class", "GumInterceptor", false},
+            {"Xposed bridge class", "de/robv/android/xposed/XposedBridge", false},
+            {"LSPosed daemon package", "org.lsposed.lspd", false},
+#if defined(__aarch64__)
+            {"ldr x16 + br x16 trampoline", std::string_view("\x50\x00\x00\x58\x00\x02\x1f\xd6", 8), true},
+            {"ldr x17 + br x17 trampoline", std::string_view("\x51\x00\x00\x58\x20\x02\x1f\xd6", 8), true},
+#elif defined(__x86_64__)
+            {"jmp [rip+0] trampoline", std::string_view("\xff\x25\x00\x00\x00\x00", 6), true},
+#endif
+    };
+    static std::mutex scannerLock;
+    static checkbeer::MemoryScanner scanner(signatures, sizeof(signatures) / sizeof(signatures[0]));
+    static bool excludedSelf = false;
+
+    try {
+        std::lock_guard<std::mutex> guard(scannerLock);
+        char buffer[CHECK_PROC_BUFFER_SIZE];
+
+        // Our own read-only data holds every signature above
+        if (!excludedSelf) {
+            excludedSelf = scanner.excludeModuleOf(reinterpret_cast<const void*>(&checkMemorySignatures),
+                                                   buffer, sizeof(buffer));
+            if (!excludedSelf) LOGE("Cannot find our own module in /proc/self/maps");
+        }
+
+        checkbeer::ScanBudget budget = {CHECK_SCAN_BYTES_PER_RUN, static_cast<int64_t>(CHECK_SCAN_BUDGET_US) * 1000};
+        checkbeer::ScanProgress progress = scanner.scan(budget, buffer, sizeof(buffer),
+                [&](const checkbeer::MemorySignature& signature, uintptr_t address) {
+                    LOGE("Found %s at %" PRIxPTR, signature.name, address);
+                    report.add(checkbeer::CheckId::MemorySignatures, "%s at %" PRIxPTR, signature.name, address);
+                });
+
+        LOGI("Scanned %zu KiB in %zu regions (%zu KiB unreadable) in %" PRId64 " us%s",
+             progress.bytesScanned >> 10, progress.regionsVisited, progress.unreadableBytes >> 10,
+             progress.elapsedNs / 1000, progress.passCompleted ? ", pass complete" : "");
+        if (scanner.recentMatches() > 0) {
+            LOGE("%zu instrumentation signatures in memory", scanner.recentMatches());
+            suspicious = true;
+        } else {
+            LOGI("No instrumentation signatures in memory so far");
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while scanning memory: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Every other check goes through env->functions, and a hook on GetMethodID or
+// GetStringUTFChars can make all of them lie. The table and each function in
+// it must come from the runtime library, and the natives we registered must
+// still be bound to our functions.
+bool checkJniFunctionTable(JNIEnv* env, checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+#ifdef __ANDROID__
+    static checkbeer::JniTableVerifier verifier = {"libart.so", "libartd.so"};
+#else
+    static checkbeer::JniTableVerifier verifier = {"libjvm.so"};
+#endif
+    static std::mutex verifierLock;
+
+    try {
+        std::lock_guard<std::mutex> guard(verifierLock);
+        auto onForeign = [&](size_t slot, const void* target, const checkbeer::MappingInfo* mapping) {
+            std::string_view path = !mapping ? "unmapped" : mapping->path.empty() ? "anonymous" : mapping->path;
+            const char* name = slot == checkbeer::kJniTableSlots ? "function table" : checkbeer::JniSlotName(slot);
+            char slotName[32];
+            if (!name) {
+                snprintf(slotName, sizeof(slotName), "slot %zu", slot);
+                name = slotName;
+            }
+            LOGE("JNI %s redirected to %p in %.*s", name, target, static_cast<int>(path.size()), path.data());
+            report.add(checkbeer::CheckId::JniFunctionTable, "%s -> %p %.*s", name, target,
+                       static_cast<int>(path.size()), path.data());
+        };
+
+        // Recorded and replayed runs hand us an env whose table is our own
+        const JNIEnv* runtimeEnv = checkbeer::RuntimeEnv(env);
+        checkbeer::JniTableVerifier::Result table = {};
+        if (runtimeEnv) table = verifier.verify(runtimeEnv, onForeign);
+        if (!runtimeEnv) {
+            LOGI("JNI function table not checked, no runtime behind this env");
+        } else if (table.checked == 0) {
+            LOGE("Cannot index /proc/self/maps (errno: %d)", errno);
+        } else if (table.foreign > 0 || table.tableForeign) {
+            LOGE("%zu of %zu JNI functions outside the runtime%s", table.foreign, table.checked,
+                 table.tableForeign ? ", table itself replaced" : "");
+            suspicious = true;
+        } else {
+            LOGI("JNI function table intact (%zu functions%s)", table.checked, table.cached ? ", unchanged" : "");
+        }
+
+        checkbeer::NativeBindings::Result bindings = checkbeer::VerifyNativeBindings(
+                [&](const char* name, const void* expected, const void* actual) {
+                    LOGE("Native %s rebound from %p to %p", name, expected, actual);
+                    report.add(checkbeer::CheckId::JniFunctionTable, "native %s rebound to %p", name, actual);
+                });
+        if (bindings.rebound > 0) {
+            suspicious = true;
+        } else {
+            LOGI("Native bindings intact (%zu checked, %zu unverifiable)", bindings.checked, bindings.unverifiable);
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while verifying the JNI function table: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Loaded libraries parsed from disk, shared by the checks that compare code
+// in memory with its file
+static std::mutex gModulesLock;
+static checkbeer::ModuleCache gModules;
+
+#ifdef __ANDROID__
+#define CHECK_LIBC "libc.so"
+#else
+#define CHECK_LIBC "libc.so.6"
+#endif
+
+// PLT hooks redirect a library's calls by rewriting its GOT, typically so
+// that open or stat on the APK reads a clean copy. libc calls its own file
+// functions through its PLT too, so its GOT is watched with ours and libart's.
+bool checkGotHooks(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static const checkbeer::GotExpectation expectations[] = {
+            {"open", CHECK_LIBC}, {"open64", CHECK_LIBC}, {"openat", CHECK_LIBC}, {"__open_2", CHECK_LIBC},
+            {"__openat_2", CHECK_LIBC}, {"fopen", CHECK_LIBC}, {"stat", CHECK_LIBC}, {"stat64", CHECK_LIBC},
+            {"lstat", CHECK_LIBC}, {"fstat", CHECK_LIBC}, {"fstatat", CHECK_LIBC}, {"fstatat64", CHECK_LIBC},
+            {"access", CHECK_LIBC}, {"faccessat", CHECK_LIBC}, {"chmod", CHECK_LIBC}, {"fchmodat", CHECK_LIBC},
+            {"readlink", CHECK_LIBC}, {"readlinkat", CHECK_LIBC}, {"realpath", CHECK_LIBC}, {"read", CHECK_LIBC},
+            {"pread64", CHECK_LIBC}, {"mmap", CHECK_LIBC}, {"mmap64", CHECK_LIBC}, {"process_vm_readv", CHECK_LIBC},
+            {"__system_property_get", CHECK_LIBC},
+#ifdef __ANDROID__
+            {"dlopen", "libdl.so"}, {"dlsym", "libdl.so"}, {"android_dlopen_ext", "libdl.so"},
+#endif
+    };
+    static checkbeer::GotScanner scanner(expectations, sizeof(expectations) / sizeof(expectations[0]));
+    static size_t watched = 0;
+#ifdef __ANDROID__
+    static const char* const importers[] = {CHECK_LIBC, "libart.so"};
+#else
+    static const char* const importers[] = {CHECK_LIBC};
+#endif
+
+    try {
+        std::lock_guard<std::mutex> guard(gModulesLock);
+        std::shared_ptr<const checkbeer::MappingIndex> index = checkbeer::GetMappingIndex(false);
+        if (!index) {
+            LOGE("Cannot index /proc/self/maps (errno: %d)", errno);
+            return false;
+        }
+
+        // Resolved once; libraries missing now are looked for again next run
+        size_t wanted = sizeof(importers) / sizeof(importers[0]) + 1;
+        if (watched < wanted) {
+            watched = 0;
+            const checkbeer::LoadedModule* self =
+                    gModules.moduleAt(*index, reinterpret_cast<uintptr_t>(&checkGotHooks));
+            if (self) {
+                scanner.watch(gModules, *index, *self);
+                watched++;
+            }
+            for (const char* name : importers) {
+                const checkbeer::LoadedModule* module = gModules.moduleNamed(*index, name);
+                if (!module) {
+                    LOGE("Cannot parse %s", name);
+                    continue;
+                }
+                scanner.watch(gModules, *index, *module);
+                watched++;
+            }
+        }
+
+        checkbeer::GotScanner::Result result = scanner.verify(*index,
+                [&](const checkbeer::GotScanner::Slot& slot, uintptr_t actual, const checkbeer::MappingInfo* target) {
+                    std::string_view where = !target ? "unmapped" : target->path.empty() ? "anonymous" : target->path;
+                    LOGE("GOT hook: %s in %.*s -> %" PRIxPTR " (%.*s)", slot.symbol,
+                         static_cast<int>(slot.importer->name.size()), slot.importer->name.data(), actual,
+                         static_cast<int>(where.size()), where.data());
+                    report.add(checkbeer::CheckId::GotHooks, "%s@%.*s -> %" PRIxPTR " %.*s", slot.symbol,
+                               static_cast<int>(slot.importer->name.size()), slot.importer->name.data(), actual,
+                               static_cast<int>(where.size()), where.data());
+                });
+        if (result.hooked > 0) {
+            LOGE("%zu of %zu GOT slots hooked", result.hooked, result.slots);
+            suspicious = true;
+        } else {
+            LOGI("GOT intact: %zu slots in %zu modules (%zu not yet bound)", result.slots, result.modules,
+                 result.unbound);
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while checking GOT entries: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Inline hooks leave the GOT alone and patch the function itself. The first
+// bytes of the file functions signature checks depend on, ART's reflection
+// and native registration paths, and our own entry points must match the
+// library files they were loaded from.
+bool checkInlineHooks(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static const struct {
+        const char* library;
+        const char* symbol;
+    } targets[] = {
+            {CHECK_LIBC, "open"}, {CHECK_LIBC, "openat"}, {CHECK_LIBC, "__openat"}, {CHECK_LIBC, "read"},
+            {CHECK_LIBC, "pread64"}, {CHECK_LIBC, "stat"}, {CHECK_LIBC, "fstatat"}, {CHECK_LIBC, "fstatat64"},
+            {CHECK_LIBC, "access"}, {CHECK_LIBC, "faccessat"}, {CHECK_LIBC, "readlinkat"}, {CHECK_LIBC, "fopen"},
+            {CHECK_LIBC, "mmap"}, {CHECK_LIBC, "syscall"}, {CHECK_LIBC, "__system_property_get"},
+#ifdef __ANDROID__
+            {"libdl.so", "dlsym"},
+            {"libart.so", "_ZN3art9ArtMethod6InvokeEPNS_6ThreadEPjjPNS_6JValueEPKc"},
+            {"libart.so", "_ZN3art9ArtMethod14RegisterNativeEPKv"},
+            {"libart.so", "_ZN3art11ClassLinker14RegisterNativeEPNS_6ThreadEPNS_9ArtMethodEPKv"},
+            {"libart.so", "_ZN3art12InvokeMethodILNS_11PointerSizeE8EEEP8_jobjectRKNS_33ScopedObjectAccessAlreadyRunnableES3_S3_S3_m"},
+#endif
+    };
+    static checkbeer::PrologueScanner scanner(CHECK_PROLOGUE_BYTES);
+    static bool resolved = false;
+
+    try {
+        std::lock_guard<std::mutex> guard(gModulesLock);
+        if (!resolved) {
+            std::shared_ptr<const checkbeer::MappingIndex> index = checkbeer::GetMappingIndex(false);
+            if (!index) {
+                LOGE("Cannot index /proc/self/maps (errno: %d)", errno);
+                return false;
+            }
+
+            // Symbols differ between releases; absent ones are simply not watched
+            size_t absent = 0;
+            for (const auto& target : targets) {
+                if (!scanner.watchSymbol(gModules, *index, target.library, target.symbol)) absent++;
+            }
+            scanner.watchAddress(gModules, *index, "checkSignatureBypass",
+                                 reinterpret_cast<const void*>(&checkSignatureBypass));
+            scanner.watchAddress(gModules, *index, "checkOnLoad", reinterpret_cast<const void*>(&checkOnLoad));
+            checkbeer::ForEachNativeBinding([&](const char* name, const void* function) {
+                scanner.watchAddress(gModules, *index, name, function);
+            });
+            LOGI("Watching %zu function prologues, %zu targets not found", scanner.functions().size(), absent);
+            resolved = true;
+        }
+
+        checkbeer::PrologueScanner::Result result = scanner.verify([&](const checkbeer::PrologueScanner::Function& function) {
+            const uint8_t* code = reinterpret_cast<const uint8_t*>(function.address);
+            char bytes[3 * 8] = "";
+            size_t len = 0;
+            for (size_t i = 0; i < function.length && i < 8; i++) {
+                len += static_cast<size_t>(snprintf(bytes + len, sizeof(bytes) - len, i ? " %02x" : "%02x", code[i]));
+            }
+            LOGE("Inline hook: %s in %.*s starts with %s", function.name,
+                 static_cast<int>(function.module->name.size()), function.module->name.data(), bytes);
+            report.add(checkbeer::CheckId::InlineHooks, "%s@%.*s patched: %s", function.name,
+                       static_cast<int>(function.module->name.size()), function.module->name.data(), bytes);
+        });
+        if (result.patched > 0) {
+            LOGE("%zu of %zu function prologues patched", result.patched, result.functions);
+            suspicious = true;
+        } else {
+            LOGI("%zu function prologues match their files", result.functions);
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while comparing function prologues: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Every check here is moot if the code running it has been patched. Our
+// executable segments are hashed in full once and compared with the digest
+// tools/embed_text_digest.py wrote at build time; after that, each run
+// re-hashes a few chunks against the first run's per-chunk hashes.
+bool checkSelfIntegrity(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static std::mutex integrityLock;
+    static checkbeer::TextIntegrity integrity;
+
+    try {
+        std::lock_guard<std::mutex> guard(integrityLock);
+        checkbeer::TextIntegrity::Result result = integrity.verify(CHECK_SELF_SAMPLE_CHUNKS,
+                [&](uintptr_t address, size_t length) {
+                    LOGE("Own code changed at %" PRIxPTR " (%zu bytes)", address, length);
+                    report.add(checkbeer::CheckId::SelfIntegrity, "code changed at %" PRIxPTR, address);
+                });
+
+        using Status = checkbeer::TextIntegrity::Status;
+        LOGI("Hashed %zu of %zu code chunks (%zu KiB) in %" PRId64 " us", result.chunks, integrity.chunkCount(),
+             result.bytesHashed >> 10, result.elapsedNs / 1000);
+        switch (result.status) {
+            case Status::Match:
+                LOGI("Own code intact");
+                break;
+            case Status::Mismatch:
+                LOGE("Own code does not match its build-time digest");
+                if (result.full) report.add(checkbeer::CheckId::SelfIntegrity, "text digest mismatch");
+                suspicious = true;
+                break;
+            case Status::NoDigest:
+                LOGE("No embedded text digest; run tools/embed_text_digest.py after linking");
+                break;
+            case Status::NoText:
+                LOGE("Cannot find our own executable segments");
+                break;
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while hashing our own code: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
+// Background workers for the checks that hash more than a run's worth of
+// memory; started on first use
+static checkbeer::ThreadPool& checkPool() {
+    static checkbeer::ThreadPool pool;
+    return pool;
+}
+
+// Repackaged or hot-patched bytecode differs from the files it was mapped
+// from. Every dex, vdex, odex and APK mapping under the app's directory is
+// compared with its file, chunk by chunk, a time-budgeted slice per run.
+bool checkDexMappings(checkbeer::CheckReport& report) {
+    bool suspicious = false;
+
+    static std::mutex verifierLock;
+    static checkbeer::DexMappingVerifier verifier(checkPool());
+    static std::string appDir;
+
+    try {
+        std::lock_guard<std::mutex> guard(verifierLock);
+        std::shared_ptr<const checkbeer::MappingIndex> index = checkbeer::GetMappingIndex(true);
+        if (index && appDir.empty()) {
+            const checkbeer::MappingInfo* self = index->find(reinterpret_cast<uintptr_t>(&checkDexMappings));
+            if (self) appDir = checkbeer::AppCodeDirectory(self->path);
+#ifdef __ANDROID__
+            // Before Android 12 the runtime unquickens dex inside the vdex
+            // in place, so it never matches its file
+            char sdk[PROP_VALUE_MAX] = {};
+            if (__system_property_get("ro.build.version.sdk", sdk) > 0 && atoi(sdk) < 31) {
+                verifier.skipExtension(".vdex");
+            }
+#endif
+        }
+
+        if (!index) {
+            LOGE("Cannot index /proc/self/maps (errno: %d)", errno);
+        } else if (appDir.empty()) {
+            LOGE("Cannot find the app's code directory");
+        } else {
+            checkbeer::DexMappingVerifier::Result result = verifier.verify(*index, appDir,
+                    static_cast<int64_t>(CHECK_DEX_BUDGET_US) * 1000,
+                    [&](std::string_view path, uintptr_t address, uint64_t fileOffset, size_t length) {
+                        LOGE("%.*s at %" PRIxPTR " differs from its file at offset %" PRIu64 " (%zu bytes)",
+                             static_cast<int>(path.size()), path.data(), address, fileOffset, length);
+                        report.add(checkbeer::CheckId::DexMappings, "%.*s changed at offset %" PRIu64,
+                                   static_cast<int>(path.size()), path.data(), fileOffset);
+                    });
+
+            LOGI("Compared %zu KiB of %zu code mappings in %zu chunks (%zu KiB read from disk, %zu unreadable) "
+                 "in %" PRId64 " us%s", result.bytesHashed >> 10, result.mappings, result.chunks,
+                 result.diskBytesHashed >> 10, result.unreadable, result.elapsedNs / 1000,
+                 result.passCompleted ? ", pass complete" : "");
+            if (result.replaced > 0) LOGE("%zu code mappings no longer match the file at their path", result.replaced);
+            if (verifier.recentMismatches() > 0) {
+                LOGE("%zu chunks of mapped code differ from disk", verifier.recentMismatches());
+                suspicious = true;
+            } else {
+                LOGI("Mapped dex and oat files match disk");
+            }
+        }
+    } catch (const std::exception& e) {
+        LOGE("Error while comparing mapped code with disk: %s", e.what());
+        suspicious = true;
+    }
+    LOGE("\n");
+    return suspicious;
+}
+
 bool checkSignatureBypass(JNIEnv* env, jobject context) {
+    CHECK_TRACE_SPAN("checkSignatureBypass");
     LOGI("Starting native signature checks");
     LOGI("----------START-----------------");
     bool suspicious = false;
 
-    suspicious |= checkCreator(env);
-    suspicious |= checkField(env);
-    suspicious |= checkCreators(env);
-    suspicious |= checkPMProxy(env, context);
-    suspicious |= checkAppComponentFactory(env);
-    suspicious |= checkApkPaths(env, context);
+#if CHECK_ALLOC_PROFILE
+    checkbeer::ResetAllocProfile();
+#endif
+
+    // All check temporaries come from here and are dropped together on return
+    checkbeer::StackArena<CHECK_ARENA_SIZE> arena;
+    checkbeer::CheckReport report;
+
+    // Each check runs in its own local frame, so the references it creates
+    // are freed together even when it returns through an exception
+    using checkbeer::CheckId;
+    auto run = [env](CheckId id, auto&& check) {
+        return checkbeer::TimedCheck(id, [&] {
+            jni::ScopedLocalFrame frame(env, CHECK_LOCAL_FRAME_SIZE);
+            return check();
+        });
+    };
+    // Our own code first, then the JNI table all the JNI checks below trust.
+    // Neither creates local references, so no local frame
+    suspicious |= checkbeer::TimedCheck(CheckId::SelfIntegrity, [&] { return checkSelfIntegrity(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::JniFunctionTable, [&] { return checkJniFunctionTable(env, report); });
+    suspicious |= run(CheckId::Creator, [&] { return checkCreator(env, arena); });
+    suspicious |= run(CheckId::Field, [&] { return checkField(env, arena); });
+    suspicious |= run(CheckId::Creators, [&] { return checkCreators(env, arena); });
+    suspicious |= run(CheckId::PMProxy, [&] { return checkPMProxy(env, context, arena); });
+    suspicious |= run(CheckId::AppComponentFactory, [&] { return checkAppComponentFactory(env, arena); });
+    suspicious |= run(CheckId::ApkPaths, [&] { return checkApkPaths(env, context, arena); });
+    suspicious |= run(CheckId::ApkIdentity, [&] { return checkApkIdentity(env, context, arena, report); });
+    suspicious |= run(CheckId::ApkMounts, [&] { return checkApkMounts(env, context, arena, report); });
+    // These make no JNI calls, so no local frame
+    suspicious |= checkbeer::TimedCheck(CheckId::InjectedLibraries, [&] { return checkInjectedLibraries(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::AnonymousExecutable, [&] { return checkAnonymousExecutable(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::MemorySignatures, [&] { return checkMemorySignatures(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::GotHooks, [&] { return checkGotHooks(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::InlineHooks, [&] { return checkInlineHooks(report); });
+    suspicious |= checkbeer::TimedCheck(CheckId::DexMappings, [&] { return checkDexMappings(report); });
     LOGE("\n");
-    LOGI("Native signature checks completed, suspicious: %d", suspicious);
+    LOGI("Check arena: %zu bytes used, %zu heap allocations", arena.bytesUsed(), arena.heapAllocations());
+#if CHECK_ALLOC_PROFILE
+    char profile[4096];
+    checkbeer::FormatAllocProfile(profile, sizeof(profile));
+    LOGI("Allocation profile:\n%s", profile);
+#endif
+    checkbeer::PublishCheckReport(report);
+    LOGI("Native signature checks completed, suspicious: %d, findings: %zu", suspicious, report.count());
     LOGI("---------------END-----------------");
 
     return suspicious;
-}
\ No newline at end of file
+}
+
+// Run the checks once with every JNI call logged to path, bindings lookups
+// included. The trace can be replayed off-device with replaySignatureBypass.
+bool recordSignatureBypass(JNIEnv* env, jobject context, const char* path) {
+    jni::RecordingEnv recorder(env);
+    uint64_t contextWord = jni::detail::ToWord(context);
+    recorder.addMeta(CHECK_TRACE_META_CONTEXT, &contextWord, 1);
+
+    bool suspicious = false;
+    try {
+        checkbeer::ScopedCheckBindings bindings(recorder.get(), recorder.real());
+        suspicious = checkSignatureBypass(recorder.get(), context);
+    } catch (const std::exception& e) {
+        LOGE("Error while recording checks: %s", e.what());
+    }
+
+    if (recorder.save(path)) {
+        LOGI("Recorded %zu JNI calls to %s", recorder.callCount(), path);
+    } else {
+        LOGE("Failed to write JNI trace to %s", path);
+    }
+    return suspicious;
+}
+
+// Run the checks against a recorded trace instead of a VM, e.g. in a host
+// build against the JDK's jni.h. File system probes still hit the local
+// machine, so only the JNI side is reproduced. With simulateLatency each call
+// takes as long as it did on the device. Returns true if the checks made
+// exactly the recorded calls; the verdict is stored in suspicious.
+bool replaySignatureBypass(const char* path, bool simulateLatency, bool* suspicious) {
+    jni::ReplayEnv replay(simulateLatency);
+    if (!replay.load(path)) {
+        LOGE("Failed to load JNI trace from %s", path);
+        return false;
+    }
+
+    const std::vector<uint64_t>* contextMeta = replay.meta(CHECK_TRACE_META_CONTEXT);
+    jobject context = contextMeta && !contextMeta->empty() ? jni::detail::FromWord<jobject>((*contextMeta)[0]) : nullptr;
+
+    bool result = false;
+    try {
+        checkbeer::ScopedCheckBindings bindings(replay.get());
+        result = checkSignatureBypass(replay.get(), context);
+    } catch (const std::exception& e) {
+        LOGE("Error while replaying checks: %s", e.what());
+    }
+    if (suspicious) *suspicious = result;
+
+    if (replay.diverged()) {
+        LOGE("JNI replay diverged at %s", replay.divergence().c_str());
+    } else if (!replay.finished()) {
+        LOGE("JNI replay stopped after %zu of %zu calls", replay.position(), replay.calls().size());
+    }
+    return replay.finished();
+}
+
+// Replay a recorded trace back to back on one thread, the way a native
+// thread that never returns to Java would run the checks, and judge local
+// reference, RSS and latency stability. The report is written to report
+// as key=value lines; returns whether every limit held.
+bool soakSignatureBypass(const char* path, uint64_t iterations, char* report, size_t reportSize,
+                         const checkbeer::SoakLimits& limits) {
+    jni::ReplayEnv replay;
+    if (!replay.load(path)) {
+        LOGE("Failed to load JNI trace from %s", path);
+        return false;
+    }
+
+    const std::vector<uint64_t>* contextMeta = replay.meta(CHECK_TRACE_META_CONTEXT);
+    jobject context = contextMeta && !contextMeta->empty() ? jni::detail::FromWord<jobject>((*contextMeta)[0]) : nullptr;
+
+#ifndef __ANDROID__
+    bool wasMuted = gCheckLogsMuted;
+    gCheckLogsMuted = true;
+#endif
+    checkbeer::SoakReport result = checkbeer::RunSoak(iterations, limits, [&] {
+        replay.rewind();
+        try {
+            checkbeer::ScopedCheckBindings bindings(replay.get());
+            checkSignatureBypass(replay.get(), context);
+        } catch (const std::exception&) {
+            // A divergence shows up as an unfinished replay below
+        }
+        return checkbeer::SoakSample{replay.finished(), replay.peakLocalRefs(), replay.liveLocalRefs()};
+    });
+#ifndef __ANDROID__
+    gCheckLogsMuted = wasMuted;
+#endif
+
+    checkbeer::FormatSoakReport(result, report, reportSize);
+    if (!result.passed()) {
+        LOGE("Soak failed after %" PRIu64 " iterations, peak local refs %zu", iterations, result.peakLocalRefs);
+        if (replay.diverged()) LOGE("JNI replay diverged at %s", replay.divergence().c_str());
+    }
+    return result.passed();
+}
+
+// Resolve the JNI bindings on a low-priority attached thread so the first
+// foreground check only makes calls
+void startBindingWarmup() {
+    try {
+        std::thread([] {
+            // On Linux this only lowers the calling thread
+            setpriority(PRIO_PROCESS, 0, 10);
+
+            // Detached by the env manager when the thread exits
+            JNIEnv* env = jni::CurrentEnv("CheckBeerWarmup");
+            if (!env) {
+                LOGE("Failed to attach warm-up thread");
+                return;
+            }
+
+            try {
+                checkbeer::GetCheckBindings(env);
+                LOGI("JNI bindings warmed up");
+            } catch (const std::exception& e) {
+                LOGE("Error while warming up JNI bindings: %s", e.what());
+            }
+        }).detach();
+    } catch (const std::exception& e) {
+        LOGE("Failed to start warm-up thread: %s", e.what());
+    }
+}
+
+// Marks the moment the dynamic linker ran our constructors, the closest
+// in-process point to dlopen
+__attribute__((constructor)) static void onCheckLibraryLoaded() {
+    checkbeer::RecordLibraryLoad();
+    // Pick the hashing and scanning kernels now rather than on a check's clock
+    checkbeer::GetKernels();
+}
+
+static jboolean nativeRunChecks(JNIEnv* env, jclass, jobject context) {
+    return checkSignatureBypass(env, context) ? JNI_TRUE : JNI_FALSE;
+}
+
+static jboolean nativeRecordChecks(JNIEnv* env, jclass, jobject context, jstring path) {
+    std::string tracePath = jni::JStringToString(env, path);
+    return recordSignatureBypass(env, context, tracePath.c_str()) ? JNI_TRUE : JNI_FALSE;
+}
+
+static void nativeSetMeasurementEnabled(JNIEnv*, jclass, jboolean enabled) {
+    checkbeer::SetMeasurementEnabled(enabled == JNI_TRUE);
+}
+
+static jstring nativeColdStartStats(JNIEnv* env, jclass) {
+    char buffer[2048];
+    checkbeer::FormatColdStartStats(checkbeer::GetColdStartStats(), buffer, sizeof(buffer));
+    return env->NewStringUTF(buffer);
+}
+
+// Fields per check in the latencySnapshot() array
+#define CHECK_LATENCY_FIELDS 7
+
+// One call returns every histogram, flattened as
+// [count, min, max, mean, p50, p99, p999] per check in CheckId order
+static jlongArray nativeLatencySnapshot(JNIEnv* env, jclass) {
+    jlong values[checkbeer::kCheckCount * CHECK_LATENCY_FIELDS];
+    for (int i = 0; i < checkbeer::kCheckCount; i++) {
+        checkbeer::LatencySnapshot snap = checkbeer::GetCheckLatency(static_cast<checkbeer::CheckId>(i));
+        jlong* out = values + i * CHECK_LATENCY_FIELDS;
+        out[0] = static_cast<jlong>(snap.count);
+        out[1] = snap.minNs;
+        out[2] = snap.maxNs;
+        out[3] = snap.meanNs;
+        out[4] = snap.p50Ns;
+        out[5] = snap.p99Ns;
+        out[6] = snap.p999Ns;
+    }
+
+    jsize length = checkbeer::kCheckCount * CHECK_LATENCY_FIELDS;
+    jlongArray result = env->NewLongArray(length);
+    if (result) env->SetLongArrayRegion(result, 0, length, values);
+    return result;
+}
+
+static void nativeResetLatency(JNIEnv*, jclass) {
+    checkbeer::ResetCheckLatency();
+}
+
+static jboolean nativeStartTracing(JNIEnv*, jclass) {
+    return checkbeer::StartTracing() ? JNI_TRUE : JNI_FALSE;
+}
+
+static void nativeStopTracing(JNIEnv*, jclass) {
+    checkbeer::StopTracing();
+}
+
+static jstring nativeLastReport(JNIEnv* env, jclass) {
+    char buffer[checkbeer::CheckReport::kMaxFindings * 192];
+    checkbeer::FormatLastCheckReport(buffer, sizeof(buffer));
+    return env->NewStringUTF(buffer);
+}
+
+// Android's jni.h declares the name and signature const, the JDK's does not
+static JNINativeMethod nativeMethod(const char* name, const char* signature, void* fnPtr) {
+    return {const_cast<char*>(name), const_cast<char*>(signature), fnPtr};
+}
+
+// Bind the Kotlin entry points. Apps that only call checkSignatureBypass
+// from their own natives don't ship the class, so a missing class is not an error.
+void registerCheckNatives(JNIEnv* env) {
+    static const JNINativeMethod methods[] = {
+            nativeMethod("runChecks", "(Landroid/content/Context;)Z", reinterpret_cast<void*>(nativeRunChecks)),
+            nativeMethod("recordChecks", "(Landroid/content/Context;Ljava/lang/String;)Z", reinterpret_cast<void*>(nativeRecordChecks)),
+            nativeMethod("setMeasurementEnabled", "(Z)V", reinterpret_cast<void*>(nativeSetMeasurementEnabled)),
+            nativeMethod("coldStartStats", "()Ljava/lang/String;", reinterpret_cast<void*>(nativeColdStartStats)),
+            nativeMethod("latencySnapshot", "()[J", reinterpret_cast<void*>(nativeLatencySnapshot)),
+            nativeMethod("resetLatency", "()V", reinterpret_cast<void*>(nativeResetLatency)),
+            nativeMethod("startTracing", "()Z", reinterpret_cast<void*>(nativeStartTracing)),
+            nativeMethod("stopTracing", "()V", reinterpret_cast<void*>(nativeStopTracing)),
+            nativeMethod("lastReport", "()Ljava/lang/String;", reinterpret_cast<void*>(nativeLastReport)),
+    };
+
+    jclass cls = env->FindClass(CHECK_NATIVE_CLASS);
+    if (!cls) {
+        env->ExceptionClear();
+        LOGI("%s not present, skipping native registration", CHECK_NATIVE_CLASS);
+        return;
+    }
+    jni::ScopedLocalRef<jclass> clsRef(env, cls);
+
+    if (env->RegisterNatives(cls, methods, sizeof(methods) / sizeof(methods[0])) != JNI_OK) {
+        env->ExceptionClear();
+        LOGE("Failed to register natives for %s", CHECK_NATIVE_CLASS);
+        return;
+    }
+    checkbeer::RecordNativeBindings(env, cls, methods, sizeof(methods) / sizeof(methods[0]));
+}
+
+// Library load hook; call this from your JNI_OnLoad, or build with
+// CHECK_DEFINE_JNI_ONLOAD to have one defined that does
+jint checkOnLoad(JavaVM* vm) {
+    checkbeer::RecordOnLoad();
+    jni::SetJavaVM(vm);
+
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        registerCheckNatives(env);
+    }
+
+#if CHECK_EAGER_WARMUP
+    startBindingWarmup();
+#endif
+    return JNI_VERSION_1_6;
+}
+
+#if CHECK_ALLOC_PROFILE
+// Allocation hooks for bench builds. operator new/delete are replaced on
+// every platform. The malloc family is only interposed on glibc hosts, where
+// __libc_* reach the real allocator; bionic has no such entry points for a
+// dlopen'd library, so on device C allocations (arena blocks, stdio) go
+// unattributed. Sizes are malloc_usable_size, which is what the block costs.
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void* __libc_valloc(size_t size);
+extern "C" void* __libc_pvalloc(size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static void* realMalloc(size_t size) { return __libc_malloc(size); }
+static void* realMemalign(size_t alignment, size_t size) { return __libc_memalign(alignment, size); }
+static void realFree(void* ptr) { __libc_free(ptr); }
+#else
+static void* realMalloc(size_t size) { return malloc(size); }
+static void* realMemalign(size_t alignment, size_t size) { return memalign(alignment, size); }
+static void realFree(void* ptr) { free(ptr); }
+#endif
+
+static void* profiledAlloc(size_t size) {
+    void* ptr = realMalloc(size);
+    if (ptr) checkbeer::detail::OnAlloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+static void* profiledMemalign(size_t alignment, size_t size) {
+    void* ptr = realMemalign(alignment, size);
+    if (ptr) checkbeer::detail::OnAlloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+static void profiledFree(void* ptr) {
+    if (!ptr) return;
+    checkbeer::detail::OnFree(malloc_usable_size(ptr));
+    realFree(ptr);
+}
+
+static void* profiledNew(size_t size) {
+    void* ptr = profiledAlloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+static void* profiledNew(size_t size, std::align_val_t alignment) {
+    void* ptr = profiledMemalign(static_cast<size_t>(alignment), size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size) { return profiledNew(size); }
+void* operator new[](size_t size) { return profiledNew(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return profiledAlloc(size ? size : 1); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return profiledAlloc(size ? size : 1); }
+void* operator new(size_t size, std::align_val_t alignment) { return profiledNew(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return profiledNew(size, alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return profiledMemalign(static_cast<size_t>(alignment), size ? size : 1);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return profiledMemalign(static_cast<size_t>(alignment), size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr) noexcept { profiledFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { profiledFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { profiledFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { profiledFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { profiledFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { profiledFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { profiledFree(ptr); }
+
+#ifdef __GLIBC__
+extern "C" void* malloc(size_t size) noexcept {
+    return profiledAlloc(size);
+}
+
+extern "C" void free(void* ptr) noexcept {
+    profiledFree(ptr);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept {
+    void* ptr = __libc_calloc(count, size);
+    if (ptr) checkbeer::detail::OnAlloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept {
+    size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+    void* result = __libc_realloc(ptr, size);
+    if (result) {
+        checkbeer::detail::OnFree(oldSize);
+        checkbeer::detail::OnAlloc(malloc_usable_size(result));
+    } else if (ptr && size == 0) {
+        checkbeer::detail::OnFree(oldSize);
+    }
+    return result;
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) noexcept {
+    return profiledMemalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    return profiledMemalign(alignment, size);
+}
+
+extern "C" void* valloc(size_t size) noexcept {
+    void* ptr = __libc_valloc(size);
+    if (ptr) checkbeer::detail::OnAlloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+extern "C" void* pvalloc(size_t size) noexcept {
+    void* ptr = __libc_pvalloc(size);
+    if (ptr) checkbeer::detail::OnAlloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+extern "C" int posix_memalign(void** out, size_t alignment, size_t size) noexcept {
+    void* ptr = profiledMemalign(alignment, size);
+    if (!ptr) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+#endif
+#endif
+
+#if CHECK_DEFINE_JNI_ONLOAD
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void*) {
+    return checkOnLoad(vm);
+}
+#endif
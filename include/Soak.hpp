@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "CheckMetrics.hpp"
+#include "LatencyHistogram.hpp"
+
+namespace checkbeer {
+
+    // Outcome of one soak iteration
+    struct SoakSample {
+        bool ok;
+        size_t peakLocalRefs; // most local references live at once during the iteration
+        size_t liveLocalRefs; // still live after it
+    };
+
+    // Pass criteria for a soak run
+    struct SoakLimits {
+        size_t maxLocalRefs = 64;       // peak live local references, the VM's table holds 512
+        int64_t maxRssGrowthKb = 1024;  // between the end of warm-up and the end of the run
+        double maxP99Growth = 0.25;     // late-window p99 over early-window p99
+    };
+
+    // Result of RunSoak. The early latency window starts after the warm-up
+    // window and the late one covers the last window of the run, each a tenth
+    // of the iterations.
+    struct SoakReport {
+        uint64_t iterations;
+        uint64_t failures;
+        size_t peakLocalRefs;
+        size_t finalLocalRefs;
+        int64_t rssStartKb;
+        int64_t rssEndKb;
+        LatencySnapshot early;
+        LatencySnapshot late;
+        bool localRefsBounded;
+        bool rssFlat;
+        bool latencyStable;
+
+        bool passed() const { return failures == 0 && localRefsBounded && rssFlat && latencyStable; }
+    };
+
+    // Resident set size from /proc/self/statm, -1 if unavailable
+    inline int64_t ReadRssKb() {
+        int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return -1;
+        char buffer[128];
+        ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if (n <= 0) return -1;
+        buffer[n] = '\0';
+
+        char* end = nullptr;
+        strtoll(buffer, &end, 10); // total program size
+        long long residentPages = strtoll(end, nullptr, 10);
+        return static_cast<int64_t>(residentPages) * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    // Call iteration() the given number of times and judge local-reference
+    // growth, RSS growth and latency drift against limits
+    template <typename F>
+    SoakReport RunSoak(uint64_t iterations, const SoakLimits& limits, F&& iteration) {
+        SoakReport report = {};
+        report.iterations = iterations;
+        report.rssStartKb = ReadRssKb();
+
+        uint64_t window = iterations / 10 > 0 ? iterations / 10 : 1;
+        LatencyHistogram early;
+        LatencyHistogram late;
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            if (i == window) report.rssStartKb = ReadRssKb();
+
+            int64_t start = MonotonicNs();
+            SoakSample sample = iteration();
+            int64_t elapsed = MonotonicNs() - start;
+
+            if (!sample.ok) report.failures++;
+            if (sample.peakLocalRefs > report.peakLocalRefs) report.peakLocalRefs = sample.peakLocalRefs;
+            report.finalLocalRefs = sample.liveLocalRefs;
+
+            if (i >= window && i < 2 * window) early.record(elapsed);
+            if (i + window >= iterations) late.record(elapsed);
+        }
+
+        report.rssEndKb = ReadRssKb();
+        report.early = early.snapshot();
+        report.late = late.snapshot();
+
+        report.localRefsBounded = report.peakLocalRefs <= limits.maxLocalRefs;
+        report.rssFlat = report.rssStartKb < 0 || report.rssEndKb - report.rssStartKb <= limits.maxRssGrowthKb;
+        report.latencyStable = report.early.count == 0 ||
+                report.late.p99Ns <= static_cast<int64_t>(report.early.p99Ns * (1.0 + limits.maxP99Growth));
+        return report;
+    }
+
+    // One key=value per line so reports can be diffed and tracked across releases
+    inline size_t FormatSoakReport(const SoakReport& report, char* buffer, size_t size) {
+        if (size == 0) return 0;
+
+        size_t len = 0;
+        auto append = [&](const char* fmt, auto... args) {
+            if (len >= size) return;
+            int n = snprintf(buffer + len, size - len, fmt, args...);
+            if (n > 0) len += static_cast<size_t>(n);
+        };
+        auto window = [&](const char* name, const LatencySnapshot& snap) {
+            append("%s_runs=%" PRIu64 "\n", name, snap.count);
+            append("%s_p50_ns=%" PRId64 "\n", name, snap.p50Ns);
+            append("%s_p99_ns=%" PRId64 "\n", name, snap.p99Ns);
+            append("%s_p999_ns=%" PRId64 "\n", name, snap.p999Ns);
+            append("%s_max_ns=%" PRId64 "\n", name, snap.maxNs);
+        };
+
+        append("iterations=%" PRIu64 "\n", report.iterations);
+        append("failures=%" PRIu64 "\n", report.failures);
+        append("peak_local_refs=%zu\n", report.peakLocalRefs);
+        append("final_local_refs=%zu\n", report.finalLocalRefs);
+        append("rss_start_kb=%" PRId64 "\n", report.rssStartKb);
+        append("rss_end_kb=%" PRId64 "\n", report.rssEndKb);
+        window("early", report.early);
+        window("late", report.late);
+        append("local_refs_bounded=%d\n", report.localRefsBounded);
+        append("rss_flat=%d\n", report.rssFlat);
+        append("latency_stable=%d\n", report.latencyStable);
+        append("result=%s\n", report.passed() ? "pass" : "fail");
+        return len < size ? len : size - 1;
+    }
+
+} // namespace checkbeer
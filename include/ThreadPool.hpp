@@ -0,0 +1,471 @@
+#pragma once
+
+#include <jni.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "CheckMetrics.hpp"
+#include "JNIEnvManager.hpp"
+#include "Trace.hpp"
+
+namespace checkbeer {
+
+    enum class PoolPriority {
+        Nice,  // setpriority(niceValue): still scheduled, after foreground work
+        Idle,  // SCHED_IDLE: only runs when a core has nothing else to do
+    };
+
+    struct ThreadPoolOptions {
+        size_t threads = 0;             // 0: one per efficiency core, at most 4
+        bool efficiencyCores = true;    // pin workers to the lowest-capacity cores
+        std::vector<int> cpus;          // explicit CPU set, overrides efficiencyCores
+        PoolPriority priority = PoolPriority::Nice;
+        int niceValue = 10;
+        const char* name = "CheckBeerPool";
+    };
+
+    // CPUs with the lowest capacity (cpu_capacity on arm64, else max
+    // frequency). Empty when the cores are uniform or sysfs is unreadable.
+    inline std::vector<int> EfficiencyCpus() {
+        long count = sysconf(_SC_NPROCESSORS_CONF);
+        std::vector<long> capacity;
+        for (const char* attribute : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+            capacity.assign(static_cast<size_t>(count > 0 ? count : 0), -1);
+            bool any = false;
+            for (long cpu = 0; cpu < count; cpu++) {
+                char path[96];
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/%s", cpu, attribute);
+                FILE* file = fopen(path, "re");
+                if (!file) continue;
+                long value;
+                if (fscanf(file, "%ld", &value) == 1) {
+                    capacity[static_cast<size_t>(cpu)] = value;
+                    any = true;
+                }
+                fclose(file);
+            }
+            if (any) break;
+        }
+
+        long lowest = -1, highest = -1;
+        for (long value : capacity) {
+            if (value < 0) continue;
+            if (lowest < 0 || value < lowest) lowest = value;
+            if (value > highest) highest = value;
+        }
+        std::vector<int> cpus;
+        if (lowest < 0 || lowest == highest) return cpus;
+        for (size_t cpu = 0; cpu < capacity.size(); cpu++) {
+            if (capacity[cpu] == lowest) cpus.push_back(static_cast<int>(cpu));
+        }
+        return cpus;
+    }
+
+    class ThreadPool;
+    class TaskContext;
+
+    namespace detail {
+
+        // fn(TaskContext&) stored inline, so queuing a task never allocates.
+        // Callables must fit kInlineSize: capture pointers, not containers.
+        class InlineTask {
+        public:
+            static constexpr size_t kInlineSize = 6 * sizeof(void*);
+
+            InlineTask() = default;
+
+            template <typename F, typename Fn = std::decay_t<F>,
+                      typename = std::enable_if_t<!std::is_same<Fn, InlineTask>::value>>
+            explicit InlineTask(F&& fn) {
+                static_assert(sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t),
+                              "task captures too much to be stored inline");
+                static_assert(std::is_nothrow_move_constructible<Fn>::value, "task must be nothrow movable");
+                new (storage_) Fn(std::forward<F>(fn));
+                ops_ = &Ops<Fn>::kTable;
+            }
+
+            InlineTask(InlineTask&& other) noexcept { take(other); }
+
+            InlineTask& operator=(InlineTask&& other) noexcept {
+                if (this != &other) {
+                    reset();
+                    take(other);
+                }
+                return *this;
+            }
+
+            ~InlineTask() { reset(); }
+
+            void operator()(TaskContext& context) { ops_->invoke(storage_, context); }
+
+        private:
+            struct Table {
+                void (*invoke)(void*, TaskContext&);
+                void (*move)(void* to, void* from);
+                void (*destroy)(void*);
+            };
+
+            template <typename Fn>
+            struct Ops {
+                static void Invoke(void* fn, TaskContext& context) { (*static_cast<Fn*>(fn))(context); }
+                static void Move(void* to, void* from) { new (to) Fn(std::move(*static_cast<Fn*>(from))); }
+                static void Destroy(void* fn) { static_cast<Fn*>(fn)->~Fn(); }
+                static constexpr Table kTable = {Invoke, Move, Destroy};
+            };
+
+            void take(InlineTask& other) {
+                if (!other.ops_) return;
+                other.ops_->move(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.reset();
+            }
+
+            void reset() {
+                if (ops_) ops_->destroy(storage_);
+                ops_ = nullptr;
+            }
+
+            alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+            const Table* ops_ = nullptr;
+        };
+
+        // Double-ended queue in one growable array, which keeps its capacity
+        // as items come and go
+        template <typename T>
+        class Ring {
+        public:
+            explicit Ring(size_t capacity) : slots_(capacity > 0 ? capacity : 1) {}
+
+            bool empty() const { return count_ == 0; }
+
+            void push_back(T&& item) {
+                if (count_ == slots_.size()) grow();
+                slots_[(head_ + count_) % slots_.size()] = std::move(item);
+                count_++;
+            }
+
+            T pop_back() {
+                count_--;
+                return std::move(slots_[(head_ + count_) % slots_.size()]);
+            }
+
+            T pop_front() {
+                T item = std::move(slots_[head_]);
+                head_ = (head_ + 1) % slots_.size();
+                count_--;
+                return item;
+            }
+
+        private:
+            void grow() {
+                std::vector<T> slots(slots_.size() * 2);
+                for (size_t i = 0; i < count_; i++) slots[i] = std::move(slots_[(head_ + i) % slots_.size()]);
+                slots_.swap(slots);
+                head_ = 0;
+            }
+
+            std::vector<T> slots_;
+            size_t head_ = 0;
+            size_t count_ = 0;
+        };
+
+    } // namespace detail
+
+    // Per-worker state handed to every task. env() attaches the worker to the
+    // cached JavaVM on first use only, so pure native tasks never pay for
+    // attachment; the worker is detached when its thread exits.
+    class TaskContext {
+    public:
+        explicit TaskContext(const char* threadName) : threadName_(threadName) {}
+
+        JNIEnv* env() { return jni::CurrentEnv(threadName_); }
+
+        // Disable copy
+        TaskContext(const TaskContext&) = delete;
+        TaskContext& operator=(const TaskContext&) = delete;
+
+    private:
+        const char* threadName_;
+    };
+
+    // Completion and CPU accounting for a batch of tasks
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+
+        // Disable copy
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // Block until every task submitted to the group has run. A pool
+        // worker waiting on a nested group runs other tasks meanwhile.
+        void wait();
+
+        size_t completed() const { return completed_.load(std::memory_order_acquire); }
+        size_t failed() const { return failed_.load(std::memory_order_relaxed); }
+        int64_t cpuNs() const { return cpuNs_.load(std::memory_order_relaxed); }
+        int64_t maxTaskCpuNs() const { return maxTaskCpuNs_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class ThreadPool;
+
+        void finish(int64_t taskCpuNs, bool ok) {
+            cpuNs_.fetch_add(taskCpuNs, std::memory_order_relaxed);
+            int64_t seen = maxTaskCpuNs_.load(std::memory_order_relaxed);
+            while (taskCpuNs > seen && !maxTaskCpuNs_.compare_exchange_weak(seen, taskCpuNs, std::memory_order_relaxed)) {}
+            if (!ok) failed_.fetch_add(1, std::memory_order_relaxed);
+            completed_.fetch_add(1, std::memory_order_release);
+
+            // Under the lock, so a waiter cannot destroy the group mid-notify
+            std::lock_guard<std::mutex> guard(lock_);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) done_.notify_all();
+        }
+
+        ThreadPool& pool_;
+        std::atomic<size_t> pending_{0};
+        std::atomic<size_t> completed_{0};
+        std::atomic<size_t> failed_{0};
+        std::atomic<int64_t> cpuNs_{0};
+        std::atomic<int64_t> maxTaskCpuNs_{0};
+        std::mutex lock_;
+        std::condition_variable done_;
+    };
+
+    struct ThreadPoolStats {
+        uint64_t tasks;
+        uint64_t steals;
+        int64_t cpuNs;
+    };
+
+    // Work-stealing pool for deep checks. Each worker owns a deque: it pops
+    // its newest task, idle workers steal the oldest from others, and tasks
+    // submitted from outside are spread round-robin. Tasks must not throw;
+    // one that does is counted as failed in its group.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(const ThreadPoolOptions& options = ThreadPoolOptions()) : options_(options) {
+            cpus_ = !options_.cpus.empty() ? options_.cpus
+                    : options_.efficiencyCores ? EfficiencyCpus() : std::vector<int>();
+
+            size_t threads = options_.threads;
+            if (threads == 0) {
+                size_t available = !cpus_.empty() ? cpus_.size() : std::thread::hardware_concurrency() / 2;
+                threads = available == 0 ? 1 : (available > 4 ? 4 : available);
+            }
+
+            for (size_t i = 0; i < threads; i++) workers_.push_back(std::make_unique<Worker>());
+            for (size_t i = 0; i < threads; i++) {
+                workers_[i]->thread = std::thread([this, i] { workerLoop(i); });
+            }
+        }
+
+        // Runs what is already queued, then joins the workers
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard(sleepLock_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            for (auto& worker : workers_) worker->thread.join();
+        }
+
+        // fn is called as fn(TaskContext&) and is stored inline in the
+        // queue, so its captures must fit detail::InlineTask::kInlineSize.
+        // The sleep lock is only taken when a worker is asleep.
+        template <typename F>
+        void submit(TaskGroup& group, const char* name, F&& fn) {
+            group.pending_.fetch_add(1, std::memory_order_relaxed);
+            Task task{detail::InlineTask(std::forward<F>(fn)), &group, name};
+
+            // Counted before it is queued, so queued_ never dips below zero
+            queued_.fetch_add(1, std::memory_order_seq_cst);
+            size_t target = currentWorker() >= 0 ? static_cast<size_t>(currentWorker())
+                    : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+            {
+                std::lock_guard<std::mutex> guard(workers_[target]->lock);
+                workers_[target]->tasks.push_back(std::move(task));
+            }
+
+            // Pairs with workerLoop: a worker counts itself sleeping before
+            // it checks queued_, so one of the two sees the other
+            if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> guard(sleepLock_);
+                wake_.notify_one();
+            }
+        }
+
+        size_t size() const { return workers_.size(); }
+
+        const std::vector<int>& cpus() const { return cpus_; }
+
+        ThreadPoolStats stats() const {
+            return {tasks_.load(std::memory_order_relaxed), steals_.load(std::memory_order_relaxed),
+                    cpuNs_.load(std::memory_order_relaxed)};
+        }
+
+        // Disable copy
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+    private:
+        friend class TaskGroup;
+
+        static constexpr size_t kInitialQueueCapacity = 64;
+
+        struct Task {
+            detail::InlineTask fn;
+            TaskGroup* group = nullptr;
+            const char* name = nullptr;
+        };
+
+        struct Worker {
+            std::mutex lock;
+            detail::Ring<Task> tasks{kInitialQueueCapacity};
+            std::thread thread;
+        };
+
+        struct WorkerIdentity {
+            ThreadPool* pool;
+            int index;
+            TaskContext* context;
+        };
+
+        static WorkerIdentity& identity() {
+            static thread_local WorkerIdentity self = {nullptr, -1, nullptr};
+            return self;
+        }
+
+        int currentWorker() const {
+            const WorkerIdentity& self = identity();
+            return self.pool == this ? self.index : -1;
+        }
+
+        // Own deque from the back, then everyone else's from the front
+        bool take(size_t self, Task& out) {
+            {
+                Worker& own = *workers_[self];
+                std::lock_guard<std::mutex> guard(own.lock);
+                if (!own.tasks.empty()) {
+                    out = own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < workers_.size(); i++) {
+                Worker& victim = *workers_[(self + i) % workers_.size()];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    out = victim.tasks.pop_front();
+                    steals_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool runOne(size_t self, TaskContext& context) {
+            Task task;
+            if (!take(self, task)) return false;
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+
+            CHECK_TRACE_SPAN(task.name);
+            int64_t cpuStart = ThreadCpuNs();
+            bool ok = true;
+            try {
+                task.fn(context);
+            } catch (...) {
+                ok = false;
+            }
+            int64_t cpuNs = ThreadCpuNs() - cpuStart;
+
+            tasks_.fetch_add(1, std::memory_order_relaxed);
+            cpuNs_.fetch_add(cpuNs, std::memory_order_relaxed);
+            task.group->finish(cpuNs, ok);
+            return true;
+        }
+
+        void configureThread(size_t index) {
+            char name[16];
+            snprintf(name, sizeof(name), "%.11s-%zu", options_.name, index);
+            pthread_setname_np(pthread_self(), name);
+
+            if (!cpus_.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : cpus_) CPU_SET(cpu, &set);
+                sched_setaffinity(0, sizeof(set), &set);
+            }
+
+            // Both calls act on the calling thread only on Linux
+            if (options_.priority == PoolPriority::Idle) {
+                struct sched_param param = {};
+                sched_setscheduler(0, SCHED_IDLE, &param);
+            } else {
+                setpriority(PRIO_PROCESS, 0, options_.niceValue);
+            }
+        }
+
+        void workerLoop(size_t index) {
+            configureThread(index);
+            TaskContext context(options_.name);
+            identity() = {this, static_cast<int>(index), &context};
+
+            for (;;) {
+                if (runOne(index, context)) continue;
+
+                std::unique_lock<std::mutex> guard(sleepLock_);
+                sleeping_.fetch_add(1, std::memory_order_seq_cst);
+                wake_.wait(guard, [this] { return queued_.load(std::memory_order_seq_cst) > 0 || stopping_; });
+                sleeping_.fetch_sub(1, std::memory_order_relaxed);
+                if (queued_.load(std::memory_order_relaxed) == 0 && stopping_) break;
+            }
+            identity() = {nullptr, -1, nullptr};
+        }
+
+        ThreadPoolOptions options_;
+        std::vector<int> cpus_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::atomic<size_t> queued_{0};   // submitted and not yet taken
+        std::atomic<size_t> sleeping_{0}; // workers in wake_.wait
+        std::mutex sleepLock_;            // guards stopping_ and the sleep itself
+        std::condition_variable wake_;
+        bool stopping_ = false;
+        std::atomic<size_t> next_{0};
+        std::atomic<uint64_t> tasks_{0};
+        std::atomic<uint64_t> steals_{0};
+        std::atomic<int64_t> cpuNs_{0};
+    };
+
+    inline void TaskGroup::wait() {
+        ThreadPool::WorkerIdentity& self = ThreadPool::identity();
+        if (self.pool == &pool_) {
+            while (pending_.load(std::memory_order_acquire) > 0) {
+                if (pool_.runOne(static_cast<size_t>(self.index), *self.context)) continue;
+                std::unique_lock<std::mutex> guard(lock_);
+                done_.wait_for(guard, std::chrono::milliseconds(1),
+                               [this] { return pending_.load(std::memory_order_acquire) == 0; });
+            }
+            // Wait out the finisher that is still holding the lock
+            std::lock_guard<std::mutex> guard(lock_);
+            return;
+        }
+
+        std::unique_lock<std::mutex> guard(lock_);
+        done_.wait(guard, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+    }
+
+} // namespace checkbeer
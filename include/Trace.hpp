@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0 compiles every span out; 1 keeps them behind a runtime switch that is off
+// until StartTracing() is called
+#ifndef CHECK_TRACING
+#define CHECK_TRACING 1
+#endif
+
+namespace checkbeer {
+
+    namespace detail {
+
+        struct TraceState {
+            std::atomic<bool> enabled{false};
+            std::mutex lock;
+#ifdef __ANDROID__
+            int markerFd = -1;
+#else
+            FILE* file = nullptr;
+            bool firstEvent = true;
+#endif
+        };
+
+        inline TraceState gTrace;
+
+        inline int64_t TraceClockNs() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+    } // namespace detail
+
+    // On Android spans go to the kernel trace_marker, where systrace and
+    // Perfetto pick them up next to the app's own frames. On a Linux host they
+    // are written to outputPath as Chrome trace-event JSON (chrome://tracing,
+    // ui.perfetto.dev). Returns false if the sink could not be opened.
+    inline bool StartTracing(const char* outputPath = "checkbeer_trace.json") {
+        detail::TraceState& t = detail::gTrace;
+        std::lock_guard<std::mutex> guard(t.lock);
+        if (t.enabled.load(std::memory_order_relaxed)) return true;
+
+#ifdef __ANDROID__
+        (void)outputPath;
+        if (t.markerFd < 0) t.markerFd = open("/sys/kernel/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+        if (t.markerFd < 0) t.markerFd = open("/sys/kernel/debug/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+        if (t.markerFd < 0) return false;
+#else
+        t.file = fopen(outputPath, "w");
+        if (!t.file) return false;
+        fputs("[\n", t.file);
+        t.firstEvent = true;
+#endif
+        t.enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    inline void StopTracing() {
+        detail::TraceState& t = detail::gTrace;
+        std::lock_guard<std::mutex> guard(t.lock);
+        if (!t.enabled.load(std::memory_order_relaxed)) return;
+        t.enabled.store(false, std::memory_order_relaxed);
+
+#ifdef __ANDROID__
+        // The trace_marker fd stays open: spans that began before the stop
+        // still write their end event through it.
+#else
+        fputs("\n]\n", t.file);
+        fclose(t.file);
+        t.file = nullptr;
+#endif
+    }
+
+    inline bool IsTracing() {
+        return detail::gTrace.enabled.load(std::memory_order_acquire);
+    }
+
+    // RAII span. When tracing is off the constructor is one atomic load.
+    class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name) : name_(name) {
+            if (!IsTracing()) return;
+            active_ = true;
+#ifdef __ANDROID__
+            char buffer[128];
+            int n = snprintf(buffer, sizeof(buffer), "B|%d|%s", getpid(), name_);
+            write(buffer, n < static_cast<int>(sizeof(buffer)) ? n : static_cast<int>(sizeof(buffer)) - 1);
+#else
+            startNs_ = detail::TraceClockNs();
+#endif
+        }
+
+        ~TraceSpan() { end(); }
+
+        // Close the span before the end of its scope
+        void end() {
+            if (!active_) return;
+            active_ = false;
+#ifdef __ANDROID__
+            char buffer[32];
+            int n = snprintf(buffer, sizeof(buffer), "E|%d", getpid());
+            write(buffer, n);
+#else
+            int64_t endNs = detail::TraceClockNs();
+            detail::TraceState& t = detail::gTrace;
+            std::lock_guard<std::mutex> guard(t.lock);
+            if (!t.file) return;
+            fprintf(t.file, "%s{\"name\":\"%s\",\"cat\":\"checkbeer\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%ld}",
+                    t.firstEvent ? "" : ",\n", name_, startNs_ / 1000.0, (endNs - startNs_) / 1000.0,
+                    getpid(), static_cast<long>(syscall(SYS_gettid)));
+            t.firstEvent = false;
+#endif
+        }
+
+        // Disable copy
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+#ifdef __ANDROID__
+        static void write(const char* buffer, int length) {
+            int fd = detail::gTrace.markerFd;
+            if (fd < 0 || length <= 0) return;
+            (void)::write(fd, buffer, static_cast<size_t>(length));
+        }
+#endif
+
+        const char* name_;
+        bool active_ = false;
+#ifndef __ANDROID__
+        int64_t startNs_ = 0;
+#endif
+    };
+
+} // namespace checkbeer
+
+#define CHECK_TRACE_CONCAT_INNER(a, b) a##b
+#define CHECK_TRACE_CONCAT(a, b) CHECK_TRACE_CONCAT_INNER(a, b)
+
+// Trace the enclosing scope; name must have static storage duration.
+// BEGIN/END trace part of a scope, the span still ends with the scope on
+// an early return or exception.
+#if CHECK_TRACING
+#define CHECK_TRACE_SPAN(name) checkbeer::TraceSpan CHECK_TRACE_CONCAT(checkTraceSpan_, __LINE__)(name)
+#define CHECK_TRACE_BEGIN(var, name) checkbeer::TraceSpan var(name)
+#define CHECK_TRACE_END(var) var.end()
+#else
+#define CHECK_TRACE_SPAN(name) do {} while (0)
+#define CHECK_TRACE_BEGIN(var, name) do {} while (0)
+#define CHECK_TRACE_END(var) do {} while (0)
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+namespace checkbeer::test {
+
+    inline int gFailures = 0;
+
+    // Exit status for main: nonzero if any expectation failed
+    inline int Result() {
+        if (gFailures > 0) fprintf(stderr, "%d expectation(s) failed\n", gFailures);
+        return gFailures > 0 ? 1 : 0;
+    }
+
+} // namespace checkbeer::test
+
+// Report a failed condition and keep going, so one run shows every failure
+#define EXPECT(condition)                                                           \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+            checkbeer::test::gFailures++;                                           \
+        }                                                                           \
+    } while (0)
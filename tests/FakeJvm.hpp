@@ -0,0 +1,284 @@
+#pragma once
+
+#include <jni.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "JNIRecorder.hpp"
+
+namespace checkbeer::test {
+
+    // A scripted stand-in for ART holding the objects an unmodified app
+    // shows the JNI checks: PackageInfo.CREATOR and its class loader, the
+    // package manager and its mPM binder proxy, ApplicationInfo and
+    // ActivityThread. Objects live as long as the VM, so a reference is the
+    // object's address and deleting one does nothing. Only the functions the
+    // checks and RecordingEnv call are implemented; RecordTrace.cpp uses it
+    // to write the trace the replay test runs against.
+    class FakeJvm {
+    public:
+        static constexpr const char* kPackageName = "com.example.app";
+        static constexpr const char* kSourceDir = "/data/app/~~Zm9vYmFy==/com.example.app-YmF6cXV4==/base.apk";
+        static constexpr const char* kNativeLibraryDir = "/data/app/~~Zm9vYmFy==/com.example.app-YmF6cXV4==/lib/arm64";
+
+        // The paths default to what an app installed from the store gets;
+        // AllocBench points them at files that exist on the host
+        explicit FakeJvm(const char* sourceDir = kSourceDir, const char* nativeLibraryDir = kNativeLibraryDir)
+                : functions_(&table_) {
+            install();
+
+            classClass_ = defineClass("java.lang.Class");
+            classClass_->cls = classClass_;
+            stringClass_ = defineClass("java.lang.String");
+            for (const char* name : {"java.lang.Object", "java.lang.reflect.Field", "android.content.Context",
+                                     "android.content.pm.PackageManager", "android.content.pm.ApplicationInfo"}) {
+                defineClass(name);
+            }
+            Object* fieldClass = classes_["java.lang.reflect.Field"];
+
+            Object* bootLoader = make(defineClass("java.lang.BootClassLoader"));
+            Object* pathLoader = make(defineClass("dalvik.system.PathClassLoader"));
+            defineClass("java.lang.ClassLoader")->members["getSystemClassLoader"] = pathLoader;
+
+            // PackageInfo.CREATOR: a framework class with no fields of its own
+            Object* creatorClass = defineClass("android.content.pm.PackageInfo$1");
+            creatorClass->members["getClassLoader"] = bootLoader;
+            creatorClass->members["getDeclaredFields"] = make(defineClass("[Ljava.lang.reflect.Field;"));
+            defineClass("android.content.pm.PackageInfo")->members["CREATOR"] = make(creatorClass);
+
+            // The app's ApplicationInfo, with no splits
+            Object* applicationInfo = make(classes_["android.content.pm.ApplicationInfo"]);
+            applicationInfo->members["sourceDir"] = string(sourceDir);
+            applicationInfo->members["publicSourceDir"] = string(sourceDir);
+            applicationInfo->members["nativeLibraryDir"] = string(nativeLibraryDir);
+            applicationInfo->members["appComponentFactory"] = string("androidx.core.app.CoreComponentFactory");
+
+            // ApplicationPackageManager.mPM holds the binder proxy
+            Object* mPM = make(defineClass("android.content.pm.IPackageManager$Stub$Proxy"));
+            Object* mPMField = make(fieldClass, "mPM");
+            mPMField->members["get"] = mPM;
+            Object* packageManagerClass = defineClass("android.app.ApplicationPackageManager");
+            packageManagerClass->members["field mPM"] = mPMField;
+            Object* packageManager = make(packageManagerClass);
+            packageManager->members["getApplicationInfo"] = applicationInfo;
+
+            // The Application doubles as the context the checks are given
+            application_ = make(defineClass("com.example.app.App"));
+            application_->members["getPackageManager"] = packageManager;
+            application_->members["getApplicationInfo"] = applicationInfo;
+            application_->members["getPackageName"] = string(kPackageName);
+            application_->members["getPackageResourcePath"] = string(sourceDir);
+            application_->members["getPackageCodePath"] = string(sourceDir);
+
+            Object* activityThreadClass = defineClass("android.app.ActivityThread");
+            Object* activityThread = make(activityThreadClass);
+            activityThread->members["mInitialApplication"] = application_;
+            activityThreadClass->members["currentActivityThread"] = activityThread;
+
+            for (const char* name : {"java.lang.ClassNotFoundException", "java.lang.NoSuchFieldException",
+                                     "java.lang.NullPointerException"}) {
+                defineClass(name);
+            }
+        }
+
+        JNIEnv* env() { return reinterpret_cast<JNIEnv*>(this); }
+
+        jobject context() { return handle(application_); }
+
+        // Disable copy
+        FakeJvm(const FakeJvm&) = delete;
+        FakeJvm& operator=(const FakeJvm&) = delete;
+
+    private:
+        using FunctionTable = jni::FunctionTable;
+
+        // Fields and zero-argument method results, by name. A class keeps
+        // its statics there too, and its declared fields as "field <name>".
+        struct Object {
+            Object* cls;
+            std::string text; // String contents, or a class or field name
+            std::vector<Object*> elements;
+            std::unordered_map<std::string, Object*> members;
+        };
+
+        struct Member {
+            std::string name;
+            std::string signature;
+        };
+
+        static FakeJvm* self(JNIEnv* env) { return reinterpret_cast<FakeJvm*>(env); }
+        static Object* object(jobject handle) { return reinterpret_cast<Object*>(handle); }
+        template <typename T = jobject>
+        static T handle(Object* obj) { return reinterpret_cast<T>(obj); }
+        static const Member* member(const void* id) { return static_cast<const Member*>(id); }
+
+        Object* make(Object* cls, std::string text = {}) {
+            objects_.push_back({cls, std::move(text), {}, {}});
+            return &objects_.back();
+        }
+
+        Object* defineClass(const char* name) {
+            Object* cls = make(classClass_, name);
+            classes_[name] = cls;
+            return cls;
+        }
+
+        Object* string(const char* text) { return make(stringClass_, text); }
+
+        template <typename ID>
+        ID intern(const char* name, const char* signature) {
+            std::string key = std::string(name) + signature;
+            auto it = members_.find(key);
+            if (it == members_.end()) {
+                memberStorage_.push_back({name, signature});
+                it = members_.emplace(key, &memberStorage_.back()).first;
+            }
+            return reinterpret_cast<ID>(it->second);
+        }
+
+        jobject raise(const char* className) {
+            pending_ = make(classes_[className]);
+            return nullptr;
+        }
+
+        // One method call; obj is the class for static methods
+        jobject call(jobject target, jmethodID mid, const jvalue* args) {
+            Object* obj = object(target);
+            const std::string& name = member(mid)->name;
+            if (!obj) return raise("java.lang.NullPointerException");
+            if (name == "getClass") return handle(obj->cls);
+            if (name == "getName") return handle(string(obj->text.c_str()));
+            if (name == "toString") return handle(string((obj->cls->text + "@1b9c2f7").c_str()));
+            if (name == "setAccessible") return nullptr;
+            if (name == "getDeclaredField") {
+                auto it = obj->members.find("field " + object(args[0].l)->text);
+                return it != obj->members.end() ? handle(it->second) : raise("java.lang.NoSuchFieldException");
+            }
+            auto it = obj->members.find(name);
+            return it != obj->members.end() ? handle(it->second) : nullptr;
+        }
+
+        jobject callV(jobject target, jmethodID mid, va_list args) {
+            std::string types = jni::detail::ParameterTypes(member(mid)->signature.c_str());
+            std::vector<jvalue> values(types.size() + 1);
+            for (size_t i = 0; i < types.size(); i++) {
+                switch (types[i]) {
+                    case 'J': values[i].j = va_arg(args, jlong); break;
+                    case 'F': values[i].f = static_cast<jfloat>(va_arg(args, double)); break;
+                    case 'D': values[i].d = va_arg(args, double); break;
+                    case 'L': values[i].l = va_arg(args, jobject); break;
+                    default: values[i].i = va_arg(args, int); break;
+                }
+            }
+            return call(target, mid, values.data());
+        }
+
+        jobject field(jobject target, jfieldID fid) {
+            Object* obj = object(target);
+            if (!obj) return raise("java.lang.NullPointerException");
+            auto it = obj->members.find(member(fid)->name);
+            return it != obj->members.end() ? handle(it->second) : nullptr;
+        }
+
+        void install() {
+            table_.FindClass = [](JNIEnv* env, const char* name) -> jclass {
+                std::string dotted(name);
+                for (char& c : dotted) c = c == '/' ? '.' : c;
+                auto it = self(env)->classes_.find(dotted);
+                if (it != self(env)->classes_.end()) return handle<jclass>(it->second);
+                self(env)->raise("java.lang.ClassNotFoundException");
+                return nullptr;
+            };
+            table_.GetMethodID = [](JNIEnv* env, jclass, const char* name, const char* sig) {
+                return self(env)->intern<jmethodID>(name, sig);
+            };
+            table_.GetStaticMethodID = table_.GetMethodID;
+            table_.GetFieldID = [](JNIEnv* env, jclass, const char* name, const char* sig) {
+                return self(env)->intern<jfieldID>(name, sig);
+            };
+            table_.GetStaticFieldID = table_.GetFieldID;
+
+            table_.CallObjectMethodA = [](JNIEnv* env, jobject obj, jmethodID mid, const jvalue* args) {
+                return self(env)->call(obj, mid, args);
+            };
+            table_.CallObjectMethodV = [](JNIEnv* env, jobject obj, jmethodID mid, va_list args) {
+                return self(env)->callV(obj, mid, args);
+            };
+            table_.CallStaticObjectMethodA = [](JNIEnv* env, jclass cls, jmethodID mid, const jvalue* args) {
+                return self(env)->call(cls, mid, args);
+            };
+            table_.CallStaticObjectMethodV = [](JNIEnv* env, jclass cls, jmethodID mid, va_list args) {
+                return self(env)->callV(cls, mid, args);
+            };
+            table_.CallVoidMethodA = [](JNIEnv* env, jobject obj, jmethodID mid, const jvalue* args) {
+                self(env)->call(obj, mid, args);
+            };
+            table_.CallVoidMethodV = [](JNIEnv* env, jobject obj, jmethodID mid, va_list args) {
+                self(env)->callV(obj, mid, args);
+            };
+            table_.GetObjectField = [](JNIEnv* env, jobject obj, jfieldID fid) { return self(env)->field(obj, fid); };
+            table_.GetStaticObjectField = [](JNIEnv* env, jclass cls, jfieldID fid) {
+                return self(env)->field(cls, fid);
+            };
+            table_.GetObjectClass = [](JNIEnv*, jobject obj) { return handle<jclass>(object(obj)->cls); };
+
+            table_.GetStringLength = [](JNIEnv*, jstring str) { return static_cast<jsize>(object(str)->text.size()); };
+            table_.GetStringUTFLength = table_.GetStringLength;
+            table_.GetStringRegion = [](JNIEnv*, jstring str, jsize start, jsize len, jchar* buf) {
+                for (jsize i = 0; i < len; i++) buf[i] = static_cast<unsigned char>(object(str)->text[start + i]);
+            };
+            table_.GetStringUTFRegion = [](JNIEnv*, jstring str, jsize start, jsize len, char* buf) {
+                std::memcpy(buf, object(str)->text.data() + start, static_cast<size_t>(len));
+            };
+            table_.GetStringUTFChars = [](JNIEnv*, jstring str, jboolean* isCopy) {
+                if (isCopy) *isCopy = JNI_FALSE;
+                return object(str)->text.c_str();
+            };
+            table_.ReleaseStringUTFChars = [](JNIEnv*, jstring, const char*) {};
+            table_.NewStringUTF = [](JNIEnv* env, const char* bytes) {
+                return handle<jstring>(self(env)->string(bytes));
+            };
+            table_.GetArrayLength = [](JNIEnv*, jarray array) {
+                return static_cast<jsize>(object(array)->elements.size());
+            };
+            table_.GetObjectArrayElement = [](JNIEnv*, jobjectArray array, jsize index) {
+                return handle(object(array)->elements[static_cast<size_t>(index)]);
+            };
+
+            // References are plain addresses
+            table_.NewGlobalRef = [](JNIEnv*, jobject obj) { return obj; };
+            table_.NewLocalRef = table_.NewGlobalRef;
+            table_.DeleteGlobalRef = [](JNIEnv*, jobject) {};
+            table_.DeleteLocalRef = table_.DeleteGlobalRef;
+            table_.IsSameObject = [](JNIEnv*, jobject a, jobject b) -> jboolean { return a == b; };
+            table_.PushLocalFrame = [](JNIEnv*, jint) -> jint { return JNI_OK; };
+            table_.PopLocalFrame = [](JNIEnv*, jobject result) { return result; };
+            table_.EnsureLocalCapacity = table_.PushLocalFrame;
+
+            table_.ExceptionCheck = [](JNIEnv* env) -> jboolean { return self(env)->pending_ != nullptr; };
+            table_.ExceptionOccurred = [](JNIEnv* env) { return handle<jthrowable>(self(env)->pending_); };
+            table_.ExceptionDescribe = [](JNIEnv* env) {
+                if (self(env)->pending_) fprintf(stderr, "FakeJvm: %s\n", self(env)->pending_->cls->text.c_str());
+            };
+            table_.ExceptionClear = [](JNIEnv* env) { self(env)->pending_ = nullptr; };
+        }
+
+        // Must stay the first member: a FakeJvm* doubles as the JNIEnv*
+        const FunctionTable* functions_;
+        FunctionTable table_ = {};
+        std::deque<Object> objects_;
+        std::deque<Member> memberStorage_;
+        std::unordered_map<std::string, Object*> classes_;
+        std::unordered_map<std::string, Member*> members_;
+        Object* classClass_ = nullptr;
+        Object* stringClass_ = nullptr;
+        Object* application_ = nullptr;
+        Object* pending_ = nullptr;
+    };
+
+} // namespace checkbeer::test
@@ -0,0 +1,103 @@
+// SHA-256 and CRC32C against published vectors, through every variant the
+// CPU running the test supports
+#include <cstring>
+#include <string>
+
+#include "CpuFeatures.hpp"
+#include "Expect.hpp"
+#include "Kernels.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    std::string Hex(const uint8_t* data, size_t length) {
+        static const char digits[] = "0123456789abcdef";
+        std::string out;
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(digits[data[i] >> 4]);
+            out.push_back(digits[data[i] & 15]);
+        }
+        return out;
+    }
+
+    std::string Sha256Hex(Sha256BlocksFn blocks, const std::string& message, size_t piece) {
+        Sha256 sha(blocks);
+        for (size_t i = 0; i < message.size(); i += piece) {
+            sha.update(message.data() + i, message.size() - i < piece ? message.size() - i : piece);
+        }
+        uint8_t digest[Sha256::kDigestSize];
+        sha.final(digest);
+        return Hex(digest, sizeof(digest));
+    }
+
+    void TestSha256(const KernelVariant<Sha256BlocksFn>& variant) {
+        fprintf(stderr, "sha256 %s\n", variant.name);
+        const struct {
+            std::string message;
+            const char* digest;
+        } vectors[] = {
+                {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+                {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+                {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+                {std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+        };
+        for (const auto& vector : vectors) {
+            // Whole, and in pieces that straddle block boundaries
+            EXPECT(Sha256Hex(variant.fn, vector.message, vector.message.size() + 1) == vector.digest);
+            EXPECT(Sha256Hex(variant.fn, vector.message, 7) == vector.digest);
+            EXPECT(Sha256Hex(variant.fn, vector.message, 65) == vector.digest);
+        }
+    }
+
+    void TestCrc32c(const KernelVariant<Crc32cFn>& variant) {
+        fprintf(stderr, "crc32c %s\n", variant.name);
+        auto crc = [&](const void* data, size_t length, uint32_t seed = 0) {
+            return variant.fn(seed, static_cast<const uint8_t*>(data), length);
+        };
+
+        EXPECT(crc("", 0) == 0);
+        EXPECT(crc("123456789", 9) == 0xE3069283);
+        // RFC 3720 B.4: 32 bytes of zeros, of ones, and ascending
+        uint8_t bytes[32];
+        std::memset(bytes, 0, sizeof(bytes));
+        EXPECT(crc(bytes, sizeof(bytes)) == 0x8A9136AA);
+        std::memset(bytes, 0xFF, sizeof(bytes));
+        EXPECT(crc(bytes, sizeof(bytes)) == 0x62A8AB43);
+        for (int i = 0; i < 32; i++) bytes[i] = static_cast<uint8_t>(i);
+        EXPECT(crc(bytes, sizeof(bytes)) == 0x46DD794E);
+
+        // Chaining and unaligned starts agree with the portable version
+        std::string text(4099, '\0');
+        for (size_t i = 0; i < text.size(); i++) text[i] = static_cast<char>(i * 131 + 7);
+        for (size_t start = 0; start < 9; start++) {
+            const char* data = text.data() + start;
+            size_t length = text.size() - start;
+            uint32_t whole = crc(data, length);
+            EXPECT(whole == detail::Crc32cScalar(0, reinterpret_cast<const uint8_t*>(data), length));
+            EXPECT(crc(data + 1000, length - 1000, crc(data, 1000)) == whole);
+        }
+    }
+
+    template <typename Fn, size_t N, typename T>
+    void ForEachSupported(const KernelVariant<Fn> (&variants)[N], T&& test) {
+        uint32_t features = GetCpuFeatures();
+        for (const KernelVariant<Fn>& variant : variants) {
+            if ((variant.features & features) == variant.features) test(variant);
+        }
+    }
+
+} // namespace
+
+int main() {
+    ForEachSupported(kSha256Variants, TestSha256);
+    ForEachSupported(kCrc32cVariants, TestCrc32c);
+
+    // The dispatched entry points
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash("abc", 3, digest);
+    EXPECT(Hex(digest, sizeof(digest)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT(Crc32c("123456789", 9) == 0xE3069283);
+    return checkbeer::test::Result();
+}
@@ -0,0 +1,95 @@
+// LatencyHistogram quantiles against the exact ones of the recorded samples
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Expect.hpp"
+#include "LatencyHistogram.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    // Within the 3% the snapshot promises
+    bool Near(int64_t actual, int64_t expected) {
+        return std::llabs(actual - expected) <= expected * 3 / 100 + 1;
+    }
+
+    int64_t ExactQuantile(std::vector<int64_t> samples, uint64_t perMille) {
+        std::sort(samples.begin(), samples.end());
+        size_t rank = (samples.size() * perMille + 999) / 1000;
+        return samples[rank == 0 ? 0 : rank - 1];
+    }
+
+    void Check(const std::vector<int64_t>& samples) {
+        LatencyHistogram histogram;
+        int64_t sum = 0;
+        for (int64_t ns : samples) {
+            histogram.record(ns);
+            sum += ns;
+        }
+        LatencySnapshot snap = histogram.snapshot();
+        EXPECT(snap.count == samples.size());
+        EXPECT(snap.minNs == *std::min_element(samples.begin(), samples.end()));
+        EXPECT(snap.maxNs == *std::max_element(samples.begin(), samples.end()));
+        EXPECT(snap.meanNs == sum / static_cast<int64_t>(samples.size()));
+        EXPECT(Near(snap.p50Ns, ExactQuantile(samples, 500)));
+        EXPECT(Near(snap.p99Ns, ExactQuantile(samples, 990)));
+        EXPECT(Near(snap.p999Ns, ExactQuantile(samples, 999)));
+    }
+
+} // namespace
+
+int main() {
+    // Empty
+    LatencyHistogram empty;
+    EXPECT(empty.snapshot().count == 0);
+
+    // Uniform microseconds to a millisecond
+    std::vector<int64_t> uniform;
+    for (int64_t i = 1; i <= 1000; i++) uniform.push_back(i * 1000);
+    Check(uniform);
+
+    // Long-tailed, as check latencies are
+    std::mt19937_64 random(11);
+    std::lognormal_distribution<double> tail(12.0, 1.5);
+    std::vector<int64_t> skewed;
+    for (int i = 0; i < 100000; i++) skewed.push_back(static_cast<int64_t>(tail(random)) + 1);
+    Check(skewed);
+
+    // Small values get a bucket each
+    Check({0, 1, 2, 3, 5, 8, 13});
+
+    // Negative values count as zero; huge ones land in the last bucket
+    LatencyHistogram edges;
+    edges.record(-5);
+    edges.record(int64_t(1) << 40);
+    LatencySnapshot snap = edges.snapshot();
+    EXPECT(snap.count == 2 && snap.minNs == 0 && snap.maxNs == int64_t(1) << 40);
+    EXPECT(LatencyHistogram::bucketIndex(uint64_t(1) << 40) == LatencyHistogram::kBucketCount - 1);
+
+    // Every bucket below 2^kMaxExponent maps its midpoint back to itself
+    const int belowMax = (LatencyHistogram::kMaxExponent - LatencyHistogram::kSubBucketBits + 1) * LatencyHistogram::kSubBuckets;
+    for (int i = 0; i < belowMax; i++) {
+        EXPECT(LatencyHistogram::bucketIndex(static_cast<uint64_t>(LatencyHistogram::bucketValue(i))) == i);
+    }
+
+    // Concurrent writers lose nothing
+    LatencyHistogram shared;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&shared, t] {
+            for (int i = 0; i < 100000; i++) shared.record(1000 + t * 1000 + i % 100);
+        });
+    }
+    for (std::thread& writer : writers) writer.join();
+    snap = shared.snapshot();
+    EXPECT(snap.count == 400000);
+    EXPECT(snap.minNs == 1000 && snap.maxNs == 4099);
+
+    shared.reset();
+    EXPECT(shared.snapshot().count == 0);
+    return checkbeer::test::Result();
+}
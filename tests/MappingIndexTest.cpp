@@ -0,0 +1,130 @@
+// MappingIndex::find against a linear search, on a maps file written by the
+// test and on this process's own maps
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Expect.hpp"
+#include "Mappings.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    struct Range {
+        uintptr_t start;
+        uintptr_t end;
+    };
+
+    const MappingInfo* LinearFind(const MappingIndex& index, uintptr_t address) {
+        for (size_t i = 0; i < index.size(); i++) {
+            if (address >= index[i].start && address < index[i].end) return &index[i];
+        }
+        return nullptr;
+    }
+
+    // Sorted, non-overlapping ranges with gaps between some of them
+    std::vector<Range> RandomRanges(std::mt19937_64& random, size_t count) {
+        std::vector<Range> ranges;
+        uintptr_t at = 0x10000;
+        for (size_t i = 0; i < count; i++) {
+            if (random() % 3 == 0) at += (random() % 16 + 1) * 0x1000;
+            uintptr_t length = (random() % 64 + 1) * 0x1000;
+            ranges.push_back({at, at + length});
+            at += length;
+        }
+        return ranges;
+    }
+
+    bool WriteMaps(const char* path, const std::vector<Range>& ranges) {
+        FILE* file = fopen(path, "w");
+        if (!file) return false;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            // Runs of one file, anonymous memory, and named regions
+            const char* name = i % 5 == 0 ? "" : i % 5 == 4 ? "[anon:scudo:primary]" : "/system/lib64/libtest.so";
+            fprintf(file, "%lx-%lx r-xp %08zx fd:05 %d %s\n", static_cast<unsigned long>(ranges[i].start),
+                    static_cast<unsigned long>(ranges[i].end), (i % 5) * 0x1000, i % 5 == 0 ? 0 : 1234, name);
+        }
+        return fclose(file) == 0;
+    }
+
+    void TestWrittenMaps() {
+        const char* path = "MappingIndexTest.maps";
+        std::mt19937_64 random(7);
+        char buffer[4096];
+
+        for (size_t count : {0, 1, 2, 3, 17, 1000}) {
+            std::vector<Range> ranges = RandomRanges(random, count);
+            EXPECT(WriteMaps(path, ranges));
+            std::shared_ptr<const MappingIndex> index = MappingIndex::Refresh(nullptr, path, buffer, sizeof(buffer));
+            EXPECT(index && index->size() == count);
+            if (!index) continue;
+
+            // Every boundary, either side of it, and random addresses
+            std::vector<uintptr_t> probes = {0, 1, UINTPTR_MAX};
+            for (const Range& range : ranges) {
+                probes.insert(probes.end(), {range.start - 1, range.start, range.start + 1, range.end - 1, range.end});
+            }
+            for (int i = 0; i < 1000; i++) probes.push_back(0x10000 + random() % (count * 0x50000 + 1));
+            for (uintptr_t address : probes) EXPECT(index->find(address) == LinearFind(*index, address));
+
+            for (size_t i = 0; i < index->size(); i++) {
+                EXPECT(index->indexOf(*index->find((*index)[i].start)) == i);
+            }
+
+            // Unchanged file: the same snapshot comes back
+            EXPECT(MappingIndex::Refresh(index, path, buffer, sizeof(buffer)) == index);
+        }
+
+        // Paths and kinds survive the shared path string
+        std::vector<Range> ranges = RandomRanges(random, 10);
+        EXPECT(WriteMaps(path, ranges));
+        std::shared_ptr<const MappingIndex> index = MappingIndex::Refresh(nullptr, path, buffer, sizeof(buffer));
+        EXPECT(index && index->size() == 10);
+        if (index) {
+            EXPECT((*index)[0].kind == MappingKind::Anonymous && (*index)[0].path.empty());
+            EXPECT((*index)[1].kind == MappingKind::File && (*index)[1].path == "/system/lib64/libtest.so");
+            EXPECT((*index)[4].kind == MappingKind::Named && (*index)[4].path == "[anon:scudo:primary]");
+            EXPECT((*index)[1].devMajor == 0xfd && (*index)[1].inode == 1234);
+        }
+        // A rebuild into a spare snapshot consumes it and matches a fresh one;
+        // an unchanged file leaves the spare alone
+        std::shared_ptr<MappingIndex> spare = std::const_pointer_cast<MappingIndex>(
+                MappingIndex::Refresh(nullptr, path, buffer, sizeof(buffer)));
+        const MappingIndex* spareAddress = spare.get();
+        EXPECT(MappingIndex::Refresh(index, path, buffer, sizeof(buffer), &spare) == index && spare);
+        ranges = RandomRanges(random, 20);
+        EXPECT(WriteMaps(path, ranges));
+        std::shared_ptr<const MappingIndex> fresh = MappingIndex::Refresh(nullptr, path, buffer, sizeof(buffer));
+        std::shared_ptr<const MappingIndex> rebuilt = MappingIndex::Refresh(index, path, buffer, sizeof(buffer), &spare);
+        EXPECT(!spare && rebuilt.get() == spareAddress);
+        EXPECT(fresh && rebuilt && rebuilt->size() == 20 && rebuilt->crc() == fresh->crc());
+        for (size_t i = 0; fresh && rebuilt && i < rebuilt->size(); i++) {
+            EXPECT((*rebuilt)[i].start == (*fresh)[i].start && (*rebuilt)[i].path == (*fresh)[i].path);
+        }
+
+        std::remove(path);
+        EXPECT(!MappingIndex::Refresh(nullptr, path, buffer, sizeof(buffer)));
+    }
+
+    void TestOwnMaps() {
+        std::shared_ptr<const MappingIndex> index = GetMappingIndex(true);
+        EXPECT(index && index->size() > 0);
+        if (!index) return;
+
+        const MappingInfo* code = index->find(reinterpret_cast<uintptr_t>(&TestOwnMaps));
+        EXPECT(code && code->executable && code->kind == MappingKind::File);
+        int local = 0;
+        const MappingInfo* stack = index->find(reinterpret_cast<uintptr_t>(&local));
+        EXPECT(stack && stack->writable);
+        if (code) EXPECT(index->moduleBase(*code) != 0);
+    }
+
+} // namespace
+
+int main() {
+    TestWrittenMaps();
+    TestOwnMaps();
+    return checkbeer::test::Result();
+}
@@ -0,0 +1,136 @@
+// MemoryScanner on this process: file exclusion by identity, and matches
+// counted once when slices stop mid-region
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "Expect.hpp"
+#include "MemoryScanner.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    // Only in this binary's read-only data until a test copies them out
+    const MemorySignature kSignatures[] = {
+            {"short", "checkbeer:scanner-test", false},
+            {"long", "checkbeer:a-much-longer-scanner-test-signature", false},
+    };
+
+    struct Hit {
+        const MemorySignature* signature;
+        uintptr_t address;
+    };
+
+    // Slices until a pass completes; every hit inside [start, end)
+    std::vector<Hit> ScanPass(MemoryScanner& scanner, const ScanBudget& budget, uintptr_t start, uintptr_t end) {
+        char buffer[16 << 10];
+        std::vector<Hit> hits;
+        for (int slice = 0; slice < 1000000; slice++) {
+            ScanProgress progress = scanner.scan(budget, buffer, sizeof(buffer),
+                    [&](const MemorySignature& signature, uintptr_t address) {
+                        if (address >= start && address < end) hits.push_back({&signature, address});
+                    });
+            if (progress.passCompleted) break;
+        }
+        return hits;
+    }
+
+    void* MapFile(const char* path, size_t* size) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        void* data = fstat(fd, &st) == 0 ? mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0)
+                                         : MAP_FAILED;
+        close(fd);
+        *size = static_cast<size_t>(st.st_size);
+        return data == MAP_FAILED ? nullptr : data;
+    }
+
+    void TestExcludesEveryMappingOfTheFile() {
+        MemoryScanner scanner(kSignatures, 2);
+        char buffer[16 << 10];
+        EXPECT(scanner.excludeModuleOf(reinterpret_cast<const void*>(&TestExcludesEveryMappingOfTheFile), buffer,
+                                       sizeof(buffer)));
+        ScanBudget unlimited = {SIZE_MAX, INT64_MAX};
+        EXPECT(ScanPass(scanner, unlimited, 0, UINTPTR_MAX).empty());
+
+        // A second mapping of our own file, as ElfFile::Open makes to read
+        // its sections, holds the same bytes and is excluded all the same
+        size_t selfSize = 0;
+        void* self = MapFile("/proc/self/exe", &selfSize);
+        EXPECT(self != nullptr);
+        EXPECT(ScanPass(scanner, unlimited, 0, UINTPTR_MAX).empty());
+
+        // Any other file still counts. Written straight from our read-only
+        // data: a stdio buffer would leave a copy on the heap
+        const char* path = "MemoryScannerTest.bin";
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        std::string_view bytes = kSignatures[0].bytes;
+        EXPECT(fd >= 0 && write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+        if (fd >= 0) close(fd);
+        size_t otherSize = 0;
+        void* other = MapFile(path, &otherSize);
+        EXPECT(other != nullptr);
+        uintptr_t otherStart = reinterpret_cast<uintptr_t>(other);
+        std::vector<Hit> hits = ScanPass(scanner, unlimited, 0, UINTPTR_MAX);
+        EXPECT(hits.size() == 1 && hits[0].address == otherStart && hits[0].signature->bytes == kSignatures[0].bytes);
+
+        if (other) munmap(other, otherSize);
+        if (self) munmap(self, selfSize);
+        std::remove(path);
+    }
+
+    void TestSlicesReportOnce() {
+        MemoryScanner scanner(kSignatures, 2);
+        char buffer[16 << 10];
+        scanner.excludeModuleOf(reinterpret_cast<const void*>(&TestSlicesReportOnce), buffer, sizeof(buffer));
+
+        // A region between two inaccessible pages, so it is a mapping of its own
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t regionSize = 4 * MemoryScanner::kChunkSize;
+        uint8_t* reserved = static_cast<uint8_t*>(
+                mmap(nullptr, regionSize + 2 * page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        EXPECT(reserved != MAP_FAILED);
+        if (reserved == MAP_FAILED) return;
+        uint8_t* region = reserved + page;
+        EXPECT(mprotect(region, regionSize, PROT_READ | PROT_WRITE) == 0);
+
+        // With a one-byte budget every call reads one chunk and stops, then
+        // resumes overlap bytes back: chunk k starts at k * (kChunkSize - overlap)
+        std::string_view shortBytes = kSignatures[0].bytes;
+        std::string_view longBytes = kSignatures[1].bytes;
+        size_t overlap = longBytes.size() - 1;
+        size_t step = MemoryScanner::kChunkSize - overlap;
+        std::vector<size_t> planted = {
+                16,                                        // inside the first chunk
+                MemoryScanner::kChunkSize - overlap + 4,   // wholly in the tail the next slice rereads
+                2 * step + MemoryScanner::kChunkSize - 8,  // straddling the end of chunk 2
+        };
+        for (size_t offset : planted) memcpy(region + offset, shortBytes.data(), shortBytes.size());
+        memcpy(region + 3 * step + 100, longBytes.data(), longBytes.size());
+
+        ScanBudget oneChunk = {1, INT64_MAX};
+        uintptr_t start = reinterpret_cast<uintptr_t>(region);
+        std::vector<Hit> hits = ScanPass(scanner, oneChunk, start, start + regionSize);
+        EXPECT(hits.size() == planted.size() + 1);
+        for (size_t i = 0; i < hits.size() && i < planted.size(); i++) {
+            EXPECT(hits[i].address == start + planted[i]);
+        }
+        EXPECT(scanner.recentMatches() == planted.size() + 1);
+
+        munmap(reserved, regionSize + 2 * page);
+    }
+
+} // namespace
+
+int main() {
+    TestExcludesEveryMappingOfTheFile();
+    TestSlicesReportOnce();
+    return checkbeer::test::Result();
+}
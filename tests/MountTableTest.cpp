@@ -0,0 +1,111 @@
+// UnescapeMountPath, IsUnder, and MountTable::forEachCovering over a saved
+// mountinfo with mounts on, under, above and beside an app directory
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Expect.hpp"
+#include "MountTable.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    void TestUnescapeMountPath() {
+        EXPECT(detail::UnescapeMountPath("/data/app") == "/data/app");
+        EXPECT(detail::UnescapeMountPath("/data/my\\040app") == "/data/my app");
+        EXPECT(detail::UnescapeMountPath("\\040lead and trail\\040") == " lead and trail ");
+        EXPECT(detail::UnescapeMountPath("a\\011b\\012c\\134d") == std::string("a\tb\nc\\d"));
+
+        // Not an escape: kept as is
+        EXPECT(detail::UnescapeMountPath("a\\04") == "a\\04");
+        EXPECT(detail::UnescapeMountPath("a\\400") == "a\\400");
+        EXPECT(detail::UnescapeMountPath("a\\08x") == "a\\08x");
+        EXPECT(detail::UnescapeMountPath("trailing\\") == "trailing\\");
+        EXPECT(detail::UnescapeMountPath("").empty());
+    }
+
+    void TestIsUnder() {
+        EXPECT(detail::IsUnder("/data/app", "/data/app"));
+        EXPECT(detail::IsUnder("/data/app/com.x-1/base.apk", "/data/app"));
+        EXPECT(detail::IsUnder("/data/app/com.x-1", "/data/app/"));
+        EXPECT(detail::IsUnder("/data/app", "/data/app//"));
+        EXPECT(detail::IsUnder("/data/app/", "/data/app"));
+        EXPECT(detail::IsUnder("/data/app", "/"));
+
+        // Sibling prefixes are not under
+        EXPECT(!detail::IsUnder("/data/app2", "/data/app"));
+        EXPECT(!detail::IsUnder("/data/app2/x", "/data/app/"));
+        EXPECT(!detail::IsUnder("/data/apps", "/data/app"));
+        EXPECT(!detail::IsUnder("/data", "/data/app"));
+        EXPECT(!detail::IsUnder("/", "/data"));
+    }
+
+    const char kMountInfo[] =
+            "1 0 253:0 / / ro,relatime - ext4 /dev/root ro\n"
+            "20 1 253:5 / /data rw,nosuid - f2fs /dev/block/dm-5 rw\n"
+            "21 20 253:5 /app /data/app rw - f2fs /dev/block/dm-5 rw\n"
+            "22 20 0:40 / /data/app2 rw - tmpfs tmpfs rw\n"
+            "23 21 0:41 / /data/app/com.x-1/lib rw - tmpfs tmpfs rw\n"
+            "24 21 7:8 /base.apk /data/app/com.x-1/base.apk ro - ext4 /dev/block/loop8 ro\n"
+            "25 21 0:42 / /data/app/com.x-10 rw - tmpfs tmpfs rw\n"
+            "26 21 0:43 / /data/app/com.y\\040z-1 rw - tmpfs tmpfs rw\n";
+
+    std::vector<std::string> Covering(const MountTable& table, std::string_view path, std::string_view root) {
+        std::vector<std::string> mountPoints;
+        size_t count = table.forEachCovering(path, root, [&](const MountPoint& mount) {
+            mountPoints.push_back(mount.mountPoint);
+        });
+        EXPECT(count == mountPoints.size());
+        return mountPoints;
+    }
+
+    void TestForEachCovering() {
+        const char* path = "MountTableTest.mountinfo";
+        FILE* file = fopen(path, "w");
+        EXPECT(file && fputs(kMountInfo, file) >= 0 && fclose(file) == 0);
+
+        MountTable table(path, 4096);
+        EXPECT(table.refresh());
+        EXPECT(table.mounts().size() == 8);
+        using List = std::vector<std::string>;
+
+        // A mount on /data/app itself covers every app under it, as do
+        // mounts on or inside the app's own directory; "/" and "/data" sit
+        // above the root, and "/data/app2" and "com.x-10" are only siblings
+        EXPECT((Covering(table, "/data/app/com.x-1", "/data/app") ==
+                List{"/data/app", "/data/app/com.x-1/lib", "/data/app/com.x-1/base.apk"}));
+
+        // A trailing '/' on either directory changes nothing
+        EXPECT((Covering(table, "/data/app/com.x-1/", "/data/app/") ==
+                List{"/data/app", "/data/app/com.x-1/lib", "/data/app/com.x-1/base.apk"}));
+
+        // A file: mounted over directly, or by a mount above it
+        EXPECT((Covering(table, "/data/app/com.x-1/base.apk", "/data/app") ==
+                List{"/data/app", "/data/app/com.x-1/base.apk"}));
+
+        // The escaped mount point is matched unescaped
+        EXPECT((Covering(table, "/data/app/com.y z-1", "/data/app") == List{"/data/app", "/data/app/com.y z-1"}));
+        EXPECT((Covering(table, "/data/app/com.y", "/data/app") == List{"/data/app"}));
+
+        // With the root higher up, the mounts above the app count too
+        EXPECT((Covering(table, "/data/app/com.x-1/lib", "/data") ==
+                List{"/data", "/data/app", "/data/app/com.x-1/lib"}));
+
+        // Nothing placed over a directory beside the app
+        EXPECT(Covering(table, "/data/app3", "/data/app3").empty());
+
+        // A regular file never flags a change, so it is read once
+        EXPECT(table.refresh() && !table.reread() && table.reads() == 1);
+        std::remove(path);
+    }
+
+} // namespace
+
+int main() {
+    TestUnescapeMountPath();
+    TestIsUnder();
+    TestForEachCovering();
+    return checkbeer::test::Result();
+}
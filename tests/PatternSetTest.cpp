@@ -0,0 +1,102 @@
+// PatternSet::scan against std::string_view::find for every pattern, on
+// random text salted with the patterns, under each prefilter
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Expect.hpp"
+#include "PatternSet.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    using Match = std::pair<size_t, size_t>; // pattern id, offset
+
+    std::vector<Match> Naive(const PatternSet& set, std::string_view text) {
+        std::vector<Match> matches;
+        for (size_t id = 0; id < set.size(); id++) {
+            std::string_view pattern = set.pattern(id);
+            for (size_t at = text.find(pattern); at != std::string_view::npos; at = text.find(pattern, at + 1)) {
+                matches.emplace_back(id, at);
+            }
+        }
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
+    std::vector<Match> Scanned(const PatternSet& set, std::string_view text) {
+        std::vector<Match> matches;
+        size_t lastEnd = 0;
+        bool ordered = true;
+        set.scan(text, [&](size_t id, size_t offset) {
+            size_t end = offset + set.pattern(id).size();
+            ordered &= end >= lastEnd;
+            lastEnd = end;
+            matches.emplace_back(id, offset);
+            return true;
+        });
+        EXPECT(ordered);
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
+    // Random bytes from a small alphabet so partial matches are common, with
+    // whole patterns dropped in, some overlapping
+    std::string RandomText(const PatternSet& set, std::mt19937& random, size_t length) {
+        static const char alphabet[] = "afgirdx-._/\n\0";
+        std::string text;
+        while (text.size() < length) {
+            if (random() % 8 == 0) {
+                text.append(set.pattern(random() % set.size()));
+            } else {
+                text.push_back(alphabet[random() % (sizeof(alphabet) - 1)]);
+            }
+        }
+        return text;
+    }
+
+    void Compare(PatternSet& set, uint32_t seed) {
+        std::mt19937 random(seed);
+        for (int round = 0; round < 50; round++) {
+            std::string text = RandomText(set, random, 1 + random() % 4096);
+            for (PatternSet::Prefilter prefilter :
+                 {PatternSet::Prefilter::None, PatternSet::Prefilter::FirstByte, PatternSet::Prefilter::BytePair}) {
+                set.setPrefilter(prefilter);
+                EXPECT(Scanned(set, text) == Naive(set, text));
+            }
+        }
+    }
+
+} // namespace
+
+int main() {
+    // Names that share prefixes, suffixes and middles
+    PatternSet names = {"frida", "frida-agent", "frida-gadget", "gadget", "agent", "re.frida.server", "ida", "dd"};
+    Compare(names, 1);
+
+    // A single-byte pattern turns BytePair into FirstByte
+    PatternSet withByte = {"x", "frida", "ri"};
+    withByte.setPrefilter(PatternSet::Prefilter::BytePair);
+    EXPECT(withByte.prefilter() == PatternSet::Prefilter::FirstByte);
+    Compare(withByte, 2);
+
+    // Binary patterns with NUL bytes; empty ones are dropped
+    const std::string_view binary[] = {std::string_view("a\0f", 3), std::string_view("\0\0", 2), {}, "fig"};
+    PatternSet bytes(binary, sizeof(binary) / sizeof(binary[0]));
+    EXPECT(bytes.size() == 3);
+    Compare(bytes, 3);
+
+    // Stopping early, and no text at all
+    std::string text = "frida frida frida";
+    size_t seen = 0;
+    names.scan(text, [&](size_t, size_t) { return ++seen < 2; });
+    EXPECT(seen == 2);
+    EXPECT(!names.matches(""));
+    EXPECT(names.matches("/data/local/tmp/re.frida.server"));
+    EXPECT(!names.matches("/system/lib64/libc.so"));
+    return checkbeer::test::Result();
+}
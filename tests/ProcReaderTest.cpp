@@ -0,0 +1,83 @@
+// MapsEntry and MountInfoEntry on lines in the kernel's formats
+#include "Expect.hpp"
+#include "ProcReader.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    void TestMapsEntry() {
+        MapsEntry entry;
+        EXPECT(MapsEntry::parse("7f3c1a2000-7f3c1a9000 r-xp 0001f000 fd:05 1310748                    /apex/com.android.runtime/lib64/bionic/libc.so",
+                                entry));
+        EXPECT(entry.start == 0x7f3c1a2000);
+        EXPECT(entry.end == 0x7f3c1a9000);
+        EXPECT(entry.offset == 0x1f000);
+        EXPECT(entry.devMajor == 0xfd && entry.devMinor == 5);
+        EXPECT(entry.inode == 1310748);
+        EXPECT(entry.readable && !entry.writable && entry.executable && !entry.shared);
+        EXPECT(entry.path == "/apex/com.android.runtime/lib64/bionic/libc.so");
+
+        // Anonymous: no path
+        EXPECT(MapsEntry::parse("7ffd2c5e6000-7ffd2c607000 rw-p 00000000 00:00 0", entry));
+        EXPECT(entry.path.empty());
+        EXPECT(entry.readable && entry.writable && !entry.executable);
+
+        // Shared, with spaces and the deleted marker kept in the path
+        EXPECT(MapsEntry::parse("70000000-70001000 rw-s 00000000 103:2a 42  /data/my dir/file (deleted)", entry));
+        EXPECT(entry.shared);
+        EXPECT(entry.devMajor == 0x103 && entry.devMinor == 0x2a);
+        EXPECT(entry.path == "/data/my dir/file (deleted)");
+
+        // Pseudo paths
+        EXPECT(MapsEntry::parse("ffffffffff600000-ffffffffff601000 --xp 00000000 00:00 0  [vsyscall]", entry));
+        EXPECT(entry.start == 0xffffffffff600000ull && !entry.readable && entry.executable);
+        EXPECT(entry.path == "[vsyscall]");
+
+        EXPECT(!MapsEntry::parse("", entry));
+        EXPECT(!MapsEntry::parse("garbage", entry));
+        EXPECT(!MapsEntry::parse("7000-8000", entry));
+        EXPECT(!MapsEntry::parse("7000-8000 r-", entry));
+        EXPECT(!MapsEntry::parse("7000-8000 r-xp zz 00:00 0", entry));
+    }
+
+    void TestMountInfoEntry() {
+        // The example from proc(5)
+        MountInfoEntry entry;
+        EXPECT(MountInfoEntry::parse("36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue",
+                                     entry));
+        EXPECT(entry.mountId == 36 && entry.parentId == 35);
+        EXPECT(entry.devMajor == 98 && entry.devMinor == 0);
+        EXPECT(entry.root == "/mnt1");
+        EXPECT(entry.mountPoint == "/mnt/parent");
+        EXPECT(entry.mountOptions == "rw,noatime");
+        EXPECT(entry.optionalFields == "master:1");
+        EXPECT(entry.fsType == "ext3");
+        EXPECT(entry.source == "/dev/root");
+        EXPECT(entry.superOptions == "rw,errors=continue");
+
+        // No optional fields; escapes are left for the caller
+        EXPECT(MountInfoEntry::parse("1571 1570 253:5 /app/~~a==/com.example\\040app-b==/base.apk /data/app/x/base.apk ro - f2fs /dev/block/dm-5 ro",
+                                     entry));
+        EXPECT(entry.optionalFields.empty());
+        EXPECT(entry.root == "/app/~~a==/com.example\\040app-b==/base.apk");
+        EXPECT(entry.fsType == "f2fs");
+
+        // Several optional fields
+        EXPECT(MountInfoEntry::parse("25 1 0:22 / /sys rw shared:7 master:3 propagate_from:2 - sysfs sysfs rw", entry));
+        EXPECT(entry.optionalFields == "shared:7 master:3 propagate_from:2");
+        EXPECT(entry.source == "sysfs");
+
+        EXPECT(!MountInfoEntry::parse("", entry));
+        EXPECT(!MountInfoEntry::parse("36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 ext3 /dev/root rw", entry));
+        EXPECT(!MountInfoEntry::parse("36 35 98:0 / / rw - ", entry));
+        EXPECT(!MountInfoEntry::parse("x 35 98:0 / / rw - ext4 /dev/root rw", entry));
+    }
+
+} // namespace
+
+int main() {
+    TestMapsEntry();
+    TestMountInfoEntry();
+    return checkbeer::test::Result();
+}
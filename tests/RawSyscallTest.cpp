@@ -0,0 +1,214 @@
+// The raw system calls against their libc namesakes, on real files and on
+// the error paths, and FileProbe finding nothing to report on a host where
+// nothing hooks libc
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Expect.hpp"
+#include "RawSyscall.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    const char kDir[] = "RawSyscallTest.dir";
+    const char kFile[] = "RawSyscallTest.dir/file";
+    const char kLink[] = "RawSyscallTest.dir/link";
+    const char kMissing[] = "RawSyscallTest.dir/missing";
+    const char kContents[] = "raw syscalls read the same bytes as libc";
+
+    bool SameStat(const struct stat& a, const struct stat& b) {
+        return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_mode == b.st_mode && a.st_nlink == b.st_nlink &&
+               a.st_uid == b.st_uid && a.st_gid == b.st_gid && a.st_size == b.st_size &&
+               a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+    }
+
+    // Result and errno of one call, errno only kept on failure
+    template <typename F>
+    std::pair<long, int> Call(F&& fn) {
+        errno = 0;
+        long result = static_cast<long>(fn());
+        return {result, result < 0 ? errno : 0};
+    }
+
+    void SetUp() {
+        mkdir(kDir, 0755);
+        FILE* file = fopen(kFile, "w");
+        EXPECT(file && fputs(kContents, file) >= 0 && fclose(file) == 0);
+        unlink(kLink);
+        EXPECT(symlink("file", kLink) == 0);
+        for (int i = 0; i < 40; i++) {
+            std::string path = std::string(kDir) + "/entry-with-a-longish-name-" + std::to_string(i);
+            FILE* entry = fopen(path.c_str(), "w");
+            EXPECT(entry && fclose(entry) == 0);
+        }
+    }
+
+    void TearDown() {
+        for (int i = 0; i < 40; i++) unlink((std::string(kDir) + "/entry-with-a-longish-name-" + std::to_string(i)).c_str());
+        unlink(kLink);
+        unlink(kFile);
+        rmdir(kDir);
+    }
+
+    void TestFstatAt() {
+        for (const char* path : {kFile, kDir, kLink}) {
+            for (int flags : {0, AT_SYMLINK_NOFOLLOW}) {
+                struct stat raw, libc;
+                EXPECT(RawFstatAt(AT_FDCWD, path, &raw, flags) == 0);
+                EXPECT(fstatat(AT_FDCWD, path, &libc, flags) == 0);
+                EXPECT(SameStat(raw, libc));
+            }
+        }
+
+        struct stat st;
+        EXPECT((Call([&] { return RawFstatAt(AT_FDCWD, kMissing, &st, 0); }) ==
+                Call([&] { return fstatat(AT_FDCWD, kMissing, &st, 0); })));
+        EXPECT(Call([&] { return RawFstatAt(AT_FDCWD, kMissing, &st, 0); }).second == ENOENT);
+
+        int fd = open(kFile, O_RDONLY | O_CLOEXEC);
+        struct stat raw, libc;
+        EXPECT(RawFstat(fd, &raw) == 0 && fstat(fd, &libc) == 0 && SameStat(raw, libc));
+        close(fd);
+        EXPECT(Call([&] { return RawFstat(-1, &st); }) == Call([&] { return fstat(-1, &st); }));
+    }
+
+    void TestFaccessAt() {
+        for (const char* path : {kFile, kDir, kLink, kMissing}) {
+            for (int mode : {F_OK, R_OK, W_OK, X_OK, R_OK | W_OK}) {
+                EXPECT(Call([&] { return RawFaccessAt(AT_FDCWD, path, mode); }) ==
+                       Call([&] { return faccessat(AT_FDCWD, path, mode, 0); }));
+            }
+        }
+        EXPECT(Call([&] { return RawFaccessAt(AT_FDCWD, kMissing, F_OK); }).second == ENOENT);
+    }
+
+    void TestReadlinkAt() {
+        char raw[64], libc[64];
+        ssize_t rawLength = RawReadlinkAt(AT_FDCWD, kLink, raw, sizeof(raw));
+        ssize_t libcLength = readlinkat(AT_FDCWD, kLink, libc, sizeof(libc));
+        EXPECT(rawLength == 4 && rawLength == libcLength && memcmp(raw, libc, 4) == 0);
+
+        // Truncated to the buffer, as libc does
+        EXPECT(RawReadlinkAt(AT_FDCWD, kLink, raw, 2) == 2 && readlinkat(AT_FDCWD, kLink, libc, 2) == 2);
+        EXPECT(memcmp(raw, "fi", 2) == 0);
+
+        for (const char* path : {kFile, kMissing}) {
+            EXPECT(Call([&] { return RawReadlinkAt(AT_FDCWD, path, raw, sizeof(raw)); }) ==
+                   Call([&] { return readlinkat(AT_FDCWD, path, libc, sizeof(libc)); }));
+        }
+        EXPECT(Call([&] { return RawReadlinkAt(AT_FDCWD, kFile, raw, sizeof(raw)); }).second == EINVAL);
+        EXPECT(Call([&] { return RawReadlinkAt(AT_FDCWD, kMissing, raw, sizeof(raw)); }).second == ENOENT);
+    }
+
+    void TestOpenAndPread() {
+        EXPECT(Call([&] { return RawOpenAt(AT_FDCWD, kMissing, O_RDONLY | O_CLOEXEC); }) ==
+               Call([&] { return openat(AT_FDCWD, kMissing, O_RDONLY | O_CLOEXEC); }));
+        EXPECT(Call([&] { return RawOpenAt(AT_FDCWD, kMissing, O_RDONLY); }).second == ENOENT);
+
+        int fd = RawOpenAt(AT_FDCWD, kFile, O_RDONLY | O_CLOEXEC);
+        EXPECT(fd >= 0);
+        size_t size = sizeof(kContents) - 1;
+        for (off_t offset : {off_t(0), off_t(4), off_t(size - 1), off_t(size), off_t(size + 100)}) {
+            char raw[64] = {}, libc[64] = {};
+            ssize_t rawLength = RawPread(fd, raw, sizeof(raw), offset);
+            ssize_t libcLength = pread(fd, libc, sizeof(libc), offset);
+            EXPECT(rawLength == libcLength && memcmp(raw, libc, sizeof(raw)) == 0);
+        }
+        char bytes[8];
+        EXPECT(RawPread(fd, bytes, sizeof(bytes), 4) == 8 && memcmp(bytes, kContents + 4, 8) == 0);
+        EXPECT(RawClose(fd) == 0);
+
+        EXPECT(Call([&] { return RawPread(fd, bytes, sizeof(bytes), 0); }) ==
+               Call([&] { return pread(fd, bytes, sizeof(bytes), 0); }));
+        EXPECT(Call([&] { return RawPread(-1, bytes, sizeof(bytes), 0); }).second == EBADF);
+        EXPECT(Call([&] { return RawClose(-1); }).second == EBADF);
+    }
+
+    // A small buffer so the listing takes several calls
+    void TestGetdents64() {
+        int fd = open(kDir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        EXPECT(fd >= 0);
+        std::vector<std::string> raw;
+        alignas(8) char buffer[512];
+        int calls = 0;
+        for (;;) {
+            long length = RawGetdents64(fd, buffer, sizeof(buffer));
+            EXPECT(length >= 0);
+            if (length <= 0) break;
+            calls++;
+            for (long at = 0; at < length;) {
+                const char* entry = buffer + at;
+                uint16_t recordLength;
+                memcpy(&recordLength, entry + 16, sizeof(recordLength));
+                raw.emplace_back(entry + 19);
+                at += recordLength;
+            }
+        }
+        close(fd);
+        EXPECT(calls > 1);
+
+        std::vector<std::string> libc;
+        DIR* dir = opendir(kDir);
+        EXPECT(dir != nullptr);
+        while (dir) {
+            struct dirent* entry = readdir(dir);
+            if (!entry) break;
+            libc.emplace_back(entry->d_name);
+        }
+        if (dir) closedir(dir);
+
+        std::sort(raw.begin(), raw.end());
+        std::sort(libc.begin(), libc.end());
+        EXPECT(raw.size() == 40 + 4);
+        EXPECT(raw == libc);
+
+        EXPECT(Call([&] { return RawGetdents64(-1, buffer, sizeof(buffer)); }).second == EBADF);
+        int file = open(kFile, O_RDONLY | O_CLOEXEC);
+        EXPECT(Call([&] { return RawGetdents64(file, buffer, sizeof(buffer)); }).second == ENOTDIR);
+        close(file);
+    }
+
+    // Nothing hooks libc here, so libc and the kernel always agree
+    void TestFileProbeAgreesWithLibc() {
+        FileProbe probe(true);
+        struct stat st;
+        char target[64];
+        for (const char* path : {kFile, kDir, kLink, kMissing, "/proc/self/exe", "/"}) {
+            probe.stat(path, &st);
+            probe.access(path, F_OK);
+            probe.access(path, R_OK | W_OK);
+            probe.readlink(path, target, sizeof(target));
+        }
+
+        EXPECT(probe.stat(kMissing, &st) == -1 && errno == ENOENT);
+        EXPECT(probe.access(kMissing, F_OK) == -1 && errno == ENOENT);
+        EXPECT(probe.readlink(kLink, target, sizeof(target)) == 4);
+        EXPECT(probe.mismatches().empty());
+        for (const FileProbe::Mismatch& mismatch : probe.mismatches()) {
+            fprintf(stderr, "%s %s: raw %ld, libc %ld\n", mismatch.call, mismatch.path, mismatch.raw, mismatch.libc);
+        }
+    }
+
+} // namespace
+
+int main() {
+    SetUp();
+    TestFstatAt();
+    TestFaccessAt();
+    TestReadlinkAt();
+    TestOpenAndPread();
+    TestGetdents64();
+    TestFileProbeAgreesWithLibc();
+    TearDown();
+    return checkbeer::test::Result();
+}
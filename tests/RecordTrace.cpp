@@ -0,0 +1,24 @@
+// Writes the trace ReplayTest runs against: every JNI call checkSignatureBypass
+// makes on FakeJvm's unmodified app. Re-record and commit tests/data/ when
+// the checks change the calls they make:
+//
+//     RecordTrace tests/data/clean_app.trace
+#include "SignatureCheck.hpp"
+
+#include "FakeJvm.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+        return 2;
+    }
+
+    checkbeer::test::FakeJvm vm;
+    recordSignatureBypass(vm.env(), vm.context(), argv[1]);
+
+    // recordSignatureBypass only logs a failed write
+    FILE* trace = fopen(argv[1], "rb");
+    if (!trace) return 1;
+    fclose(trace);
+    return 0;
+}
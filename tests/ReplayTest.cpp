@@ -0,0 +1,35 @@
+// Replays tests/data/clean_app.trace, recorded by RecordTrace against
+// FakeJvm. The checks must make exactly the recorded JNI calls; a change to
+// the calls they make needs a re-recorded trace.
+#include <cstring>
+
+#include "SignatureCheck.hpp"
+
+#include "Expect.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+        return 2;
+    }
+
+    for (int run = 0; run < 2; run++) {
+        bool suspicious = false;
+        EXPECT(replaySignatureBypass(argv[1], false, &suspicious));
+
+        // The recorded sourceDir under /data/app does not exist on the host,
+        // so checkApkPaths and checkApkIdentity flag it every time
+        EXPECT(suspicious);
+
+        // A replayed env has no runtime behind it: its function table is the
+        // replayer's own and must not be reported as redirected
+        char report[checkbeer::CheckReport::kMaxFindings * 192];
+        checkbeer::FormatLastCheckReport(report, sizeof(report));
+        EXPECT(strstr(report, checkbeer::CheckName(checkbeer::CheckId::JniFunctionTable)) == nullptr);
+    }
+
+    // A trace that is not there
+    bool suspicious = false;
+    EXPECT(!replaySignatureBypass("/nonexistent/trace", false, &suspicious));
+    return checkbeer::test::Result();
+}
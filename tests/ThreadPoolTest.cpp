@@ -0,0 +1,106 @@
+// ThreadPool: every task runs once whether submitted from outside or from a
+// worker, queues grow past their initial capacity, and captures stored
+// inline are destroyed exactly once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Expect.hpp"
+#include "ThreadPool.hpp"
+
+using namespace checkbeer;
+
+namespace {
+
+    ThreadPoolOptions Options(size_t threads) {
+        ThreadPoolOptions options;
+        options.threads = threads;
+        options.efficiencyCores = false;
+        return options;
+    }
+
+    void TestEveryTaskRunsOnce() {
+        constexpr size_t kTasks = 20000;
+        std::vector<std::atomic<int>> runs(kTasks);
+        {
+            ThreadPool pool(Options(4));
+            TaskGroup group(pool);
+            for (size_t i = 0; i < kTasks; i++) {
+                pool.submit(group, "test", [&runs, i](TaskContext&) { runs[i].fetch_add(1); });
+            }
+            group.wait();
+            EXPECT(group.completed() == kTasks);
+            EXPECT(pool.stats().tasks == kTasks);
+        }
+        bool once = true;
+        for (const std::atomic<int>& count : runs) once &= count.load() == 1;
+        EXPECT(once);
+    }
+
+    void TestNestedSubmits() {
+        ThreadPool pool(Options(3));
+        TaskGroup outer(pool);
+        std::atomic<size_t> leaves{0};
+        for (int i = 0; i < 16; i++) {
+            pool.submit(outer, "outer", [&pool, &leaves](TaskContext&) {
+                TaskGroup inner(pool);
+                for (int j = 0; j < 200; j++) {
+                    pool.submit(inner, "inner", [&leaves](TaskContext&) { leaves.fetch_add(1); });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+        EXPECT(leaves.load() == 16 * 200);
+    }
+
+    // Wakes a sleeping pool one task at a time, so each submit has to find
+    // the idle workers
+    void TestWakesIdleWorkers() {
+        ThreadPool pool(Options(2));
+        for (int i = 0; i < 200; i++) {
+            TaskGroup group(pool);
+            std::atomic<int> ran{0};
+            pool.submit(group, "wake", [&ran](TaskContext&) { ran.fetch_add(1); });
+            group.wait();
+            EXPECT(ran.load() == 1);
+        }
+    }
+
+    void TestCapturesDestroyedOnce() {
+        auto counted = std::make_shared<std::atomic<int>>(0);
+        {
+            ThreadPool pool(Options(2));
+            TaskGroup group(pool);
+            for (int i = 0; i < 100; i++) {
+                pool.submit(group, "capture", [counted](TaskContext&) { counted->fetch_add(1); });
+            }
+            group.wait();
+        }
+        EXPECT(counted->load() == 100);
+        EXPECT(counted.use_count() == 1);
+    }
+
+    void TestTaskMoves() {
+        auto counted = std::make_shared<int>(0);
+        detail::InlineTask a([counted](TaskContext&) {});
+        EXPECT(counted.use_count() == 2);
+        detail::InlineTask b(std::move(a));
+        EXPECT(counted.use_count() == 2);
+        detail::InlineTask c;
+        c = std::move(b);
+        EXPECT(counted.use_count() == 2);
+        c = detail::InlineTask();
+        EXPECT(counted.use_count() == 1);
+    }
+
+} // namespace
+
+int main() {
+    TestEveryTaskRunsOnce();
+    TestNestedSubmits();
+    TestWakesIdleWorkers();
+    TestCapturesDestroyedOnce();
+    TestTaskMoves();
+    return checkbeer::test::Result();
+}
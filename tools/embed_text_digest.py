@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Embed the text digest that checkSelfIntegrity verifies at run time.
+
+Run on each ABI's final libcheckbeer.so after linking, for example from
+externalNativeBuild or a Gradle task after the strip step:
+
+    python3 tools/embed_text_digest.py path/to/libcheckbeer.so
+
+The digest is SHA-256 over the SHA-256 of each 4 KiB chunk of each
+executable PT_LOAD segment's file bytes, in program header order, which is
+what TextIntegrity computes over the same segments in memory. It is written
+into the EmbeddedDigest record (include/SelfIntegrity.hpp), found by its
+magic. That record lives in .data, outside the hashed bytes, so the file
+can be re-processed and the result is the same. Stripping does not touch
+loadable segments, so running before or after strip gives one digest.
+"""
+
+import hashlib
+import struct
+import sys
+
+MAGIC = b"CheckBeerTextSha"
+VERSION = 1
+PT_LOAD = 1
+PF_X = 1
+
+
+def executable_segments(data):
+    if data[:4] != b"\x7fELF":
+        raise ValueError("not an ELF file")
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    if is64:
+        phoff, = struct.unpack_from(endian + "Q", data, 0x20)
+        phentsize, phnum = struct.unpack_from(endian + "HH", data, 0x36)
+        layout = endian + "IIQQQQQQ"  # type, flags, offset, vaddr, paddr, filesz, memsz, align
+    else:
+        phoff, = struct.unpack_from(endian + "I", data, 0x1C)
+        phentsize, phnum = struct.unpack_from(endian + "HH", data, 0x2A)
+        layout = endian + "IIIIIIII"  # type, offset, vaddr, paddr, filesz, memsz, flags, align
+
+    segments = []
+    for i in range(phnum):
+        fields = struct.unpack_from(layout, data, phoff + i * phentsize)
+        if is64:
+            p_type, p_flags, p_offset, _, _, p_filesz, _, _ = fields
+        else:
+            p_type, p_offset, _, _, p_filesz, _, p_flags, _ = fields
+        if p_type == PT_LOAD and p_flags & PF_X:
+            segments.append((p_offset, p_filesz))
+    return segments, endian
+
+
+def text_digest(data, segments, chunk_size):
+    outer = hashlib.sha256()
+    for offset, size in segments:
+        for start in range(offset, offset + size, chunk_size):
+            end = min(start + chunk_size, offset + size)
+            outer.update(hashlib.sha256(data[start:end]).digest())
+    return outer.digest()
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write("usage: %s <library.so>\n" % argv[0])
+        return 2
+    path = argv[1]
+    with open(path, "rb") as f:
+        data = bytearray(f.read())
+
+    segments, endian = executable_segments(data)
+    if not segments:
+        sys.stderr.write("%s: no executable segments\n" % path)
+        return 1
+
+    at = data.find(MAGIC)
+    if at < 0 or data.find(MAGIC, at + 1) >= 0:
+        sys.stderr.write("%s: expected exactly one digest record\n" % path)
+        return 1
+    for offset, size in segments:
+        if offset <= at < offset + size:
+            sys.stderr.write("%s: digest record is inside an executable segment\n" % path)
+            return 1
+
+    version, chunk_size = struct.unpack_from(endian + "II", data, at + 16)
+    if version != VERSION:
+        sys.stderr.write("%s: digest record version %d, expected %d\n" % (path, version, VERSION))
+        return 1
+
+    digest = text_digest(data, segments, chunk_size)
+    struct.pack_into(endian + "I", data, at + 24, 1)
+    data[at + 32:at + 64] = digest
+    with open(path, "r+b") as f:
+        f.write(data)
+    print("%s: %s (%d bytes of text)" % (path, digest.hex(), sum(size for _, size in segments)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))